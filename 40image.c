@@ -1,48 +1,142 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include "assert.h"
 #include "pnm.h"
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
 #include "compress40.h"
+#include "stream40.h"
+#include "parallel40.h"
+#include "batch40.h"
+#include "stats40.h"
 
 static void (*compress_or_decompress)(FILE *input) = compress40;
+static bool streaming = false;
+static unsigned nthreads = 1;
+static const char *output_dir = NULL;
+static bool stats = false;
+
+static void compress_parallel(FILE *input)
+{
+        compress40_parallel(input, nthreads);
+}
+
+static void decompress_parallel(FILE *input)
+{
+        decompress40_parallel(input, nthreads);
+}
+
+static void usage(const char *progname)
+{
+        fprintf(stderr, "Usage: %s -d [-s | -j N | --stats] "
+                "[--mem-stats] [filename]\n"
+                "       %s -c [-s | -j N | --stats] "
+                "[--mem-stats] [filename]\n"
+                "       %s -d|-c [-j N] [--mem-stats] "
+                "-o outdir [file | dir]...\n",
+                progname, progname, progname);
+        exit(1);
+}
 
 typedef A2Methods_UArray2 A2;
 
+#define MAX_THREADS 1024
+
 int main(int argc, char *argv[])
 {
-        int i;
+        /* options may come before, between, or after the files, so every
+         * argument is read before choosing batch or single file mode */
+        char *operands[argc];
+        int noperands = 0;
 
-        for (i = 1; i < argc; i++) {
+        for (int i = 1; i < argc; i++) {
                 if (strcmp(argv[i], "-c") == 0) {
                         compress_or_decompress = compress40;
                 } else if (strcmp(argv[i], "-d") == 0) {
                         compress_or_decompress = decompress40;
+                } else if (strcmp(argv[i], "-s") == 0) {
+                        streaming = true;
+                } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        char *end;
+                        long n = strtol(argv[++i], &end, 10);
+                        if (*end != '\0' || n < 1 || n > MAX_THREADS) {
+                                fprintf(stderr, "%s: bad thread count '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        nthreads = n;
+                } else if (strcmp(argv[i], "--stats") == 0) {
+                        stats = true;
+                } else if (strcmp(argv[i], "--mem-stats") == 0) {
+                        /* before anything is allocated, so every free
+                         * matches a counted allocation */
+                        stats40_track_memory();
+                } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                        output_dir = argv[++i];
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n",
                                 argv[0], argv[i]);
                         exit(1);
-                } else if (argc - i > 2) {
-                        fprintf(stderr, "Usage: %s -d [filename]\n"
-                                "       %s -c [filename]\n",
-                                argv[0], argv[0]);
-                        exit(1);
                 } else {
-                        break;
+                        operands[noperands++] = argv[i];
+                }
+        }
+        if (stats && (streaming || nthreads > 1 || output_dir != NULL)) {
+                /* the totals are kept for the one thread of the whole
+                 * image path */
+                fprintf(stderr, "%s: --stats cannot be combined with -s, "
+                        "-j, or -o\n", argv[0]);
+                exit(1);
+        }
+        if (output_dir != NULL) {
+                /* batch: the files and directories left on the command
+                 * line, or the paths on standard input, on -j workers */
+                if (streaming) {
+                        fprintf(stderr, "%s: -s and -o cannot be combined\n",
+                                argv[0]);
+                        exit(1);
                 }
+                bool compress = compress_or_decompress == compress40;
+                int skipped = batch40_run(compress, operands, noperands,
+                                          output_dir, nthreads);
+                return skipped == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
         }
-        assert(argc - i <= 1);    /* at most one file on command line */
-        if (i < argc) {
-                FILE *fp = fopen(argv[i], "r");
+        if (noperands > 1) {      /* at most one file on command line */
+                usage(argv[0]);
+        }
+        if (streaming && compress_or_decompress == compress40) {
+                compress_or_decompress = compress40_stream;
+        } else if (streaming) {
+                compress_or_decompress = decompress40_stream;
+        }
+        if (streaming && nthreads > 1) {
+                fprintf(stderr, "%s: -s and -j cannot be combined\n",
+                        argv[0]);
+                exit(1);
+        } else if (nthreads > 1 && compress_or_decompress == compress40) {
+                compress_or_decompress = compress_parallel;
+        } else if (nthreads > 1) {
+                compress_or_decompress = decompress_parallel;
+        }
+        if (stats) {
+                stats40_enable();
+        }
+        if (noperands == 1) {
+                FILE *fp = fopen(operands[0], "r");
                 assert(fp != NULL);
                 compress_or_decompress(fp);
                 fclose(fp);
         } else {
                 compress_or_decompress(stdin);
         }
+        if (stats) {
+                fflush(stdout);
+                stats40_report(stderr, compress_or_decompress == compress40 ?
+                                       "compress" : "decompress");
+        }
 
 
         return EXIT_SUCCESS; 
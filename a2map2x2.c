@@ -0,0 +1,107 @@
+/*
+ * Filename  : a2map2x2.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the a2map2x2.h interface
+ */
+
+#include <stddef.h>
+#include "assert.h"
+#include "a2map2x2.h"
+
+void map_2x2_rows (A2Methods_T methods, A2Methods_UArray2 array2,
+                   A2Methods_2x2applyfun apply, void *cl);
+void map_2x2_tiles (A2Methods_T methods, A2Methods_UArray2 array2,
+                    A2Methods_2x2applyfun apply, void *cl);
+
+/*
+ * map_2x2 (A2Methods_T methods, A2Methods_UArray2 array2,
+ *          A2Methods_2x2applyfun apply, void *cl)
+ *
+ * Parameters: A2Methods_T methods: methods for array2
+ *             A2Methods_UArray2 array2: the array to map over
+ *             A2Methods_2x2applyfun apply: called once per 2x2 block
+ *             void *cl: closure passed to apply
+ * Returns   : Nothing
+ * Does      : Walks contiguous rows with pointers and anything else tile
+ *             by tile through at
+ */
+void map_2x2 (A2Methods_T methods, A2Methods_UArray2 array2,
+              A2Methods_2x2applyfun apply, void *cl)
+{
+    assert(methods != NULL && array2 != NULL);
+
+    if (methods -> width(array2) < 2 || methods -> height(array2) < 2) {
+        return;
+    }
+    if (methods -> blocksize(array2) == 1) {
+        map_2x2_rows(methods, array2, apply, cl);
+    } else {
+        map_2x2_tiles(methods, array2, apply, cl);
+    }
+}
+
+/*
+ * map_2x2_rows (A2Methods_T methods, A2Methods_UArray2 array2,
+ *               A2Methods_2x2applyfun apply, void *cl)
+ *
+ * Parameters: as for map_2x2, for an array whose rows are contiguous
+ * Returns   : Nothing
+ * Does      : Looks up the start of each pair of rows once and steps all
+ *             four pointers along them
+ */
+void map_2x2_rows (A2Methods_T methods, A2Methods_UArray2 array2,
+                   A2Methods_2x2applyfun apply, void *cl)
+{
+    int width  = methods -> width(array2) / 2,
+        height = methods -> height(array2) / 2,
+        size   = methods -> size(array2);
+
+    for (int j = 0; j < height; j++) {
+        char *top    = methods -> at(array2, 0, 2 * j),
+             *bottom = methods -> at(array2, 0, 2 * j + 1);
+        for (int i = 0; i < width; i++, top += 2 * size,
+                                         bottom += 2 * size) {
+            apply(i, j, array2, top, top + size, bottom, bottom + size, cl);
+        }
+    }
+}
+
+/*
+ * map_2x2_tiles (A2Methods_T methods, A2Methods_UArray2 array2,
+ *                A2Methods_2x2applyfun apply, void *cl)
+ *
+ * Parameters: as for map_2x2, for an array in any layout
+ * Returns   : Nothing
+ * Does      : Visits the 2x2 blocks in square tiles whose edge is the
+ *             array's blocksize, rounded down to an even number, so the
+ *             four elements handed out stay in the layout's current block
+ *             as far as the blocksize allows
+ */
+void map_2x2_tiles (A2Methods_T methods, A2Methods_UArray2 array2,
+                    A2Methods_2x2applyfun apply, void *cl)
+{
+    int width  = methods -> width(array2) / 2,
+        height = methods -> height(array2) / 2,
+        tile   = methods -> blocksize(array2) / 2;
+
+    if (tile < 1) {
+        tile = 1;
+    }
+    for (int top = 0; top < height; top += tile) {
+        int bottom = top + tile < height ? top + tile : height;
+        for (int left = 0; left < width; left += tile) {
+            int right = left + tile < width ? left + tile : width;
+            for (int j = top; j < bottom; j++) {
+                for (int i = left; i < right; i++) {
+                    apply(i, j, array2,
+                          methods -> at(array2, 2 * i,     2 * j),
+                          methods -> at(array2, 2 * i + 1, 2 * j),
+                          methods -> at(array2, 2 * i,     2 * j + 1),
+                          methods -> at(array2, 2 * i + 1, 2 * j + 1), cl);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * Filename  : a2map2x2.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : A 2x2 block map for any A2Methods suite. The A2Methods_T
+ *             struct comes from the course's a2methods.h and cannot grow a
+ *             new member, so map_2x2 is a function that takes the suite
+ *             and picks the fastest walk the array's layout allows. The
+ *             apply function is called once per 2x2 block, with pointers
+ *             to all four of its elements.
+ */
+
+#ifndef A2MAP2X2_INCLUDED
+#define A2MAP2X2_INCLUDED
+
+#include "a2methods.h"
+
+/* col and row are the block's position counted in blocks, so element
+ * (2 * col, 2 * row) is the block's top left */
+typedef void A2Methods_2x2applyfun(int col, int row, A2Methods_UArray2 array2,
+                                   A2Methods_Object *tl, A2Methods_Object *tr,
+                                   A2Methods_Object *bl, A2Methods_Object *br,
+                                   void *cl);
+
+/*
+ * map_2x2
+ *
+ * calls apply on every whole 2x2 block of the given array; an odd last
+ * column or row belongs to no block and is skipped. Arrays with a
+ * blocksize of 1 are walked two rows at a time in row major order, and
+ * blocked arrays a blocksize square at a time, so each block of the
+ * underlying layout is finished before the next is started
+ *
+ * assumes neither argument is NULL
+ */
+void map_2x2 (A2Methods_T methods, A2Methods_UArray2 array2,
+              A2Methods_2x2applyfun apply, void *cl);
+
+#endif
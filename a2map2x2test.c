@@ -0,0 +1,174 @@
+/*
+ * Filename  : a2map2x2test.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Test of map_2x2 in a2map2x2.c (make test). Maps over arrays
+ *             of every width and height from 1 to MAX_SIDE, odd ones
+ *             included, made by each method suite with every blocksize
+ *             from 1 to MAX_BLOCKSIZE, and checks that each whole 2x2
+ *             block is visited exactly once, with the four pointers at
+ *             would give for it, and that an odd last column or row is
+ *             left out. Prints each failure and exits with failure if
+ *             there are any
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2pow2.h"
+#include "a2morton.h"
+#include "a2map2x2.h"
+
+#define MAX_SIDE 11
+#define MAX_BLOCKSIZE 8
+#define NUM_SUITES 4
+
+/* what the apply function checks each block against */
+typedef struct visits {
+
+    A2Methods_T methods;
+    const char *suite;
+    int width, height, blocksize;
+    int counts[MAX_SIDE / 2][MAX_SIDE / 2];
+    long failures;
+
+} *visits;
+
+long check_array (A2Methods_T methods, const char *suite, int width,
+                  int height, int blocksize);
+void visit_block (int col, int row, A2Methods_UArray2 array2,
+                  A2Methods_Object *tl, A2Methods_Object *tr,
+                  A2Methods_Object *bl, A2Methods_Object *br, void *cl);
+void report (visits seen, int col, int row, const char *problem);
+
+/*
+ * main (void)
+ *
+ * Parameters: None
+ * Returns   : int: EXIT_SUCCESS if every check passed, else EXIT_FAILURE
+ * Does      : Checks every suite, size, and blocksize
+ */
+int main (void)
+{
+    A2Methods_T suites[NUM_SUITES] = {
+        uarray2_methods_plain, uarray2_methods_blocked,
+        uarray2_methods_blocked_pow2, uarray2_methods_morton
+    };
+    const char *names[NUM_SUITES] = { "plain", "blocked", "pow2", "morton" };
+
+    long checked  = 0,
+         failures = 0;
+    for (int s = 0; s < NUM_SUITES; s++) {
+        for (int width = 1; width <= MAX_SIDE; width++) {
+            for (int height = 1; height <= MAX_SIDE; height++) {
+                for (int b = 1; b <= MAX_BLOCKSIZE; b++) {
+                    failures += check_array(suites[s], names[s], width,
+                                            height, b);
+                    checked++;
+                }
+            }
+        }
+    }
+
+    printf("a2map2x2test: %ld arrays checked, %ld failures\n", checked,
+                                                                failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * check_array (A2Methods_T methods, const char *suite, int width,
+ *              int height, int blocksize)
+ *
+ * Parameters: A2Methods_T methods: the suite to make the array with
+ *             const char *suite: its name, for reports
+ *             int width, height: size of the array
+ *             int blocksize: blocksize asked of new_with_blocksize
+ * Returns   : long: number of failed checks
+ * Does      : Maps over a new array and then checks every whole block was
+ *             visited once
+ */
+long check_array (A2Methods_T methods, const char *suite, int width,
+                  int height, int blocksize)
+{
+    static struct visits seen;
+    seen.methods   = methods;
+    seen.suite     = suite;
+    seen.width     = width;
+    seen.height    = height;
+    seen.blocksize = blocksize;
+    seen.failures  = 0;
+    for (int j = 0; j < MAX_SIDE / 2; j++) {
+        for (int i = 0; i < MAX_SIDE / 2; i++) {
+            seen.counts[j][i] = 0;
+        }
+    }
+
+    A2Methods_UArray2 array2 = methods -> new_with_blocksize(width, height,
+                                                     sizeof(int), blocksize);
+    map_2x2(methods, array2, visit_block, &seen);
+    methods -> free(&array2);
+
+    for (int j = 0; j < height / 2; j++) {
+        for (int i = 0; i < width / 2; i++) {
+            if (seen.counts[j][i] != 1) {
+                report(&seen, i, j, "visited other than once");
+            }
+        }
+    }
+    return seen.failures;
+}
+
+/*
+ * visit_block (int col, int row, A2Methods_UArray2 array2,
+ *              A2Methods_Object *tl, A2Methods_Object *tr,
+ *              A2Methods_Object *bl, A2Methods_Object *br, void *cl)
+ *
+ * Parameters: as for A2Methods_2x2applyfun; cl is the visits
+ * Returns   : Nothing
+ * Does      : Counts the visit and checks the block lies wholly inside the
+ *             array and that its pointers are the ones at returns
+ */
+void visit_block (int col, int row, A2Methods_UArray2 array2,
+                  A2Methods_Object *tl, A2Methods_Object *tr,
+                  A2Methods_Object *bl, A2Methods_Object *br, void *cl)
+{
+    visits seen = cl;
+    A2Methods_T methods = seen -> methods;
+
+    if (col < 0 || row < 0 || 2 * col + 1 >= seen -> width ||
+        2 * row + 1 >= seen -> height) {
+        report(seen, col, row, "outside the whole blocks");
+        return;
+    }
+    seen -> counts[row][col]++;
+
+    int x = 2 * col,
+        y = 2 * row;
+    if (tl != methods -> at(array2, x,     y)     ||
+        tr != methods -> at(array2, x + 1, y)     ||
+        bl != methods -> at(array2, x,     y + 1) ||
+        br != methods -> at(array2, x + 1, y + 1)) {
+        report(seen, col, row, "pointers differ from at");
+    }
+}
+
+/*
+ * report (visits seen, int col, int row, const char *problem)
+ *
+ * Parameters: visits seen: the array being checked
+ *             int col, row: the block at fault
+ *             const char *problem: what is wrong with it
+ * Returns   : Nothing
+ * Does      : Prints the failure and counts it
+ */
+void report (visits seen, int col, int row, const char *problem)
+{
+    fprintf(stderr, "%s %dx%d blocksize %d: block (%d, %d) %s\n",
+            seen -> suite, seen -> width, seen -> height, seen -> blocksize,
+            col, row, problem);
+    seen -> failures++;
+}
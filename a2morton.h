@@ -0,0 +1,19 @@
+/*
+ * Filename  : a2morton.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : A2Methods suite for UArray2z (uarray2z.h), the Morton
+ *             (Z-order) 2D array. It has row major and column major maps,
+ *             and its block major and default maps visit the elements in
+ *             Z order, the order they are stored in.
+ */
+
+#ifndef A2MORTON_INCLUDED
+#define A2MORTON_INCLUDED
+
+#include "a2methods.h"
+
+extern A2Methods_T uarray2_methods_morton;
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <a2plain.h>
 #include "uarray2.h"
+#include "uarray2_span.h"
 
 /************************************************/
 /* Define a private version of each function in */
@@ -24,7 +25,7 @@ static A2Methods_UArray2 new_with_blocksize(int width, int height,
 
 static A2Methods_Object *at(A2 array2D, int col, int row)
 {
-        return UArray2_at(array2D, col, row);
+        return UArray2_at_fast(array2D, col, row);
 }
 
 static void a2free(A2Methods_UArray2* array2D) {
@@ -0,0 +1,19 @@
+/*
+ * Filename  : a2pow2.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : A2Methods suite for UArray2p (uarray2p.h), the power of two
+ *             blocked 2D array; use it wherever uarray2_methods_blocked
+ *             would be used. Like the blocked suite it offers at and the
+ *             block major maps, which are also its default maps.
+ */
+
+#ifndef A2POW2_INCLUDED
+#define A2POW2_INCLUDED
+
+#include "a2methods.h"
+
+extern A2Methods_T uarray2_methods_blocked_pow2;
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Filename  : arena40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the arena40.h interface
+ */
+
+#include <stdlib.h>
+#include "assert.h"
+#include "arena40.h"
+#include "stats40.h"
+
+struct arena40 {
+
+    char *base;         /* NULL until memory is first reserved */
+    size_t capacity,
+           used;
+    stats40_stage owner;    /* stage charged for base */
+
+};
+
+/*
+ * arena40_new (void)
+ *
+ * Parameters: None
+ * Returns   : arena40: an empty arena
+ * Does      : Allocates the arena's header only; its memory is allocated
+ *             by the first arena40_reserve
+ */
+arena40 arena40_new (void)
+{
+    arena40 arena = malloc(sizeof(*arena));
+    assert(arena != NULL);
+    arena -> base     = NULL;
+    arena -> capacity = 0;
+    arena -> used     = 0;
+    arena -> owner    = STATS40_ARENA;
+    return arena;
+}
+
+/*
+ * arena40_free (arena40 *arena)
+ *
+ * Parameters: arena40 *arena: pointer to the arena to free
+ * Returns   : Nothing
+ * Does      : Frees the arena's memory and the arena, and sets it to NULL;
+ *             every run it handed out is invalid afterwards
+ */
+void arena40_free (arena40 *arena)
+{
+    assert(arena != NULL && *arena != NULL);
+    stats40_freed((*arena) -> owner, (*arena) -> capacity);
+    free((*arena) -> base);
+    free(*arena);
+    *arena = NULL;
+}
+
+/*
+ * arena40_reserve (arena40 arena, size_t bytes)
+ *
+ * Parameters: arena40 arena: the arena
+ *             size_t bytes: the most the arena must be able to hand out
+ * Returns   : Nothing
+ * Does      : Empties the arena, and replaces its memory only when it is
+ *             too small, so reserving for a run of same sized images
+ *             allocates just once
+ */
+void arena40_reserve (arena40 arena, size_t bytes)
+{
+    assert(arena != NULL);
+    arena -> used = 0;
+    if (bytes <= arena -> capacity) {
+        return;
+    }
+
+    stats40_freed(arena -> owner, arena -> capacity);
+    free(arena -> base);
+    void *base = NULL;
+    if (posix_memalign(&base, ARENA40_ALIGN, arena40_round(bytes)) != 0) {
+        base = NULL;
+    }
+    assert(base != NULL);
+    arena -> base     = base;
+    arena -> capacity = arena40_round(bytes);
+    arena -> owner    = stats40_allocated(arena -> capacity);
+}
+
+/*
+ * arena40_alloc (arena40 arena, size_t bytes)
+ *
+ * Parameters: arena40 arena: the arena
+ *             size_t bytes: size of the run wanted
+ * Returns   : void *: the run, aligned to ARENA40_ALIGN
+ * Does      : Bumps the arena's high water mark past the run
+ */
+void *arena40_alloc (arena40 arena, size_t bytes)
+{
+    assert(arena != NULL);
+    bytes = arena40_round(bytes);
+    assert(bytes <= arena -> capacity - arena -> used);
+
+    void *run = arena -> base + arena -> used;
+    arena -> used += bytes;
+    return run;
+}
+
+/*
+ * arena40_reset (arena40 arena)
+ *
+ * Parameters: arena40 arena: the arena
+ * Returns   : Nothing
+ * Does      : Takes back every run handed out, keeping the memory for the
+ *             next ones
+ */
+void arena40_reset (arena40 arena)
+{
+    assert(arena != NULL);
+    arena -> used = 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Filename  : arena40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : A scratch arena for the codec's intermediate planes. It is
+ *             one aligned block of memory, reserved once for an image,
+ *             handed out front to back, and reset rather than freed piece
+ *             by piece, so the stages do not go back to the allocator for
+ *             every array. Hanson's Arena_T does the same job but only
+ *             promises the alignment of the largest scalar type; the SSE2
+ *             kernels need whole cache lines.
+ */
+
+#ifndef ARENA40_INCLUDED
+#define ARENA40_INCLUDED
+
+#include <stddef.h>
+
+#define ARENA40_ALIGN 64 /* bytes; every allocation starts on this boundary */
+
+typedef struct arena40 *arena40;
+
+/*
+ * arena40_new
+ *
+ * returns a new, empty arena with no memory reserved
+ */
+arena40 arena40_new (void);
+
+/*
+ * arena40_free
+ *
+ * frees the arena and all memory handed out from it, and sets it to NULL
+ */
+void arena40_free (arena40 *arena);
+
+/*
+ * arena40_reserve
+ *
+ * empties the arena and makes sure it holds at least the given number of
+ * bytes; memory already reserved is kept and reused if it is big enough
+ */
+void arena40_reserve (arena40 arena, size_t bytes);
+
+/*
+ * arena40_alloc
+ *
+ * returns the next ARENA40_ALIGN aligned run of the given number of bytes
+ *
+ * checked runtime error if the reservation is used up; callers size it
+ * up front with arena40_round
+ */
+void *arena40_alloc (arena40 arena, size_t bytes);
+
+/*
+ * arena40_reset
+ *
+ * takes back everything handed out, keeping the reservation
+ */
+void arena40_reset (arena40 arena);
+
+/*
+ * arena40_round
+ *
+ * returns the number of bytes arena40_alloc uses for a request of the
+ * given size
+ */
+static inline size_t arena40_round (size_t bytes)
+{
+    return (bytes + ARENA40_ALIGN - 1) / ARENA40_ALIGN * ARENA40_ALIGN;
+}
+
+#endif
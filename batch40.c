@@ -0,0 +1,618 @@
+/*
+ * Filename  : batch40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the batch40.h interface. The list of
+ *             inputs is gathered first and sorted largest first, then
+ *             dealt round robin into one queue per worker. A worker takes
+ *             images from the front of its own queue, and when that is
+ *             empty steals from the back of another's, so a worker that
+ *             drew a few huge scans does not hold up the rest of the run
+ *             while the others sit idle. The whole run has a fixed list
+ *             of images, so once every queue is empty the workers are done.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "batch40.h"
+#include "image40.h"
+#include "ppm_reader.h"
+#include "read_bitfile.h"
+
+typedef struct path_list {
+
+    char **paths;
+    size_t length,
+           capacity;
+
+} *path_list;
+
+/* one image to code, the file it is coded into, its size in bytes for
+ * ordering the queues, and its place in the list of inputs */
+typedef struct task {
+
+    const char *path;
+    char *output;
+    off_t bytes;
+    size_t order;
+
+} *task;
+
+/* a worker's share of the tasks: indices [head, tail) of its tasks are
+ * left. The owner takes from the head and thieves from the tail, under
+ * the lock */
+typedef struct work_queue {
+
+    pthread_mutex_t lock;
+    size_t *tasks,
+           head,
+           tail;
+
+} *work_queue;
+
+/* what every worker shares; each worker has its own queue and counts the
+ * inputs it skipped in skipped[id] */
+typedef struct batch {
+
+    bool compress;
+    struct task *tasks;
+    struct work_queue *queues;
+    int *skipped;
+    unsigned nworkers;
+
+} *batch;
+
+/* the argument of run_worker */
+typedef struct worker {
+
+    batch shared;
+    unsigned id;
+
+} *worker;
+
+path_list path_list_new (void);
+void path_list_add (path_list list, char *path);
+void path_list_free (path_list *list);
+bool list_directory (path_list list, const char *input_dir);
+path_list list_stdin (void);
+int compare_paths (const void *a, const void *b);
+int compare_tasks (const void *a, const void *b);
+int compare_outputs (const void *a, const void *b);
+size_t drop_shared_outputs (struct task *tasks, size_t ntasks);
+void deal_tasks (batch shared, size_t ntasks);
+void *run_worker (void *arg);
+bool next_task (batch shared, unsigned id, size_t *index);
+void prefetch_next (batch shared, unsigned id);
+char *output_path (const char *input, const char *output_dir,
+                                      const char *extension);
+bool code_one (codec40_context context, bool compress, const char *input,
+                                                       const char *output);
+
+/*
+ * batch40_run (bool compress, char **inputs, int ninputs,
+ *              const char *output_dir, unsigned nthreads)
+ *
+ * Parameters: bool compress: true to compress, false to decompress
+ *             char **inputs: input files and directories
+ *             int ninputs: number of inputs, or 0 to read the input paths
+ *                          from standard input
+ *             const char *output_dir: directory the outputs are written to
+ *             unsigned nthreads: number of workers
+ * Returns   : int: the number of inputs skipped
+ * Does      : Gathers the inputs, orders them largest first and deals them
+ *             into the workers' queues, then runs the workers (the calling
+ *             thread is the first of them) until every queue is empty
+ */
+int batch40_run (bool compress, char **inputs, int ninputs,
+                 const char *output_dir, unsigned nthreads)
+{
+    assert(output_dir != NULL);
+    assert(ninputs == 0 || inputs != NULL);
+    assert(nthreads >= 1);
+
+    path_list paths = ninputs == 0 ? list_stdin() : path_list_new();
+    int skipped = 0;
+    for (int i = 0; i < ninputs; i++) {
+        struct stat info;
+        if (stat(inputs[i], &info) == 0 && S_ISDIR(info.st_mode)) {
+            if (!list_directory(paths, inputs[i])) {
+                fprintf(stderr, "batch40: cannot read directory %s\n",
+                                inputs[i]);
+                skipped++;
+            }
+        } else {
+            char *path = malloc(strlen(inputs[i]) + 1);
+            assert(path != NULL);
+            strcpy(path, inputs[i]);
+            path_list_add(paths, path);
+        }
+    }
+    if (paths -> length == 0) {
+        path_list_free(&paths);
+        return skipped;
+    }
+
+    struct task *tasks = malloc(paths -> length * sizeof(*tasks));
+    assert(tasks != NULL);
+    for (size_t i = 0; i < paths -> length; i++) {
+        struct stat info;
+        tasks[i].path   = paths -> paths[i];
+        tasks[i].output = output_path(tasks[i].path, output_dir,
+                                      compress ? ".bit" : ".ppm");
+        tasks[i].bytes  = stat(tasks[i].path, &info) == 0 ? info.st_size : 0;
+        tasks[i].order  = i;
+    }
+    size_t ntasks = drop_shared_outputs(tasks, paths -> length);
+    skipped += paths -> length - ntasks;
+    if (ntasks == 0) {
+        free(tasks);
+        path_list_free(&paths);
+        return skipped;
+    }
+    if (nthreads > ntasks) {
+        nthreads = ntasks;
+    }
+
+    struct work_queue queues[nthreads];
+    int worker_skipped[nthreads];
+    struct batch shared = { compress, tasks, queues, worker_skipped,
+                            nthreads };
+    deal_tasks(&shared, ntasks);
+
+    struct worker workers[nthreads];
+    pthread_t threads[nthreads];
+    for (unsigned t = 0; t < nthreads; t++) {
+        workers[t].shared = &shared;
+        workers[t].id     = t;
+        worker_skipped[t] = 0;
+    }
+    for (unsigned t = 1; t < nthreads; t++) {
+        int err = pthread_create(&threads[t], NULL, run_worker,
+                                 &workers[t]);
+        assert(err == 0);
+    }
+    run_worker(&workers[0]);
+    for (unsigned t = 1; t < nthreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    for (unsigned t = 0; t < nthreads; t++) {
+        skipped += worker_skipped[t];
+        pthread_mutex_destroy(&queues[t].lock);
+        free(queues[t].tasks);
+    }
+    for (size_t i = 0; i < ntasks; i++) {
+        free(tasks[i].output);
+    }
+    free(tasks);
+    path_list_free(&paths);
+    return skipped;
+}
+
+/*
+ * drop_shared_outputs (struct task *tasks, size_t ntasks)
+ *
+ * Parameters: struct task *tasks: the tasks, with their outputs named
+ *             size_t ntasks: number of tasks
+ * Returns   : size_t: number of tasks left, at the front of the array
+ * Does      : Sorts the tasks by output, and where two inputs would be
+ *             coded into the same file (dir1/x.ppm and dir2/x.ppm, or
+ *             x.ppm and x.pnm) keeps only the one given first, reporting
+ *             each of the others as skipped. Otherwise two workers could
+ *             write the one file at the same time, and all but one output
+ *             would be lost without a word
+ */
+size_t drop_shared_outputs (struct task *tasks, size_t ntasks)
+{
+    qsort(tasks, ntasks, sizeof(struct task), compare_outputs);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < ntasks; i++) {
+        if (kept > 0 && strcmp(tasks[i].output,
+                               tasks[kept - 1].output) == 0) {
+            fprintf(stderr, "batch40: %s and %s would both be written "
+                            "to %s; skipped %s\n", tasks[kept - 1].path,
+                            tasks[i].path, tasks[i].output, tasks[i].path);
+            free(tasks[i].output);
+        } else {
+            tasks[kept++] = tasks[i];
+        }
+    }
+    return kept;
+}
+
+/*
+ * deal_tasks (batch shared, size_t ntasks)
+ *
+ * Parameters: batch shared: the run, with its tasks and unset queues
+ *             size_t ntasks: number of tasks
+ * Returns   : Nothing
+ * Does      : Sorts the tasks largest first and deals them round robin, so
+ *             every queue starts with a share of the big images and each
+ *             worker codes its biggest first
+ */
+void deal_tasks (batch shared, size_t ntasks)
+{
+    unsigned nworkers = shared -> nworkers;
+    qsort(shared -> tasks, ntasks, sizeof(struct task), compare_tasks);
+
+    for (unsigned t = 0; t < nworkers; t++) {
+        work_queue queue = &shared -> queues[t];
+        size_t share = (ntasks - t + nworkers - 1) / nworkers;
+        int err = pthread_mutex_init(&queue -> lock, NULL);
+        assert(err == 0);
+        queue -> tasks = malloc(share * sizeof(size_t));
+        assert(queue -> tasks != NULL);
+        queue -> head = 0;
+        queue -> tail = share;
+        for (size_t i = 0; i < share; i++) {
+            queue -> tasks[i] = t + i * nworkers;
+        }
+    }
+}
+
+/*
+ * run_worker (void *arg)
+ *
+ * Parameters: void *arg: the worker
+ * Returns   : void *: NULL
+ * Does      : Codes tasks with a context of its own until there are none
+ *             left anywhere, asking the kernel to start reading the next
+ *             task of its queue before coding each one
+ */
+void *run_worker (void *arg)
+{
+    worker self = arg;
+    batch shared = self -> shared;
+    codec40_context context = codec40_context_new(uarray2_methods_plain);
+
+    size_t index;
+    while (next_task(shared, self -> id, &index)) {
+        prefetch_next(shared, self -> id);
+        if (!code_one(context, shared -> compress,
+                      shared -> tasks[index].path,
+                      shared -> tasks[index].output)) {
+            shared -> skipped[self -> id]++;
+        }
+    }
+
+    codec40_context_free(&context);
+    return NULL;
+}
+
+/*
+ * next_task (batch shared, unsigned id, size_t *index)
+ *
+ * Parameters: batch shared: the run
+ *             unsigned id: the worker asking
+ *             size_t *index: set to the index of the task to code
+ * Returns   : bool: false once every queue is empty
+ * Does      : Takes the front task of the worker's own queue, or failing
+ *             that steals the back task of the next worker along that has
+ *             any. No tasks are added once the run starts, so finding
+ *             every queue empty means the worker is done
+ */
+bool next_task (batch shared, unsigned id, size_t *index)
+{
+    work_queue own = &shared -> queues[id];
+    bool found = false;
+    pthread_mutex_lock(&own -> lock);
+    if (own -> head < own -> tail) {
+        *index = own -> tasks[own -> head++];
+        found = true;
+    }
+    pthread_mutex_unlock(&own -> lock);
+
+    for (unsigned step = 1; !found && step < shared -> nworkers; step++) {
+        work_queue victim = &shared -> queues[(id + step) %
+                                              shared -> nworkers];
+        pthread_mutex_lock(&victim -> lock);
+        if (victim -> head < victim -> tail) {
+            *index = victim -> tasks[--victim -> tail];
+            found = true;
+        }
+        pthread_mutex_unlock(&victim -> lock);
+    }
+    return found;
+}
+
+/*
+ * prefetch_next (batch shared, unsigned id)
+ *
+ * Parameters: batch shared: the run
+ *             unsigned id: the worker
+ * Returns   : Nothing
+ * Does      : Tells the kernel the front file of the worker's queue will be
+ *             needed, so its pages are read in while the current image is
+ *             coded. If a thief takes that file instead, the read was still
+ *             useful to the thief
+ */
+void prefetch_next (batch shared, unsigned id)
+{
+    work_queue own = &shared -> queues[id];
+    const char *path = NULL;
+    pthread_mutex_lock(&own -> lock);
+    if (own -> head < own -> tail) {
+        path = shared -> tasks[own -> tasks[own -> head]].path;
+    }
+    pthread_mutex_unlock(&own -> lock);
+
+    int fd = path != NULL ? open(path, O_RDONLY) : -1;
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+}
+
+/*
+ * code_one (codec40_context context, bool compress, const char *input,
+ *                                                   const char *output)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             bool compress: true to compress, false to decompress
+ *             const char *input, *output: paths of the input and output
+ * Returns   : bool: false if the input was skipped
+ * Does      : Opens the input and checks its header and size up front, so
+ *             a truncated or malformed image is reported and skipped
+ *             before the output is created rather than raising partway
+ *             through and ending the whole run. Then codes the input into
+ *             the output and closes both, removing an output that could
+ *             not be finished
+ */
+bool code_one (codec40_context context, bool compress, const char *input,
+                                                       const char *output)
+{
+    FILE *in = fopen(input, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "batch40: cannot open %s\n", input);
+        return false;
+    }
+    if (!(compress ? check_ppm(in) : check_bitfile(in))) {
+        fprintf(stderr, "batch40: %s is not a whole %s, skipped\n", input,
+                        compress ? "ppm image" : "bit file");
+        fclose(in);
+        return false;
+    }
+
+    bool opened, written = false;
+    if (compress) {
+        int fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        opened = fd >= 0;
+        if (opened) {
+            compress40_image(context, in, fd);
+            written = close(fd) == 0;
+        }
+    } else {
+        FILE *out = fopen(output, "wb");
+        opened = out != NULL;
+        if (opened) {
+            decompress40_image(context, in, out);
+            written = fclose(out) == 0;
+        }
+    }
+    if (!opened) {
+        fprintf(stderr, "batch40: cannot create %s\n", output);
+    } else if (!written) {
+        fprintf(stderr, "batch40: cannot write %s\n", output);
+        unlink(output);
+    }
+
+    fclose(in);
+    return written;
+}
+
+/*
+ * output_path (const char *input, const char *output_dir,
+ *                                 const char *extension)
+ *
+ * Parameters: const char *input: path of an input
+ *             const char *output_dir: directory the output goes in
+ *             const char *extension: extension of the output, with its dot
+ * Returns   : char *: the output's path, which the caller frees
+ * Does      : Joins output_dir and the input's file name, with the last
+ *             extension of the name (if any) replaced by the given one
+ */
+char *output_path (const char *input, const char *output_dir,
+                                      const char *extension)
+{
+    const char *name = strrchr(input, '/');
+    name = name != NULL ? name + 1 : input;
+    const char *dot = strrchr(name, '.');
+    int stem = dot != NULL && dot != name ? (int) (dot - name)
+                                          : (int) strlen(name);
+
+    size_t dir_length = strlen(output_dir);
+    const char *separator = dir_length > 0 &&
+                            output_dir[dir_length - 1] == '/' ? "" : "/";
+    size_t length = dir_length + 1 + stem + strlen(extension) + 1;
+    char *path = malloc(length);
+    assert(path != NULL);
+    snprintf(path, length, "%s%s%.*s%s", output_dir, separator, stem, name,
+                                         extension);
+    return path;
+}
+
+/*
+ * list_directory (path_list list, const char *input_dir)
+ *
+ * Parameters: path_list list: the list to add to
+ *             const char *input_dir: directory to list
+ * Returns   : bool: false if the directory cannot be opened
+ * Does      : Adds the paths of the directory's regular files to the list
+ *             in name order, skipping names that start with a dot and
+ *             anything that is not a regular file
+ */
+bool list_directory (path_list list, const char *input_dir)
+{
+    DIR *dir = opendir(input_dir);
+    if (dir == NULL) {
+        return false;
+    }
+
+    size_t first = list -> length,
+           dir_length = strlen(input_dir);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry -> d_name[0] == '.') {
+            continue;
+        }
+        size_t length = dir_length + 1 + strlen(entry -> d_name) + 1;
+        char *path = malloc(length);
+        assert(path != NULL);
+        snprintf(path, length, "%s/%s", input_dir, entry -> d_name);
+
+        struct stat info;
+        if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) {
+            path_list_add(list, path);
+        } else {
+            free(path);
+        }
+    }
+    closedir(dir);
+
+    qsort(list -> paths + first, list -> length - first, sizeof(char *),
+                                                          compare_paths);
+    return true;
+}
+
+/*
+ * list_stdin (void)
+ *
+ * Parameters: None
+ * Returns   : path_list: the non-empty lines of standard input
+ * Does      : Reads standard input a line at a time, dropping the line
+ *             endings
+ */
+path_list list_stdin (void)
+{
+    path_list list = path_list_new();
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, stdin)) != -1) {
+        while (length > 0 && (line[length - 1] == '\n' ||
+                              line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length > 0) {
+            char *path = malloc(length + 1);
+            assert(path != NULL);
+            memcpy(path, line, length + 1);
+            path_list_add(list, path);
+        }
+    }
+    free(line);
+    return list;
+}
+
+/*
+ * compare_paths (const void *a, const void *b)
+ *
+ * Parameters: const void *a, *b: pointers to two paths
+ * Returns   : int: the order of the paths, as strcmp
+ * Does      : Compares two elements of a path_list for qsort
+ */
+int compare_paths (const void *a, const void *b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/*
+ * compare_tasks (const void *a, const void *b)
+ *
+ * Parameters: const void *a, *b: pointers to two tasks
+ * Returns   : int: negative if a is bigger than b, positive if smaller
+ * Does      : Orders tasks largest first for qsort, breaking ties by path
+ *             so the order does not depend on qsort
+ */
+int compare_tasks (const void *a, const void *b)
+{
+    const struct task *x = a, *y = b;
+    if (x -> bytes != y -> bytes) {
+        return x -> bytes > y -> bytes ? -1 : 1;
+    }
+    return strcmp(x -> path, y -> path);
+}
+
+/*
+ * compare_outputs (const void *a, const void *b)
+ *
+ * Parameters: const void *a, *b: pointers to two tasks
+ * Returns   : int: the order of the tasks' outputs, as strcmp, and for the
+ *                 same output the order the inputs were given in
+ * Does      : Orders tasks by output for qsort, so tasks sharing an output
+ *             are next to each other with the first given in front
+ */
+int compare_outputs (const void *a, const void *b)
+{
+    const struct task *x = a, *y = b;
+    int order = strcmp(x -> output, y -> output);
+    if (order != 0) {
+        return order;
+    }
+    return x -> order < y -> order ? -1 : x -> order > y -> order;
+}
+
+/*
+ * path_list_new (void)
+ *
+ * Parameters: None
+ * Returns   : path_list: an empty list
+ * Does      : Allocates a list with room for a few paths
+ */
+path_list path_list_new (void)
+{
+    path_list list = malloc(sizeof(*list));
+    assert(list != NULL);
+    list -> length   = 0;
+    list -> capacity = 16;
+    list -> paths    = malloc(list -> capacity * sizeof(char *));
+    assert(list -> paths != NULL);
+    return list;
+}
+
+/*
+ * path_list_add (path_list list, char *path)
+ *
+ * Parameters: path_list list: the list
+ *             char *path: a malloced path, which the list now owns
+ * Returns   : Nothing
+ * Does      : Appends the path, doubling the list's room when it is full
+ */
+void path_list_add (path_list list, char *path)
+{
+    if (list -> length == list -> capacity) {
+        list -> capacity *= 2;
+        list -> paths = realloc(list -> paths,
+                                list -> capacity * sizeof(char *));
+        assert(list -> paths != NULL);
+    }
+    list -> paths[list -> length++] = path;
+}
+
+/*
+ * path_list_free (path_list *list)
+ *
+ * Parameters: path_list *list: pointer to the list to free
+ * Returns   : Nothing
+ * Does      : Frees every path, then the list, and sets it to NULL
+ */
+void path_list_free (path_list *list)
+{
+    assert(list != NULL && *list != NULL);
+    for (size_t i = 0; i < (*list) -> length; i++) {
+        free((*list) -> paths[i]);
+    }
+    free((*list) -> paths);
+    free(*list);
+    *list = NULL;
+}
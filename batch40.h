@@ -0,0 +1,42 @@
+/*
+ * Filename  : batch40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Compresses or decompresses many images in one run, on a pool
+ *             of workers that steal whole images from each other. Every
+ *             image a worker codes goes through that worker's
+ *             codec40_context, so the planes' arena is only reserved again
+ *             when an image is bigger than any before it, and the process
+ *             is started once instead of once per image
+ */
+
+#ifndef BATCH40_INCLUDED
+#define BATCH40_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "codec40.h"
+
+/*
+ * batch40_run
+ *
+ * compresses (or, if compress is false, decompresses) every input into
+ * output_dir using nthreads workers, each with its own context. An input
+ * that is a directory stands for its regular files, in name order and
+ * skipping names that start with a dot; if there are no inputs, the paths
+ * on standard input, one per line, are used. Each output is named after
+ * its input with the extension replaced by .bit or .ppm; when inputs
+ * would share an output, only the first given is coded. An input or
+ * output that cannot be opened, and an input whose header is malformed or
+ * whose file is cut short, is reported on standard error and skipped
+ * without ending the run
+ *
+ * returns the number of inputs skipped
+ *
+ * assumes output_dir is not NULL and nthreads is at least 1
+ */
+int batch40_run (bool compress, char **inputs, int ninputs,
+                 const char *output_dir, unsigned nthreads);
+
+#endif
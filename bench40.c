@@ -0,0 +1,947 @@
+/*
+ * Filename  : bench40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Times every stage of the codec on its own, over whole images,
+ *             for each requested method suite: read_ppm through
+ *             write_bitfile, then read_bitfile through write_ppm. Each
+ *             stage is run several times on the previous stage's output,
+ *             with its input restored between runs where it works in
+ *             place, and the best run is reported. Inputs are ppm files
+ *             or synthetic images, read from memory so the disk is not
+ *             timed. Two more rows then time the whole codec the way
+ *             40image runs it, compress40_image and decompress40_image
+ *             through a codec40_context: the image is put in a temporary
+ *             file first so map_ppm can map it and the bands are coded
+ *             straight from the mapping, as they are for a file on the
+ *             command line (the file stays in the page cache, so the disk
+ *             is still not timed). Output is CSV on standard output, one
+ *             line per image, suite, and stage, so runs of two versions
+ *             can be compared. Every row's rate is in MB/s of the image as
+ *             8-bit rgb, width * height * 3 bytes, whatever the stage
+ *             actually reads or writes; the column is named to say so.
+ *
+ *             Usage: bench40 [-r reps] [-m suite]... [-s WxH]... [file]...
+ *             where suite is plain, blocked, pow2, or morton (default
+ *             plain and blocked)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "assert.h"
+#include "pnm.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2pow2.h"
+#include "a2morton.h"
+#include "plane_set.h"
+#include "rgb_ypp.h"
+#include "ypp_dct.h"
+#include "quantization.h"
+#include "bitmap.h"
+#include "ppm_reader.h"
+#include "read_bitfile.h"
+#include "codec40.h"
+#include "image40.h"
+
+#define DEFAULT_REPS 5
+#define MAX_SUITES 4
+#define DENOMINATOR 255 /* ppm denominator */
+#define NS_PER_S 1000000000.0
+
+/* a method suite the stages can be timed with */
+typedef struct suite {
+
+    const char *name;
+    A2Methods_T *methods;
+    bool chosen;
+
+} *suite;
+
+/* an input image, as the bytes of a ppm file */
+typedef struct input {
+
+    char *name;
+    unsigned char *bytes;
+    size_t length;
+
+} *input;
+
+/* everything the stages pass along; each stage reads the field the one
+ * before it filled, and the saved copies let the in-place quantization
+ * stages start from the same planes every run */
+typedef struct bench_state {
+
+    A2Methods_T methods;
+    codec40_context context;
+    input image_bytes;
+    FILE *ppm_file,
+         *ppm_disk,
+         *bit_file,
+         *null_file;
+    Pnm_ppm image;
+    plane_set ypp,
+              dct,
+              dct_saved,
+              decoded_dct,
+              decoded_dct_saved,
+              decoded_ypp;
+    A2Methods_UArray2 words,
+                      decoded_words,
+                      pixels;
+
+} *bench_state;
+
+/* one timed stage: prepare runs before each timed run, run is timed, and
+ * retire frees what no later stage needs once every run is done */
+typedef struct stage {
+
+    const char *name;
+    void (*prepare)(bench_state state);
+    void (*run)(bench_state state);
+    void (*retire)(bench_state state);
+
+} *stage;
+
+void usage (const char *program);
+input read_input (const char *path);
+input synthetic_input (const char *size);
+void free_input (input *image);
+void bench_image (input image, A2Methods_T methods, const char *suite_name,
+                                                    int reps);
+double now_ns (void);
+void save_planes (plane_set *saved, plane_set planes);
+
+void prepare_read_ppm (bench_state state);
+void run_read_ppm (bench_state state);
+void prepare_rgb_to_ypp (bench_state state);
+void run_rgb_to_ypp (bench_state state);
+void retire_rgb_to_ypp (bench_state state);
+void prepare_ypp_to_dct (bench_state state);
+void run_ypp_to_dct (bench_state state);
+void retire_ypp_to_dct (bench_state state);
+void prepare_quantize_c (bench_state state);
+void run_quantize_c (bench_state state);
+void prepare_bitmap_pack (bench_state state);
+void run_bitmap_pack (bench_state state);
+void retire_bitmap_pack (bench_state state);
+void prepare_write_bitfile (bench_state state);
+void run_write_bitfile (bench_state state);
+void retire_write_bitfile (bench_state state);
+void prepare_read_bitfile (bench_state state);
+void run_read_bitfile (bench_state state);
+void prepare_bitmap_unpack (bench_state state);
+void run_bitmap_unpack (bench_state state);
+void retire_bitmap_unpack (bench_state state);
+void prepare_quantize_d (bench_state state);
+void run_quantize_d (bench_state state);
+void prepare_dct_to_ypp (bench_state state);
+void run_dct_to_ypp (bench_state state);
+void retire_dct_to_ypp (bench_state state);
+void prepare_ypp_to_rgb (bench_state state);
+void run_ypp_to_rgb (bench_state state);
+void retire_ypp_to_rgb (bench_state state);
+void run_write_ppm (bench_state state);
+void retire_write_ppm (bench_state state);
+void prepare_compress40 (bench_state state);
+void run_compress40 (bench_state state);
+void prepare_decompress40 (bench_state state);
+void run_decompress40 (bench_state state);
+
+/* the stages in the order the codec runs them */
+static const struct stage stages[] = {
+    { "read_ppm",      prepare_read_ppm,      run_read_ppm,      NULL },
+    { "rgb_to_ypp",    prepare_rgb_to_ypp,    run_rgb_to_ypp,
+                       retire_rgb_to_ypp },
+    { "ypp_to_dct",    prepare_ypp_to_dct,    run_ypp_to_dct,
+                       retire_ypp_to_dct },
+    { "quantize_c",    prepare_quantize_c,    run_quantize_c,    NULL },
+    { "bitmap_pack",   prepare_bitmap_pack,   run_bitmap_pack,
+                       retire_bitmap_pack },
+    { "write_bitfile", prepare_write_bitfile, run_write_bitfile,
+                       retire_write_bitfile },
+    { "read_bitfile",  prepare_read_bitfile,  run_read_bitfile,  NULL },
+    { "bitmap_unpack", prepare_bitmap_unpack, run_bitmap_unpack,
+                       retire_bitmap_unpack },
+    { "quantize_d",    prepare_quantize_d,    run_quantize_d,    NULL },
+    { "dct_to_ypp",    prepare_dct_to_ypp,    run_dct_to_ypp,
+                       retire_dct_to_ypp },
+    { "ypp_to_rgb",    prepare_ypp_to_rgb,    run_ypp_to_rgb,
+                       retire_ypp_to_rgb },
+    { "write_ppm",     NULL,                  run_write_ppm,
+                       retire_write_ppm },
+    { "compress40",    prepare_compress40,    run_compress40,    NULL },
+    { "decompress40",  prepare_decompress40,  run_decompress40,  NULL }
+};
+
+int main (int argc, char *argv[])
+{
+    struct suite suites[MAX_SUITES] = {
+        { "plain",   &uarray2_methods_plain,        false },
+        { "blocked", &uarray2_methods_blocked,      false },
+        { "pow2",    &uarray2_methods_blocked_pow2, false },
+        { "morton",  &uarray2_methods_morton,       false }
+    };
+    bool any_chosen = false;
+    int reps = DEFAULT_REPS;
+    input inputs[argc];
+    int ninputs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+            if (reps < 1) {
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            int s = 0;
+            while (s < MAX_SUITES && strcmp(suites[s].name, argv[i + 1])) {
+                s++;
+            }
+            if (s == MAX_SUITES) {
+                usage(argv[0]);
+            }
+            suites[s].chosen = any_chosen = true;
+            i++;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            inputs[ninputs++] = synthetic_input(argv[++i]);
+            if (inputs[ninputs - 1] == NULL) {
+                usage(argv[0]);
+            }
+        } else if (*argv[i] == '-') {
+            usage(argv[0]);
+        } else {
+            inputs[ninputs++] = read_input(argv[i]);
+        }
+    }
+    if (ninputs == 0) {
+        usage(argv[0]);
+    }
+    if (!any_chosen) {
+        suites[0].chosen = suites[1].chosen = true;
+    }
+
+    printf("image,suite,width,height,stage,reps,best_ns,ns_per_pixel,"
+           "rgb8_mb_per_s\n");
+    for (int i = 0; i < ninputs; i++) {
+        for (int s = 0; s < MAX_SUITES; s++) {
+            if (suites[s].chosen) {
+                bench_image(inputs[i], *suites[s].methods, suites[s].name,
+                            reps);
+            }
+        }
+        free_input(&inputs[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * usage (const char *program)
+ *
+ * Parameters: const char *program: name the program was run as
+ * Returns   : Does not return
+ * Does      : Prints how to run the program and exits with failure
+ */
+void usage (const char *program)
+{
+    fprintf(stderr, "Usage: %s [-r reps] [-m plain|blocked|pow2|morton]... "
+                    "[-s WxH]... [file.ppm]...\n", program);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * bench_image (input image, A2Methods_T methods, const char *suite_name,
+ *                                                int reps)
+ *
+ * Parameters: input image: the image to code
+ *             A2Methods_T methods: method suite the stages use
+ *             const char *suite_name: name of the suite, for the output
+ *             int reps: number of timed runs of each stage
+ * Returns   : Nothing
+ * Does      : Runs every stage reps times in codec order, timing only the
+ *             stage itself, and prints a line with the best run of each.
+ *             The rate is always of width * height * 3 bytes, the image
+ *             as 8-bit rgb
+ */
+void bench_image (input image, A2Methods_T methods, const char *suite_name,
+                                                    int reps)
+{
+    struct bench_state state;
+    memset(&state, 0, sizeof(state));
+    state.methods     = methods;
+    state.context     = codec40_context_new(methods);
+    state.image_bytes = image;
+    state.ppm_disk    = tmpfile();
+    state.bit_file    = tmpfile();
+    state.null_file   = fopen("/dev/null", "wb");
+    assert(state.ppm_disk != NULL && state.bit_file != NULL &&
+           state.null_file != NULL);
+    size_t written = fwrite(image -> bytes, 1, image -> length,
+                            state.ppm_disk);
+    int flushed = fflush(state.ppm_disk);
+    assert(written == image -> length && flushed == 0);
+
+    size_t nstages = sizeof(stages) / sizeof(stages[0]);
+    int width = 0, height = 0;
+    for (size_t k = 0; k < nstages; k++) {
+        double best = 0;
+        for (int r = 0; r < reps; r++) {
+            if (stages[k].prepare != NULL) {
+                stages[k].prepare(&state);
+            }
+            double start = now_ns();
+            stages[k].run(&state);
+            double elapsed = now_ns() - start;
+            if (r == 0 || elapsed < best) {
+                best = elapsed;
+            }
+            if (state.ppm_file != NULL) {
+                fclose(state.ppm_file);
+                state.ppm_file = NULL;
+            }
+        }
+        if (k == 0) {
+            width  = state.image -> width;
+            height = state.image -> height;
+        }
+        if (stages[k].retire != NULL) {
+            stages[k].retire(&state);
+        }
+
+        double pixels = (double) width * height;
+        printf("%s,%s,%d,%d,%s,%d,%.0f,%.3f,%.1f\n", image -> name,
+               suite_name, width, height, stages[k].name, reps, best,
+               pixels > 0 ? best / pixels : 0,
+               best > 0 ? pixels * 3 / 1e6 / (best / NS_PER_S) : 0);
+        fflush(stdout);
+    }
+
+    fclose(state.ppm_disk);
+    fclose(state.bit_file);
+    fclose(state.null_file);
+    codec40_context_free(&state.context);
+}
+
+/*
+ * now_ns (void)
+ *
+ * Parameters: None
+ * Returns   : double: nanoseconds on the monotonic clock
+ * Does      : Reads CLOCK_MONOTONIC
+ */
+double now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NS_PER_S + ts.tv_nsec;
+}
+
+/*
+ * save_planes (plane_set *saved, plane_set planes)
+ *
+ * Parameters: plane_set *saved: the saved copy, or NULL before the first
+ *                               run
+ *             plane_set planes: planes a stage is about to change in place
+ * Returns   : Nothing
+ * Does      : Copies the planes on the first run, and copies them back
+ *             from the saved copy on every later one
+ */
+void save_planes (plane_set *saved, plane_set planes)
+{
+    size_t bytes = (size_t) planes -> depth * planes -> height *
+                   planes -> stride * sizeof(float);
+    if (*saved == NULL) {
+        *saved = plane_set_new(planes -> width, planes -> height,
+                               planes -> depth);
+        memcpy((*saved) -> data, planes -> data, bytes);
+    } else {
+        memcpy(planes -> data, (*saved) -> data, bytes);
+    }
+}
+
+/*
+ * prepare_read_ppm (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's Pnm_ppm and opens the input's bytes as
+ *             a file in memory, so the disk is not timed
+ */
+void prepare_read_ppm (bench_state state)
+{
+    if (state -> image != NULL) {
+        Pnm_ppmfree(&state -> image);
+    }
+    state -> ppm_file = fmemopen(state -> image_bytes -> bytes,
+                                 state -> image_bytes -> length, "rb");
+    assert(state -> ppm_file != NULL);
+}
+
+/*
+ * run_read_ppm (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times read_ppm: the ppm file's bytes into a Pnm_ppm
+ */
+void run_read_ppm (bench_state state)
+{
+    state -> image = read_ppm(state -> ppm_file, state -> methods);
+}
+
+/*
+ * prepare_rgb_to_ypp (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's planes
+ */
+void prepare_rgb_to_ypp (bench_state state)
+{
+    if (state -> ypp != NULL) {
+        plane_set_free(&state -> ypp);
+    }
+}
+
+/*
+ * run_rgb_to_ypp (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times rgb_to_ypp: the Pnm_ppm's pixels into y, pb, and pr
+ *             planes
+ */
+void run_rgb_to_ypp (bench_state state)
+{
+    state -> ypp = rgb_to_ypp(state -> image -> pixels,
+                              state -> image -> width,
+                              state -> image -> height, state -> methods,
+                              state -> image -> denominator);
+}
+
+/*
+ * retire_rgb_to_ypp (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the Pnm_ppm, which no later stage needs
+ */
+void retire_rgb_to_ypp (bench_state state)
+{
+    Pnm_ppmfree(&state -> image);
+}
+
+/*
+ * prepare_ypp_to_dct (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's transform values
+ */
+void prepare_ypp_to_dct (bench_state state)
+{
+    if (state -> dct != NULL) {
+        plane_set_free(&state -> dct);
+    }
+}
+
+/*
+ * run_ypp_to_dct (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times ypp_to_dct: the planes into one set of transform values
+ *             per block
+ */
+void run_ypp_to_dct (bench_state state)
+{
+    state -> dct = ypp_to_dct(state -> ypp);
+}
+
+/*
+ * retire_ypp_to_dct (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the y, pb, and pr planes
+ */
+void retire_ypp_to_dct (bench_state state)
+{
+    plane_set_free(&state -> ypp);
+}
+
+/*
+ * prepare_quantize_c (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Saves the transform values on the first run and restores them
+ *             on later ones, since quantize_c works in place
+ */
+void prepare_quantize_c (bench_state state)
+{
+    save_planes(&state -> dct_saved, state -> dct);
+}
+
+/*
+ * run_quantize_c (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times quantize_c: the transform values, in place
+ */
+void run_quantize_c (bench_state state)
+{
+    quantize_c(state -> dct);
+}
+
+/*
+ * prepare_bitmap_pack (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's codewords
+ */
+void prepare_bitmap_pack (bench_state state)
+{
+    if (state -> words != NULL) {
+        state -> methods -> free(&state -> words);
+    }
+}
+
+/*
+ * run_bitmap_pack (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times bitmap_pack: the quantized values into codewords
+ */
+void run_bitmap_pack (bench_state state)
+{
+    state -> words = bitmap_pack(state -> methods, state -> dct);
+}
+
+/*
+ * retire_bitmap_pack (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the quantized values and their saved copy
+ */
+void retire_bitmap_pack (bench_state state)
+{
+    plane_set_free(&state -> dct);
+    plane_set_free(&state -> dct_saved);
+}
+
+/*
+ * prepare_write_bitfile (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Empties the temporary bit file and rewinds it
+ */
+void prepare_write_bitfile (bench_state state)
+{
+    int fd = fileno(state -> bit_file);
+    int err = ftruncate(fd, 0);
+    assert(err == 0);
+    lseek(fd, 0, SEEK_SET);
+}
+
+/*
+ * run_write_bitfile (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times write_bitfile_fd: the codewords into the temporary bit
+ *             file
+ */
+void run_write_bitfile (bench_state state)
+{
+    write_bitfile_fd(fileno(state -> bit_file), state -> methods,
+                     state -> words);
+}
+
+/*
+ * retire_write_bitfile (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the codewords
+ */
+void retire_write_bitfile (bench_state state)
+{
+    state -> methods -> free(&state -> words);
+}
+
+/*
+ * prepare_read_bitfile (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's codewords and rewinds the bit file
+ */
+void prepare_read_bitfile (bench_state state)
+{
+    if (state -> decoded_words != NULL) {
+        state -> methods -> free(&state -> decoded_words);
+    }
+    rewind(state -> bit_file);
+}
+
+/*
+ * run_read_bitfile (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times read_bitfile: the temporary bit file back into codewords
+ */
+void run_read_bitfile (bench_state state)
+{
+    state -> decoded_words = read_bitfile(state -> bit_file,
+                                          state -> methods);
+}
+
+/*
+ * prepare_bitmap_unpack (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's quantized values
+ */
+void prepare_bitmap_unpack (bench_state state)
+{
+    if (state -> decoded_dct != NULL) {
+        plane_set_free(&state -> decoded_dct);
+    }
+}
+
+/*
+ * run_bitmap_unpack (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times bitmap_unpack: the codewords into quantized values
+ */
+void run_bitmap_unpack (bench_state state)
+{
+    state -> decoded_dct = bitmap_unpack(state -> methods,
+                                         state -> decoded_words);
+}
+
+/*
+ * retire_bitmap_unpack (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the codewords read back
+ */
+void retire_bitmap_unpack (bench_state state)
+{
+    state -> methods -> free(&state -> decoded_words);
+}
+
+/*
+ * prepare_quantize_d (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Saves the quantized values on the first run and restores them
+ *             on later ones, since quantize_d works in place
+ */
+void prepare_quantize_d (bench_state state)
+{
+    save_planes(&state -> decoded_dct_saved, state -> decoded_dct);
+}
+
+/*
+ * run_quantize_d (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times quantize_d: the quantized values back into transform
+ *             values, in place
+ */
+void run_quantize_d (bench_state state)
+{
+    quantize_d(state -> decoded_dct);
+}
+
+/*
+ * prepare_dct_to_ypp (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's planes
+ */
+void prepare_dct_to_ypp (bench_state state)
+{
+    if (state -> decoded_ypp != NULL) {
+        plane_set_free(&state -> decoded_ypp);
+    }
+}
+
+/*
+ * run_dct_to_ypp (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times dct_to_ypp: the transform values back into y, pb, and pr
+ *             planes
+ */
+void run_dct_to_ypp (bench_state state)
+{
+    state -> decoded_ypp = dct_to_ypp(state -> decoded_dct);
+}
+
+/*
+ * retire_dct_to_ypp (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the transform values and their saved copy
+ */
+void retire_dct_to_ypp (bench_state state)
+{
+    plane_set_free(&state -> decoded_dct);
+    plane_set_free(&state -> decoded_dct_saved);
+}
+
+/*
+ * prepare_ypp_to_rgb (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the previous run's pixels
+ */
+void prepare_ypp_to_rgb (bench_state state)
+{
+    if (state -> pixels != NULL) {
+        state -> methods -> free(&state -> pixels);
+    }
+}
+
+/*
+ * run_ypp_to_rgb (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times ypp_to_rgb: the planes back into an array of Pnm_rgbs
+ */
+void run_ypp_to_rgb (bench_state state)
+{
+    state -> pixels = ypp_to_rgb(state -> decoded_ypp, state -> methods);
+}
+
+/*
+ * retire_ypp_to_rgb (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the decoded planes
+ */
+void retire_ypp_to_rgb (bench_state state)
+{
+    plane_set_free(&state -> decoded_ypp);
+}
+
+/*
+ * run_write_ppm (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times write_ppm_to: the pixels to /dev/null, flushed so every
+ *             byte is written
+ */
+void run_write_ppm (bench_state state)
+{
+    struct Pnm_ppm pixmap = {
+        .width       = state -> methods -> width(state -> pixels),
+        .height      = state -> methods -> height(state -> pixels),
+        .denominator = DENOMINATOR,
+        .pixels      = state -> pixels,
+        .methods     = state -> methods
+    };
+    write_ppm_to(state -> null_file, &pixmap);
+    fflush(state -> null_file);
+}
+
+/*
+ * retire_write_ppm (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Frees the pixels
+ */
+void retire_write_ppm (bench_state state)
+{
+    state -> methods -> free(&state -> pixels);
+}
+
+/*
+ * prepare_compress40 (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Empties the temporary bit file and rewinds the ppm file on disk
+ */
+void prepare_compress40 (bench_state state)
+{
+    prepare_write_bitfile(state);
+    rewind(state -> ppm_disk);
+}
+
+/*
+ * run_compress40 (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times compress40_image: the ppm file on disk to the bit file,
+ *             mapped and banded as 40image -c does it
+ */
+void run_compress40 (bench_state state)
+{
+    compress40_image(state -> context, state -> ppm_disk,
+                     fileno(state -> bit_file));
+}
+
+/*
+ * prepare_decompress40 (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Rewinds the bit file compress40 wrote
+ */
+void prepare_decompress40 (bench_state state)
+{
+    rewind(state -> bit_file);
+}
+
+/*
+ * run_decompress40 (bench_state state)
+ *
+ * Parameters: bench_state state: the stages' shared state
+ * Returns   : Nothing
+ * Does      : Times decompress40_image: that bit file to packed rows written
+ *             to /dev/null, flushed, as 40image -d does it
+ */
+void run_decompress40 (bench_state state)
+{
+    decompress40_image(state -> context, state -> bit_file,
+                       state -> null_file);
+    fflush(state -> null_file);
+}
+
+/*
+ * read_input (const char *path)
+ *
+ * Parameters: const char *path: path of a ppm file
+ * Returns   : input: the file's bytes, named after the file
+ * Does      : Reads the whole file into memory
+ */
+input read_input (const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "bench40: cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    input image = malloc(sizeof(*image));
+    assert(image != NULL);
+
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    assert(length >= 0);
+    rewind(fp);
+    image -> length = length;
+    image -> bytes  = malloc(length > 0 ? length : 1);
+    assert(image -> bytes != NULL);
+    size_t got = fread(image -> bytes, 1, length, fp);
+    assert(got == (size_t) length);
+    fclose(fp);
+
+    const char *name = strrchr(path, '/');
+    name = name != NULL ? name + 1 : path;
+    image -> name = malloc(strlen(name) + 1);
+    assert(image -> name != NULL);
+    strcpy(image -> name, name);
+    return image;
+}
+
+/*
+ * synthetic_input (const char *size)
+ *
+ * Parameters: const char *size: WxH, the width and height in pixels
+ * Returns   : input: the bytes of a binary ppm of that size, named
+ *                    synthetic-WxH, or NULL if size is malformed
+ * Does      : Fills the image with smooth gradients plus a little noise
+ *             from a fixed seed, so every run and version codes the same
+ *             pixels and the transform sees photo-like detail
+ */
+input synthetic_input (const char *size)
+{
+    int width, height;
+    char extra;
+    if (sscanf(size, "%dx%d%c", &width, &height, &extra) != 2 ||
+        width < 2 || height < 2) {
+        return NULL;
+    }
+
+    input image = malloc(sizeof(*image));
+    assert(image != NULL);
+    char header[64];
+    int header_length = snprintf(header, sizeof(header), "P6\n%d %d\n%d\n",
+                                 width, height, DENOMINATOR);
+    image -> length = header_length + (size_t) width * height * 3;
+    image -> bytes  = malloc(image -> length);
+    assert(image -> bytes != NULL);
+    memcpy(image -> bytes, header, header_length);
+
+    uint32_t seed = 2463534242u;
+    unsigned char *pixel = image -> bytes + header_length;
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++, pixel += 3) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            int noise = (int) (seed & 15) - 8;
+            int red   = i * 200 / width + noise + 20,
+                green = j * 200 / height + noise + 20,
+                blue  = (i + j) * 100 / (width + height) + noise + 80;
+            pixel[0] = red;
+            pixel[1] = green;
+            pixel[2] = blue;
+        }
+    }
+
+    image -> name = malloc(strlen("synthetic-") + strlen(size) + 1);
+    assert(image -> name != NULL);
+    sprintf(image -> name, "synthetic-%s", size);
+    return image;
+}
+
+/*
+ * free_input (input *image)
+ *
+ * Parameters: input *image: pointer to the input to free
+ * Returns   : Nothing
+ * Does      : Frees the input's bytes, name, and the input, and sets it to
+ *             NULL
+ */
+void free_input (input *image)
+{
+    assert(image != NULL && *image != NULL);
+    free((*image) -> bytes);
+    free((*image) -> name);
+    free(*image);
+    *image = NULL;
+}
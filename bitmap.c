@@ -5,9 +5,9 @@
  * Assignment: Arith
  * Summary   : Functions in this file help map through the UArray2 of
  *             codewords, either packing them via bitpack.h from the 
- *             a, b, c, d, avg pb, and avg pr values in our array of
- *             dctrans structs, or unpacking the codewords and transforming
- *             them back into dctrans structs via bitpack.h
+ *             a, b, c, d, avg pb, and avg pr values in our transform
+ *             planes, or unpacking the codewords and transforming them
+ *             back into transform planes via bitpack.h
  */
 
 
@@ -28,158 +28,183 @@
 #define W_BCD 6
 #define W_PBPR 4
 
-/* struct containing discrete cosine information */
-typedef struct dctrans {
-             
-    float avgpb,
-          avgpr,
-          a,
-          b,
-          c,
-          d;
-
-} *dctrans;
-
-/* closure struct containing a 2D array representation of the image
- * and the proper method suite */
-typedef struct closure_struct {
-
-    A2Methods_UArray2 array2;
-    A2Methods_T methods;
-
-} *closure_struct;
-
-void pack_words(int i, int j, A2Methods_UArray2 array2, A2Methods_Object *ptr,
-                void *cl);
-void unpack_words(int i, int j, A2Methods_UArray2 array2, 
-                  A2Methods_Object *ptr, void *cl);
+void pack_word (plane_set dct_rep, int i, int j, UNSIGNED_T *word);
+void unpack_word (UNSIGNED_T word, plane_set dct_rep, int i, int j);
+UNSIGNED_T *word_row (A2Methods_T methods, A2Methods_UArray2 words,
+                      int row);
 
 /*
- * bitmap_pack (A2Methods_T methods, A2Methods_UArray2 array2)
+ * bitmap_pack (A2Methods_T methods, plane_set dct_rep)
  * 
- * Parameters: A2Methods_UArray2 array2: array of dctrans structs
- *             A2Methods_T methods: methods for UArray2
+ * Parameters: A2Methods_T methods: methods for the new UArray2
+ *             plane_set dct_rep: planes of scaled transform values
  * Returns   : A2Methods_UArray2: array of codewords
- * Does      : maps through an array of scaled dctrans structs, uses functions 
- *             from bitpack.h to pack a codeword for each, and returns an
- *             array of those codewords
+ * Does      : packs every codeword of a new array from the scaled values
+ *             at the same place in the planes, and returns the array
  */
-A2Methods_UArray2 bitmap_pack (A2Methods_T methods, A2Methods_UArray2 array2)
+A2Methods_UArray2 bitmap_pack (A2Methods_T methods, plane_set dct_rep)
 {
-    assert(array2 != NULL);
+    assert(dct_rep != NULL);
     assert(methods != NULL);
-    A2Methods_UArray2 word_map = methods -> new(methods -> width(array2), 
-                                                methods -> height(array2),
+    A2Methods_UArray2 word_map = methods -> new(dct_rep -> width, 
+                                                dct_rep -> height,
                                                 sizeof(UNSIGNED_T));
-    closure_struct cl = malloc(sizeof(*cl));
-    assert(cl != NULL);
-    cl -> array2 = word_map;
-    cl -> methods = methods;
-
-    methods -> map_row_major(array2, pack_words, cl);
 
-    free(cl);
+    bitmap_pack_rows(methods, dct_rep, word_map, 0);
 
     return word_map;
 }
 
 /*
- * pack_words (int i, int j, A2Methods_UArray2 array2, A2Methods_Object *ptr, 
- *                                                     void *cl)
- * Parameters: int i: index of column
- *             int j: index of row
- *             A2Methods_UArray2 array2: array of dctrans structs
- *             A2Methods_Object *ptr: the dctrans struct at the 
- *                                    current index
- *             void *cl: closure struct holding the array of codewords
- *                       and the methods for that array
+ * bitmap_pack_rows (A2Methods_T methods, plane_set dct_rep,
+ *                   A2Methods_UArray2 words, int first_row)
+ * 
+ * Parameters: A2Methods_T methods: methods for words
+ *             plane_set dct_rep: planes of scaled transform values
+ *             A2Methods_UArray2 words: array of codewords to fill
+ *             int first_row: row of words that the planes' top row packs
  * Returns   : None
- * Does      : apply function called in map_row_major which calls functions
- *             from bitpack.h to do the actual packing of each codeword from
- *             a dctrans struct 
+ * Does      : packs the codewords of words covered by the planes, from
+ *             first_row down, so an image can be packed a band at a time
  */
-void pack_words(int i, int j, A2Methods_UArray2 array2, A2Methods_Object *ptr, 
-                                                        void *cl)
+void bitmap_pack_rows (A2Methods_T methods, plane_set dct_rep,
+                       A2Methods_UArray2 words, int first_row)
 {
-    (void) array2;
-
-    closure_struct cl_struct = (closure_struct) cl;
-    dctrans dct = (dctrans) ptr;
+    assert(methods != NULL && dct_rep != NULL && words != NULL);
+    assert(dct_rep -> width <= methods -> width(words));
+    assert(first_row >= 0 &&
+           first_row + dct_rep -> height <= methods -> height(words));
+
+    for (int j = 0; j < dct_rep -> height; j++) {
+        UNSIGNED_T *row = word_row(methods, words, first_row + j);
+        for (int i = 0; i < dct_rep -> width; i++) {
+            pack_word(dct_rep, i, j, row != NULL ? &row[i] :
+                      methods -> at(words, i, first_row + j));
+        }
+    }
+}
 
-    UNSIGNED_T *word = (UNSIGNED_T *)(cl_struct -> methods -> 
-                                                   at(cl_struct -> array2, 
-                                                      i, 
-                                                      j));
+/*
+ * pack_word (plane_set dct_rep, int i, int j, UNSIGNED_T *word)
+ *
+ * Parameters: plane_set dct_rep: the plane_set of scaled transform values
+ *             int i: index of column
+ *             int j: index of row
+ *             UNSIGNED_T *word: the codeword to fill
+ * Returns   : None
+ * Does      : calls functions from bitpack.h to do the actual packing of
+ *             the codeword from the values of its block
+ */
+void pack_word (plane_set dct_rep, int i, int j, UNSIGNED_T *word)
+{
     /* pack the word with each separate value at its proper location */
-    *word = Bitpack_newu(*word, W_A, LSB_A, dct -> a);
-    *word = Bitpack_news(*word, W_BCD, LSB_B, dct -> b);
-    *word = Bitpack_news(*word, W_BCD, LSB_C, dct -> c);
-    *word = Bitpack_news(*word, W_BCD, LSB_D, dct -> d);
-    *word = Bitpack_newu(*word, W_PBPR, LSB_PB, dct -> avgpb);
-    *word = Bitpack_newu(*word, W_PBPR, LSB_PR, dct -> avgpr);
+    *word = 0;
+    *word = Bitpack_newu(*word, W_A, LSB_A,
+                         plane_row(dct_rep, A_PLANE, j)[i]);
+    *word = Bitpack_news(*word, W_BCD, LSB_B,
+                         plane_row(dct_rep, B_PLANE, j)[i]);
+    *word = Bitpack_news(*word, W_BCD, LSB_C,
+                         plane_row(dct_rep, C_PLANE, j)[i]);
+    *word = Bitpack_news(*word, W_BCD, LSB_D,
+                         plane_row(dct_rep, D_PLANE, j)[i]);
+    *word = Bitpack_newu(*word, W_PBPR, LSB_PB,
+                         plane_row(dct_rep, AVGPB_PLANE, j)[i]);
+    *word = Bitpack_newu(*word, W_PBPR, LSB_PR,
+                         plane_row(dct_rep, AVGPR_PLANE, j)[i]);
 }
 
 /*
- * bitmap_unpack (A2Methods_UArray2 methods, A2Methods_T array2)
+ * bitmap_unpack (A2Methods_T methods, A2Methods_UArray2 array2)
  * 
- * Parameters: A2Methods_UArray2 array2: array of codewords
- *             A2Methods_T methods: methods for UArray2
- * Returns   : A2Methods_UArray2: array of scaled dctrans structs
- * Does      : maps through an array of codewords, uses functions from
- *             bitpack.h to get the values for a, b, c, d, avg pb, and avg 
- *             pr, from each codeword, and returns an array of those
- *             dctrans structs
+ * Parameters: A2Methods_T methods: methods for UArray2
+ *             A2Methods_UArray2 array2: array of codewords
+ * Returns   : plane_set: planes of scaled transform values
+ * Does      : uses functions from bitpack.h to get the values for a, b, c,
+ *             d, avg pb, and avg pr from each codeword, and returns planes
+ *             of those values
  */
-A2Methods_UArray2 bitmap_unpack(A2Methods_T methods, A2Methods_UArray2 array2)
+plane_set bitmap_unpack(A2Methods_T methods, A2Methods_UArray2 array2)
 {
     assert(array2 != NULL);
     assert(methods != NULL);
-    A2Methods_UArray2 dct_rep = methods -> new(methods -> width(array2), 
-                                               methods -> height(array2),
-                                               sizeof(struct dctrans));
-    closure_struct cl = malloc(sizeof(*cl));
-    assert(cl != NULL);
-    cl -> array2 = dct_rep;
-    cl -> methods = methods;
+    plane_set dct_rep = plane_set_new(methods -> width(array2), 
+                                      methods -> height(array2),
+                                      NUM_DCT_PLANES);
 
-    methods -> map_row_major(array2, unpack_words, cl);
-
-    free(cl);
+    bitmap_unpack_rows(methods, array2, 0, dct_rep);
 
     return dct_rep;
 }
 
 /*
- * unpack_words(int i, int j, A2Methods_UArray2 array2, A2Methods_Object *ptr, 
- *                                                      void *cl)
+ * bitmap_unpack_rows (A2Methods_T methods, A2Methods_UArray2 words,
+ *                     int first_row, plane_set dct_rep)
  * 
- * Parameters: int i: index of column
- *             int j: index of row
- *             A2Methods_UArray2 array2: array of codewords
- *             A2Methods_Object *ptr: the codeword at the current index
- *             void *cl: closure struct holding the array of dctrans structs
- *                       and the methods for that array
+ * Parameters: A2Methods_T methods: methods for words
+ *             A2Methods_UArray2 words: array of codewords
+ *             int first_row: row of words that fills the planes' top row
+ *             plane_set dct_rep: planes of scaled transform values to fill
  * Returns   : None
- * Does      : apply function called in map_row_major which calls functions
- *             from bitpack.h to do the actual unpacking of each codeword and
- *             setting a, b, c, d, avg pb, and avg pr to the corresponding
- *             values at each field in the codeword
+ * Does      : the inverse of bitmap_pack_rows
  */
-void unpack_words(int i, int j, A2Methods_UArray2 array2, 
-                  A2Methods_Object *ptr, void *cl)
+void bitmap_unpack_rows (A2Methods_T methods, A2Methods_UArray2 words,
+                         int first_row, plane_set dct_rep)
 {
-    (void) array2;
-
-    closure_struct cl_struct = (closure_struct) cl;
-    UNSIGNED_T *word = (UNSIGNED_T *) ptr;
+    assert(methods != NULL && words != NULL && dct_rep != NULL);
+    assert(dct_rep -> width <= methods -> width(words));
+    assert(first_row >= 0 &&
+           first_row + dct_rep -> height <= methods -> height(words));
+
+    for (int j = 0; j < dct_rep -> height; j++) {
+        UNSIGNED_T *row = word_row(methods, words, first_row + j);
+        for (int i = 0; i < dct_rep -> width; i++) {
+            unpack_word(row != NULL ? row[i] : *(UNSIGNED_T *)
+                        methods -> at(words, i, first_row + j),
+                        dct_rep, i, j);
+        }
+    }
+}
 
-    dctrans dct = (dctrans)(cl_struct -> methods -> at(cl_struct -> array2, 
-                                                              i, j));
+/*
+ * unpack_word (UNSIGNED_T word, plane_set dct_rep, int i, int j)
+ * 
+ * Parameters: UNSIGNED_T word: a codeword
+ *             plane_set dct_rep: the plane_set of transform values to fill
+ *             int i: index of column
+ *             int j: index of row
+ * Returns   : None
+ * Does      : calls functions from bitpack.h to do the actual unpacking of
+ *             the codeword, setting a, b, c, d, avg pb, and avg pr to the
+ *             values of its fields
+ */
+void unpack_word (UNSIGNED_T word, plane_set dct_rep, int i, int j)
+{
     /* extract each value separately from the compressed codeword */
-    dct -> a = Bitpack_getu(*word, W_A, LSB_A);
-    dct -> b = Bitpack_gets(*word, W_BCD, LSB_B);
-    dct -> c = Bitpack_gets(*word, W_BCD, LSB_C);
-    dct -> d = Bitpack_gets(*word, W_BCD, LSB_D);
-    dct -> avgpb = Bitpack_getu(*word, W_PBPR, LSB_PB);
-    dct -> avgpr = Bitpack_getu(*word, W_PBPR, LSB_PR);                                             
-}
\ No newline at end of file
+    plane_row(dct_rep, A_PLANE, j)[i] = Bitpack_getu(word, W_A, LSB_A);
+    plane_row(dct_rep, B_PLANE, j)[i] = Bitpack_gets(word, W_BCD, LSB_B);
+    plane_row(dct_rep, C_PLANE, j)[i] = Bitpack_gets(word, W_BCD, LSB_C);
+    plane_row(dct_rep, D_PLANE, j)[i] = Bitpack_gets(word, W_BCD, LSB_D);
+    plane_row(dct_rep, AVGPB_PLANE, j)[i] = Bitpack_getu(word, W_PBPR,
+                                                         LSB_PB);
+    plane_row(dct_rep, AVGPR_PLANE, j)[i] = Bitpack_getu(word, W_PBPR,
+                                                         LSB_PR);
+}
+
+/*
+ * word_row (A2Methods_T methods, A2Methods_UArray2 words, int row)
+ *
+ * Parameters: A2Methods_T methods: methods for words
+ *             A2Methods_UArray2 words: array of codewords
+ *             int row: a row of words
+ * Returns   : UNSIGNED_T *: the row's first codeword, or NULL if the
+ *                           array's rows are not contiguous
+ * Does      : lets the loops above index contiguous rows directly and fall
+ *             back to at() for any other layout
+ */
+UNSIGNED_T *word_row (A2Methods_T methods, A2Methods_UArray2 words, int row)
+{
+    if (methods -> blocksize(words) != 1 || methods -> width(words) == 0) {
+        return NULL;
+    }
+    return methods -> at(words, 0, row);
+}
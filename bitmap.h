@@ -4,8 +4,8 @@
  * Assignment: Arith
  * Summary: Functions in this file help map through the UArray2 of codewords,
  *          either packing them via bitpack.h from the a, b, c, d, avg pb, 
- *          and avg pr values in our array of dctrans structs, or unpacking
- *          the codewords and transforming them back into dctrans structs via
+ *          and avg pr values in our transform planes, or unpacking the
+ *          codewords and transforming them back into transform planes via
  *          bitpack.h
  * Invariants: 
  *              
@@ -17,6 +17,7 @@
 #include "bitpack.h"
 #include "uarray2.h"
 #include "quantization.h"
+#include "plane_set.h"
 #include "assert.h"
 #include <malloc.h>
 #include "a2methods.h"
@@ -25,21 +26,43 @@
 /*
  * bitmap_pack
  *
- * packs each discrete cosine element from the given 2D array into a 32 bit 
+ * packs each block of the given discrete cosine planes into a 32 bit 
  * codeword according to the desired specifications
  * 
  * assumes the arguments are not NULL
  */
-A2Methods_UArray2 bitmap_pack(A2Methods_T methods, A2Methods_UArray2 array2);
+A2Methods_UArray2 bitmap_pack(A2Methods_T methods, plane_set dct_rep);
+
+/*
+ * bitmap_pack_rows
+ *
+ * packs each block of the given planes into the codeword at the same
+ * column of words, the planes' top row going to first_row
+ * 
+ * assumes no argument is NULL and the planes fit inside words there
+ */
+void bitmap_pack_rows(A2Methods_T methods, plane_set dct_rep,
+                      A2Methods_UArray2 words, int first_row);
 
 /*
  * bitmap_unpack
  *
  * obtains each individual value in the compressed codeword separately and
- * returns a 2D array of containing the discrete cosine transformation elements
+ * returns planes containing the discrete cosine transformation elements
  * 
  * assumes the arguments are not NULL
  */
-A2Methods_UArray2 bitmap_unpack(A2Methods_T methods, A2Methods_UArray2 array2);
+plane_set bitmap_unpack(A2Methods_T methods, A2Methods_UArray2 array2);
+
+/*
+ * bitmap_unpack_rows
+ *
+ * fills the given planes from the codewords of words starting at
+ * first_row, as many as the planes hold
+ * 
+ * assumes no argument is NULL and the planes fit inside words there
+ */
+void bitmap_unpack_rows(A2Methods_T methods, A2Methods_UArray2 words,
+                        int first_row, plane_set dct_rep);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,355 @@
+/*
+ * Filename  : buffer40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the buffer40.h interface. Every argument is
+ *             checked before the codec sees it, so the codec's own
+ *             assertions are never what reports a caller's mistake. The
+ *             header and the big endian codewords are written and parsed
+ *             here rather than with read_bitfile.c, whose functions are
+ *             built around stdio and file descriptors
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "buffer40.h"
+
+#define MAGIC "COMP40 Compressed image format 2\n"
+#define CODEWORD_BYTES 4 /* bytes of each codeword in a compressed image */
+#define MAX_DENOMINATOR 255 /* largest sample packed pixels can hold */
+
+size_t write_header (unsigned char *bits, unsigned width, unsigned height);
+size_t write_unsigned (unsigned char *bits, unsigned value);
+size_t read_header (const unsigned char *bits, size_t length, int *width,
+                                                              int *height);
+size_t read_dimension (const unsigned char *bits, size_t length,
+                       size_t at, int *value);
+void pack_codewords (A2Methods_T methods, A2Methods_UArray2 words,
+                                          unsigned char *bits);
+void unpack_codewords (A2Methods_T methods, const unsigned char *bits,
+                                            A2Methods_UArray2 words);
+
+/*
+ * buffer40_encoded_size (int width, int height)
+ *
+ * Parameters: int width, height: size of the image in pixels
+ * Returns   : size_t: bytes of the compressed image, or 0 if either size is
+ *                     negative
+ * Does      : Adds the header's length to 4 bytes per 2x2 block
+ */
+size_t buffer40_encoded_size (int width, int height)
+{
+    if (width < 0 || height < 0) {
+        return 0;
+    }
+    width  -= width % 2;
+    height -= height % 2;
+    return write_header(NULL, width, height) +
+           (size_t) (width / 2) * (height / 2) * CODEWORD_BYTES;
+}
+
+/*
+ * buffer40_decoded_size (const unsigned char *bits, size_t length,
+ *                        int *width, int *height)
+ *
+ * Parameters: const unsigned char *bits: a compressed image
+ *             size_t length: bytes of the compressed image
+ *             int *width, *height: set to the size of the image in pixels
+ * Returns   : size_t: bytes of the image's packed pixels, or 0 if the
+ *                     compressed image is malformed
+ * Does      : Parses the header and checks that every codeword is there
+ */
+size_t buffer40_decoded_size (const unsigned char *bits, size_t length,
+                              int *width, int *height)
+{
+    assert(bits != NULL && width != NULL && height != NULL);
+    if (read_header(bits, length, width, height) == 0) {
+        return 0;
+    }
+    return (size_t) *width * *height * 3;
+}
+
+/*
+ * buffer40_encode (codec40_context context, const unsigned char *pixels,
+ *                  size_t stride, int width, int height,
+ *                  unsigned denominator, unsigned char *bits,
+ *                  size_t capacity)
+ *
+ * Parameters: codec40_context context: the context to code with, or NULL
+ *             const unsigned char *pixels: first sample of the top row
+ *             size_t stride: bytes from the start of one row to the next
+ *             int width, height: size of the image in pixels
+ *             unsigned denominator: denominator used to scale rgb values
+ *             unsigned char *bits: where the compressed image goes
+ *             size_t capacity: bytes available at bits
+ * Returns   : size_t: bytes written, or 0 if an argument is unusable
+ * Does      : Encodes the even part of the image straight from the bytes,
+ *             then writes the header and codewords into bits
+ */
+size_t buffer40_encode (codec40_context context, const unsigned char *pixels,
+                        size_t stride, int width, int height,
+                        unsigned denominator, unsigned char *bits,
+                        size_t capacity)
+{
+    assert(pixels != NULL && bits != NULL);
+    size_t size = buffer40_encoded_size(width, height);
+    if (size == 0 || capacity < size || stride < (size_t) width * 3 ||
+        denominator < 1 || denominator > MAX_DENOMINATOR) {
+        return 0;
+    }
+    width  -= width % 2;
+    height -= height % 2;
+
+    size_t header = write_header(bits, width, height);
+    if (width == 0 || height == 0) { /* nothing to encode */
+        return header;
+    }
+
+    codec40_context own = context == NULL ?
+                          codec40_context_new(uarray2_methods_plain) : NULL;
+    codec40_context used = context != NULL ? context : own;
+    A2Methods_T methods = codec40_methods(used);
+
+    A2Methods_UArray2 words = codec40_encode_rgb8(used, pixels, stride,
+                                                  width, height,
+                                                  denominator);
+    pack_codewords(methods, words, bits + header);
+    methods -> free(&words);
+
+    if (own != NULL) {
+        codec40_context_free(&own);
+    }
+    return size;
+}
+
+/*
+ * buffer40_decode (codec40_context context, const unsigned char *bits,
+ *                  size_t length, unsigned char *pixels, size_t stride,
+ *                  size_t capacity)
+ *
+ * Parameters: codec40_context context: the context to code with, or NULL
+ *             const unsigned char *bits: a compressed image
+ *             size_t length: bytes of the compressed image
+ *             unsigned char *pixels: first sample of the top row to fill
+ *             size_t stride: bytes from the start of one row to the next
+ *             size_t capacity: bytes available at pixels
+ * Returns   : bool: false if the image is malformed or does not fit
+ * Does      : Parses and checks the header, unpacks the codewords, and
+ *             decodes them straight into the packed rows
+ */
+bool buffer40_decode (codec40_context context, const unsigned char *bits,
+                      size_t length, unsigned char *pixels, size_t stride,
+                      size_t capacity)
+{
+    assert(bits != NULL && pixels != NULL);
+    int width, height;
+    size_t header = read_header(bits, length, &width, &height);
+    if (header == 0 || stride < (size_t) width * 3) {
+        return false;
+    }
+    if (width == 0 || height == 0) { /* nothing to decode */
+        return true;
+    }
+    if ((height - 1) * stride + (size_t) width * 3 > capacity) {
+        return false;
+    }
+
+    codec40_context own = context == NULL ?
+                          codec40_context_new(uarray2_methods_plain) : NULL;
+    codec40_context used = context != NULL ? context : own;
+    A2Methods_T methods = codec40_methods(used);
+
+    A2Methods_UArray2 words = methods -> new(width / 2, height / 2,
+                                             sizeof(uint64_t));
+    unpack_codewords(methods, bits + header, words);
+    codec40_decode_rgb8(used, words, pixels, stride);
+    methods -> free(&words);
+
+    if (own != NULL) {
+        codec40_context_free(&own);
+    }
+    return true;
+}
+
+/*
+ * write_header (unsigned char *bits, unsigned width, unsigned height)
+ *
+ * Parameters: unsigned char *bits: where the header goes, or NULL to only
+ *                                  measure it
+ *             unsigned width, height: size of the image in pixels
+ * Returns   : size_t: bytes of the header
+ * Does      : Writes the same header write_bitfile does
+ */
+size_t write_header (unsigned char *bits, unsigned width, unsigned height)
+{
+    size_t n = sizeof(MAGIC) - 1;
+    if (bits != NULL) {
+        memcpy(bits, MAGIC, n);
+    }
+    n += write_unsigned(bits != NULL ? bits + n : NULL, width);
+    if (bits != NULL) {
+        bits[n] = ' ';
+    }
+    n++;
+    n += write_unsigned(bits != NULL ? bits + n : NULL, height);
+    if (bits != NULL) {
+        bits[n] = '\n';
+    }
+    return n + 1;
+}
+
+/*
+ * write_unsigned (unsigned char *bits, unsigned value)
+ *
+ * Parameters: unsigned char *bits: where the digits go, or NULL to only
+ *                                  count them
+ *             unsigned value: the number to write
+ * Returns   : size_t: number of digits
+ * Does      : Writes value in decimal, most significant digit first
+ */
+size_t write_unsigned (unsigned char *bits, unsigned value)
+{
+    size_t digits = 1;
+    for (unsigned rest = value / 10; rest > 0; rest /= 10) {
+        digits++;
+    }
+    if (bits != NULL) {
+        for (size_t i = digits; i > 0; i--, value /= 10) {
+            bits[i - 1] = '0' + value % 10;
+        }
+    }
+    return digits;
+}
+
+/*
+ * read_header (const unsigned char *bits, size_t length, int *width,
+ *                                                        int *height)
+ *
+ * Parameters: const unsigned char *bits: a compressed image
+ *             size_t length: bytes of the compressed image
+ *             int *width, *height: set to the size of the image in pixels
+ * Returns   : size_t: bytes of the header, or 0 if it is malformed, gives
+ *                     an odd size, or is followed by too few codewords
+ * Does      : Matches the header the way read_bitfile_header's fscanf
+ *             does: the first line exactly, then two numbers separated by
+ *             whitespace, then one newline
+ */
+size_t read_header (const unsigned char *bits, size_t length, int *width,
+                                                              int *height)
+{
+    size_t at = sizeof(MAGIC) - 1;
+    if (length < at || memcmp(bits, MAGIC, at) != 0) {
+        return 0;
+    }
+    at = read_dimension(bits, length, at, width);
+    if (at == 0) {
+        return 0;
+    }
+    at = read_dimension(bits, length, at, height);
+    if (at == 0 || at >= length || bits[at] != '\n') {
+        return 0;
+    }
+    at++;
+
+    size_t blocks_wide = *width / 2,
+           blocks_high = *height / 2;
+    if (*width % 2 != 0 || *height % 2 != 0) {
+        return 0;
+    }
+    if (blocks_wide > 0 &&
+        (length - at) / CODEWORD_BYTES / blocks_wide < blocks_high) {
+        return 0;
+    }
+    return at;
+}
+
+/*
+ * read_dimension (const unsigned char *bits, size_t length, size_t at,
+ *                                                            int *value)
+ *
+ * Parameters: const unsigned char *bits: a compressed image
+ *             size_t length: bytes of the compressed image
+ *             size_t at: where to start reading
+ *             int *value: set to the number read
+ * Returns   : size_t: index just past the number, or 0 if there is no
+ *                     number or it does not fit in an int
+ * Does      : Skips whitespace, then reads decimal digits
+ */
+size_t read_dimension (const unsigned char *bits, size_t length,
+                       size_t at, int *value)
+{
+    while (at < length && (bits[at] == ' ' || bits[at] == '\t' ||
+                           bits[at] == '\n' || bits[at] == '\r')) {
+        at++;
+    }
+    if (at == length || bits[at] < '0' || bits[at] > '9') {
+        return 0;
+    }
+
+    long number = 0;
+    for (; at < length && bits[at] >= '0' && bits[at] <= '9'; at++) {
+        number = number * 10 + (bits[at] - '0');
+        if (number > INT_MAX) {
+            return 0;
+        }
+    }
+    *value = number;
+    return at;
+}
+
+/*
+ * pack_codewords (A2Methods_T methods, A2Methods_UArray2 words,
+ *                                      unsigned char *bits)
+ *
+ * Parameters: A2Methods_T methods: method suite for words
+ *             A2Methods_UArray2 words: array of codewords
+ *             unsigned char *bits: 4 bytes per codeword to fill
+ * Returns   : Nothing
+ * Does      : Stores the low 32 bits of each codeword big endian, in row
+ *             major order
+ */
+void pack_codewords (A2Methods_T methods, A2Methods_UArray2 words,
+                                          unsigned char *bits)
+{
+    int width  = methods -> width(words),
+        height = methods -> height(words);
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++, bits += CODEWORD_BYTES) {
+            uint32_t codeword = *(uint64_t *) methods -> at(words, i, j);
+            bits[0] = codeword >> 24;
+            bits[1] = codeword >> 16;
+            bits[2] = codeword >> 8;
+            bits[3] = codeword;
+        }
+    }
+}
+
+/*
+ * unpack_codewords (A2Methods_T methods, const unsigned char *bits,
+ *                                        A2Methods_UArray2 words)
+ *
+ * Parameters: A2Methods_T methods: method suite for words
+ *             const unsigned char *bits: 4 bytes per codeword
+ *             A2Methods_UArray2 words: array of codewords to fill
+ * Returns   : Nothing
+ * Does      : The inverse of pack_codewords
+ */
+void unpack_codewords (A2Methods_T methods, const unsigned char *bits,
+                                            A2Methods_UArray2 words)
+{
+    int width  = methods -> width(words),
+        height = methods -> height(words);
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++, bits += CODEWORD_BYTES) {
+            *(uint64_t *) methods -> at(words, i, j) =
+                (uint32_t) bits[0] << 24 | (uint32_t) bits[1] << 16 |
+                (uint32_t) bits[2] << 8  | (uint32_t) bits[3];
+        }
+    }
+}
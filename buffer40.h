@@ -0,0 +1,83 @@
+/*
+ * Filename  : buffer40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Compresses and decompresses images held in memory, for
+ *             programs that link the codec (libcodec40.a) instead of
+ *             running 40image. Pixels are rows of packed 8-bit red, green,
+ *             blue samples with a caller-chosen stride; compressed images
+ *             are the same bytes 40image reads and writes. Nothing here
+ *             reads or writes a FILE, and the only state is in the
+ *             optional codec40_context, so separate threads can code at
+ *             once as long as each uses its own context. Unlike the rest of
+ *             the codec, bad input is reported by returning 0 or false
+ *             rather than raising an exception
+ */
+
+#ifndef BUFFER40_INCLUDED
+#define BUFFER40_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "codec40.h"
+
+/*
+ * buffer40_encoded_size
+ *
+ * returns the number of bytes buffer40_encode writes for a width by height
+ * image, or 0 if width or height is negative
+ */
+size_t buffer40_encoded_size (int width, int height);
+
+/*
+ * buffer40_decoded_size
+ *
+ * reads the header of the length bytes of a compressed image at bits,
+ * sets *width and *height to the size of the image, and returns the
+ * number of bytes its pixels take with a stride of 3 * width. Returns 0
+ * if the header is malformed or the codewords are cut short (and for an
+ * empty image, whose *width or *height is then 0)
+ *
+ * assumes no pointer is NULL
+ */
+size_t buffer40_decoded_size (const unsigned char *bits, size_t length,
+                              int *width, int *height);
+
+/*
+ * buffer40_encode
+ *
+ * compresses the width by height image at pixels, whose samples are at
+ * most denominator, into at most capacity bytes at bits. Like 40image,
+ * an odd last row or column is dropped. context may be NULL, in which
+ * case one is made for this image only
+ *
+ * returns the number of bytes written, or 0 if capacity is smaller than
+ * buffer40_encoded_size, stride is less than 3 * width, width or height is
+ * negative, or denominator is not from 1 to 255
+ *
+ * assumes pixels and bits are not NULL
+ */
+size_t buffer40_encode (codec40_context context, const unsigned char *pixels,
+                        size_t stride, int width, int height,
+                        unsigned denominator, unsigned char *bits,
+                        size_t capacity);
+
+/*
+ * buffer40_decode
+ *
+ * decompresses the length bytes of a compressed image at bits into rows of
+ * pixels with a denominator of 255, stride bytes apart, within capacity
+ * bytes. context may be NULL, in which case one is made for this image
+ * only
+ *
+ * returns false, writing nothing, if the compressed image is malformed or
+ * the pixels do not fit
+ *
+ * assumes bits and pixels are not NULL
+ */
+bool buffer40_decode (codec40_context context, const unsigned char *bits,
+                      size_t length, unsigned char *pixels, size_t stride,
+                      size_t capacity);
+
+#endif
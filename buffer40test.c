@@ -0,0 +1,347 @@
+/*
+ * Filename  : buffer40test.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Test of the in-memory codec in buffer40.c (make test). Codes
+ *             synthetic images of several sizes, odd ones included, both
+ *             through buffer40 and through compress40_image and
+ *             decompress40_image, the path 40image runs, and checks the
+ *             bytes are the same, with and without a context and with
+ *             padded strides. Then checks every documented 0 or false
+ *             return: negative sizes, too little room, too short a stride,
+ *             a denominator out of range, and a compressed image whose
+ *             header is malformed or whose codewords are cut short. Prints
+ *             each failure and exits with failure if there are any
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "assert.h"
+#include "buffer40.h"
+#include "image40.h"
+#include "a2plain.h"
+
+#define STRIDE_PADDING 5 /* extra bytes at the end of each padded row */
+#define PAD_BYTE 0xA5     /* fills padding and unwritten room */
+#define DENOMINATOR 255
+
+/* an image as rows of packed 8-bit samples */
+typedef struct image {
+
+    int width, height;
+    unsigned denominator;
+    size_t stride;
+    unsigned char *pixels;
+
+} *image;
+
+static int failures = 0;
+
+void check (bool ok, const char *what, int width, int height);
+image make_image (int width, int height, unsigned denominator,
+                                         size_t padding);
+void free_image (image *picture);
+unsigned char *file_bytes (FILE *fp, size_t *length);
+void check_round_trip (codec40_context context, int width, int height,
+                                                unsigned denominator);
+void check_errors (codec40_context context);
+
+/*
+ * main (void)
+ *
+ * Parameters: None
+ * Returns   : int: EXIT_SUCCESS if every check passed, else EXIT_FAILURE
+ * Does      : Runs the round trips over a spread of sizes, once without a
+ *             context and once with a shared one, then the error checks
+ */
+int main (void)
+{
+    const int sizes[][2] = {
+        { 2, 2 }, { 3, 3 }, { 1, 6 }, { 6, 1 }, { 16, 10 }, { 17, 9 },
+        { 31, 64 }, { 100, 76 }, { 257, 3 }
+    };
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    codec40_context context = codec40_context_new(uarray2_methods_plain);
+    for (int s = 0; s < nsizes; s++) {
+        check_round_trip(NULL, sizes[s][0], sizes[s][1], DENOMINATOR);
+        check_round_trip(context, sizes[s][0], sizes[s][1], DENOMINATOR);
+        check_round_trip(context, sizes[s][0], sizes[s][1], 100);
+    }
+    check_errors(context);
+    codec40_context_free(&context);
+
+    printf("buffer40test: %d failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * check (bool ok, const char *what, int width, int height)
+ *
+ * Parameters: bool ok: whether the check passed
+ *             const char *what: what was checked
+ *             int width, height: size of the image it was checked on
+ * Returns   : Nothing
+ * Does      : Prints and counts a failed check
+ */
+void check (bool ok, const char *what, int width, int height)
+{
+    if (!ok) {
+        fprintf(stderr, "%dx%d: %s\n", width, height, what);
+        failures++;
+    }
+}
+
+/*
+ * check_round_trip (codec40_context context, int width, int height,
+ *                                            unsigned denominator)
+ *
+ * Parameters: codec40_context context: context for buffer40, or NULL
+ *             int width, height: size of the image to code
+ *             unsigned denominator: the image's denominator
+ * Returns   : Nothing
+ * Does      : Compresses a synthetic image with buffer40_encode and with
+ *             compress40_image and compares the bits and the size
+ *             queries, then decompresses those bits with buffer40_decode
+ *             into padded rows and with decompress40_image and compares
+ *             the pixels, checking the padding is left alone
+ */
+void check_round_trip (codec40_context context, int width, int height,
+                                                unsigned denominator)
+{
+    image picture = make_image(width, height, denominator, STRIDE_PADDING);
+
+    /* what 40image makes of it, with a context of its own */
+    codec40_context own = codec40_context_new(uarray2_methods_plain);
+    FILE *ppm = tmpfile(),
+         *bit = tmpfile();
+    assert(ppm != NULL && bit != NULL);
+    fprintf(ppm, "P6\n%d %d\n%u\n", width, height, denominator);
+    for (int j = 0; j < height; j++) {
+        fwrite(picture -> pixels + j * picture -> stride, 1,
+               (size_t) width * 3, ppm);
+    }
+    fflush(ppm);
+    rewind(ppm);
+    compress40_image(own, ppm, fileno(bit));
+    size_t want_length;
+    unsigned char *want = file_bytes(bit, &want_length);
+
+    /* and what buffer40 makes of it */
+    size_t size = buffer40_encoded_size(width, height);
+    unsigned char *bits = malloc(size + 1);
+    assert(bits != NULL);
+    size_t written = buffer40_encode(context, picture -> pixels,
+                                     picture -> stride, width, height,
+                                     denominator, bits, size + 1);
+    check(written == size, "encode writes encoded_size bytes", width,
+                           height);
+    check(written == want_length && memcmp(bits, want, written) == 0,
+          "encode differs from compress40_image", width, height);
+
+    int decoded_width, decoded_height;
+    size_t decoded = buffer40_decoded_size(bits, written, &decoded_width,
+                                           &decoded_height);
+    int even_width  = width - width % 2,
+        even_height = height - height % 2;
+    check(decoded_width == even_width && decoded_height == even_height,
+          "decoded_size gives the even size", width, height);
+    check(decoded == (size_t) even_width * even_height * 3,
+          "decoded_size gives 3 bytes per pixel", width, height);
+
+    /* decode into padded rows, and compare with decompress40_image */
+    FILE *out = tmpfile();
+    assert(out != NULL);
+    rewind(bit);
+    decompress40_image(own, bit, out);
+    codec40_context_free(&own);
+    fflush(out);
+    size_t ppm_length;
+    unsigned char *ppm_bytes = file_bytes(out, &ppm_length);
+    char header[64];
+    int header_length = snprintf(header, sizeof(header), "P6\n%d %d\n%d\n",
+                                 even_width, even_height, DENOMINATOR);
+    check(ppm_length == header_length + decoded &&
+          memcmp(ppm_bytes, header, header_length) == 0,
+          "decompress40_image header", width, height);
+
+    size_t stride   = (size_t) even_width * 3 + STRIDE_PADDING,
+           capacity = stride * even_height;
+    unsigned char *rows = malloc(capacity + 1);
+    assert(rows != NULL);
+    memset(rows, PAD_BYTE, capacity + 1);
+    check(buffer40_decode(context, bits, written, rows, stride, capacity),
+          "decode into padded rows", width, height);
+    for (int j = 0; j < even_height && ppm_length == header_length +
+                                       decoded; j++) {
+        const unsigned char *row = rows + j * stride;
+        check(memcmp(row, ppm_bytes + header_length +
+                          (size_t) j * even_width * 3,
+                     (size_t) even_width * 3) == 0,
+              "decode differs from decompress40_image", width, height);
+        for (int k = 0; k < STRIDE_PADDING; k++) {
+            check(row[even_width * 3 + k] == PAD_BYTE,
+                  "decode writes past the row", width, height);
+        }
+    }
+
+    free(rows);
+    free(ppm_bytes);
+    free(bits);
+    free(want);
+    fclose(out);
+    fclose(bit);
+    fclose(ppm);
+    free_image(&picture);
+}
+
+/*
+ * check_errors (codec40_context context)
+ *
+ * Parameters: codec40_context context: context for buffer40
+ * Returns   : Nothing
+ * Does      : Checks each documented 0 or false return, and that a failed
+ *             decode writes nothing
+ */
+void check_errors (codec40_context context)
+{
+    int width = 16, height = 10;
+    image picture = make_image(width, height, DENOMINATOR, 0);
+    size_t size = buffer40_encoded_size(width, height);
+    unsigned char *bits = malloc(size);
+    assert(bits != NULL);
+
+    check(buffer40_encoded_size(-2, 4) == 0, "encoded_size of a negative "
+                                             "width", width, height);
+    check(buffer40_encoded_size(4, -2) == 0, "encoded_size of a negative "
+                                             "height", width, height);
+    check(buffer40_encode(context, picture -> pixels, picture -> stride,
+                          width, height, DENOMINATOR, bits, size - 1) == 0,
+          "encode into too little room", width, height);
+    check(buffer40_encode(context, picture -> pixels, width * 3 - 1,
+                          width, height, DENOMINATOR, bits, size) == 0,
+          "encode with too short a stride", width, height);
+    check(buffer40_encode(context, picture -> pixels, picture -> stride,
+                          -width, height, DENOMINATOR, bits, size) == 0,
+          "encode a negative width", width, height);
+    check(buffer40_encode(context, picture -> pixels, picture -> stride,
+                          width, height, 0, bits, size) == 0,
+          "encode with a denominator of 0", width, height);
+    check(buffer40_encode(context, picture -> pixels, picture -> stride,
+                          width, height, 256, bits, size) == 0,
+          "encode with a denominator of 256", width, height);
+
+    size_t length = buffer40_encode(context, picture -> pixels,
+                                    picture -> stride, width, height,
+                                    DENOMINATOR, bits, size);
+    check(length == size, "encode", width, height);
+
+    size_t capacity = (size_t) width * height * 3;
+    unsigned char *rows = malloc(capacity);
+    assert(rows != NULL);
+    memset(rows, PAD_BYTE, capacity);
+    int got_width, got_height;
+
+    check(buffer40_decoded_size(bits, length - 1, &got_width,
+                                &got_height) == 0,
+          "decoded_size of cut short codewords", width, height);
+    check(!buffer40_decode(context, bits, length - 1, rows, width * 3,
+                           capacity), "decode cut short codewords", width,
+                                      height);
+    check(!buffer40_decode(context, bits, length, rows, width * 3,
+                           capacity - 1), "decode into too little room",
+                                          width, height);
+    check(!buffer40_decode(context, bits, length, rows, width * 3 - 1,
+                           capacity), "decode with too short a stride",
+                                      width, height);
+
+    bits[0] ^= 1; /* spoil the first line of the header */
+    check(buffer40_decoded_size(bits, length, &got_width, &got_height) == 0,
+          "decoded_size of a malformed header", width, height);
+    check(!buffer40_decode(context, bits, length, rows, width * 3,
+                           capacity), "decode a malformed header", width,
+                                      height);
+    bits[0] ^= 1;
+
+    bool untouched = true;
+    for (size_t i = 0; i < capacity; i++) {
+        untouched = untouched && rows[i] == PAD_BYTE;
+    }
+    check(untouched, "a failed decode wrote pixels", width, height);
+
+    free(rows);
+    free(bits);
+    free_image(&picture);
+}
+
+/*
+ * make_image (int width, int height, unsigned denominator, size_t padding)
+ *
+ * Parameters: int width, height: size of the image
+ *             unsigned denominator: largest sample
+ *             size_t padding: bytes after each row, filled with PAD_BYTE
+ * Returns   : image: gradients plus noise from a fixed seed, at most
+ *                    denominator
+ * Does      : Allocates and fills the image
+ */
+image make_image (int width, int height, unsigned denominator,
+                                         size_t padding)
+{
+    image picture = malloc(sizeof(*picture));
+    assert(picture != NULL);
+    picture -> width       = width;
+    picture -> height      = height;
+    picture -> denominator = denominator;
+    picture -> stride      = (size_t) width * 3 + padding;
+    picture -> pixels      = malloc(picture -> stride * height);
+    assert(picture -> pixels != NULL);
+    memset(picture -> pixels, PAD_BYTE, picture -> stride * height);
+
+    unsigned seed = 40;
+    for (int j = 0; j < height; j++) {
+        unsigned char *sample = picture -> pixels + j * picture -> stride;
+        for (int i = 0; i < width * 3; i++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned value = (i * 7 + j * 5) % 200 + (seed >> 16) % 56;
+            sample[i] = value * denominator / 255;
+        }
+    }
+    return picture;
+}
+
+/*
+ * free_image (image *picture)
+ *
+ * Parameters: image *picture: pointer to the image to free
+ * Returns   : Nothing
+ * Does      : Frees the image and sets it to NULL
+ */
+void free_image (image *picture)
+{
+    free((*picture) -> pixels);
+    free(*picture);
+    *picture = NULL;
+}
+
+/*
+ * file_bytes (FILE *fp, size_t *length)
+ *
+ * Parameters: FILE *fp: a file written through its descriptor or stream
+ *             size_t *length: set to the file's length
+ * Returns   : unsigned char *: the whole file, which the caller frees
+ * Does      : Reads the file from its start
+ */
+unsigned char *file_bytes (FILE *fp, size_t *length)
+{
+    off_t end = lseek(fileno(fp), 0, SEEK_END);
+    assert(end >= 0);
+    *length = end;
+    unsigned char *bytes = malloc(*length + 1);
+    assert(bytes != NULL);
+    ssize_t got = pread(fileno(fp), bytes, *length, 0);
+    assert(got == (ssize_t) *length);
+    return bytes;
+}
@@ -0,0 +1,488 @@
+/*
+ * Filename  : codec40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the codec40.h interface; chains the
+ *             rgb_ypp, ypp_dct, quantization, and bitmap stages together.
+ *             Only the input and output are whole images: the stages run
+ *             over bands of rows, and the y, pb, pr and transform planes
+ *             for a band are carved from one arena, reserved once per
+ *             image and reused for every band.
+ */
+
+#include "codec40.h"
+#include "bitmap.h"
+#include "quantization.h"
+#include "rgb_ypp.h"
+#include "ypp_dct.h"
+#include "arena40.h"
+#include "stats40.h"
+
+/* target size of one band's planes, small enough to stay in a core's L2
+ * cache between stages */
+#define BAND_BYTES (256 * 1024)
+
+/* where the pixels being encoded come from, or decoded pixels go: Pnm_rgbs
+ * in a 2D array, or rows of packed 8-bit samples. Decoding ignores the
+ * denominator and writes through bytes, which it casts back from const */
+typedef struct pixel_source {
+
+    A2Methods_UArray2 pixels;   /* NULL when reading bytes */
+    A2Methods_T methods;
+    const unsigned char *bytes;
+    size_t stride;
+    unsigned denominator;
+
+} *pixel_source;
+
+struct codec40_context {
+
+    A2Methods_T methods;
+    arena40 arena;      /* only grows, so it is reserved once per size */
+
+};
+
+A2Methods_UArray2 encode_source (pixel_source source, int width, int height,
+                                 codec40_context context);
+void fill_band (pixel_source source, int first_row, plane_set ypp_rep);
+void decode_target (codec40_context context, A2Methods_UArray2 words,
+                                             pixel_source target);
+void empty_band (plane_set ypp_rep, pixel_source target, int first_row);
+int band_rows (int blocks_wide, int blocks_high);
+
+/*
+ * encode_pixels (A2Methods_UArray2 pixels, A2Methods_T methods,
+ *                                          unsigned denominator)
+ *
+ * Parameters: A2Methods_UArray2 pixels: array of Pnm_rgb pixels with an even
+ *                                       width and height
+ *             A2Methods_T methods: method suite to manipulate 2D arrays
+ *             unsigned denominator: denominator used to scale rgb values
+ * Returns   : A2Methods_UArray2: array of codewords, half the width and
+ *                                height of the pixel array
+ * Does      : Runs the pixels through every compression stage, a band of
+ *             rows at a time
+ */
+A2Methods_UArray2 encode_pixels (A2Methods_UArray2 pixels, A2Methods_T methods,
+                                                           unsigned denominator)
+{
+    assert(pixels != NULL);
+    assert(methods != NULL);
+
+    return encode_pixel_view(pixels, methods -> width(pixels),
+                                     methods -> height(pixels),
+                                     methods, denominator);
+}
+
+/*
+ * encode_pixel_view (A2Methods_UArray2 pixels, int width, int height,
+ *                    A2Methods_T methods, unsigned denominator)
+ *
+ * Parameters: A2Methods_UArray2 pixels: array of Pnm_rgb pixels
+ *             int width, height: even size of the top left corner of the
+ *                                pixel array to encode
+ *             A2Methods_T methods: method suite to manipulate 2D arrays
+ *             unsigned denominator: denominator used to scale rgb values
+ * Returns   : A2Methods_UArray2: array of codewords, half the given width
+ *                                and height
+ * Does      : The same as encode_pixels, but treats the pixel array as
+ *             cropped to width by height, so an image with an odd width or
+ *             height can be encoded without copying it
+ */
+A2Methods_UArray2 encode_pixel_view (A2Methods_UArray2 pixels, int width,
+                                     int height, A2Methods_T methods,
+                                     unsigned denominator)
+{
+    assert(pixels != NULL);
+    assert(methods != NULL);
+
+    codec40_context context = codec40_context_new(methods);
+    A2Methods_UArray2 words = codec40_encode_view(context, pixels, width,
+                                                  height, denominator);
+    codec40_context_free(&context);
+    return words;
+}
+
+/*
+ * encode_rgb8 (const unsigned char *pixels, size_t stride, int width,
+ *              int height, unsigned denominator, A2Methods_T methods)
+ *
+ * Parameters: const unsigned char *pixels: first sample of the top row of
+ *                                          packed 8-bit rgb pixels
+ *             size_t stride: bytes from the start of one row to the next
+ *             int width, height: even size of the image in pixels
+ *             unsigned denominator: denominator used to scale rgb values
+ *             A2Methods_T methods: method suite to manipulate 2D arrays
+ * Returns   : A2Methods_UArray2: array of codewords, half the width and
+ *                                height of the image
+ * Does      : The same as encode_pixels, but starts from raw rows of bytes
+ *             so a memory mapped ppm never has to be copied into Pnm_rgbs
+ */
+A2Methods_UArray2 encode_rgb8 (const unsigned char *pixels, size_t stride,
+                               int width, int height, unsigned denominator,
+                               A2Methods_T methods)
+{
+    assert(pixels != NULL);
+    assert(methods != NULL);
+
+    codec40_context context = codec40_context_new(methods);
+    A2Methods_UArray2 words = codec40_encode_rgb8(context, pixels, stride,
+                                                  width, height, denominator);
+    codec40_context_free(&context);
+    return words;
+}
+
+/*
+ * codec40_context_new (A2Methods_T methods)
+ *
+ * Parameters: A2Methods_T methods: method suite for the arrays made
+ * Returns   : codec40_context: a context with an empty arena
+ * Does      : Allocates the context; the arena's memory is reserved by the
+ *             first image coded with it
+ */
+codec40_context codec40_context_new (A2Methods_T methods)
+{
+    assert(methods != NULL);
+    codec40_context context = malloc(sizeof(*context));
+    assert(context != NULL);
+    context -> methods = methods;
+    context -> arena   = arena40_new();
+    return context;
+}
+
+/*
+ * codec40_context_free (codec40_context *context)
+ *
+ * Parameters: codec40_context *context: pointer to the context to free
+ * Returns   : Nothing
+ * Does      : Frees the context and its arena, and sets it to NULL
+ */
+void codec40_context_free (codec40_context *context)
+{
+    assert(context != NULL && *context != NULL);
+    arena40_free(&(*context) -> arena);
+    free(*context);
+    *context = NULL;
+}
+
+/*
+ * codec40_methods (codec40_context context)
+ *
+ * Parameters: codec40_context context: the context
+ * Returns   : A2Methods_T: the method suite the context was made with
+ * Does      : Nothing else
+ */
+A2Methods_T codec40_methods (codec40_context context)
+{
+    assert(context != NULL);
+    return context -> methods;
+}
+
+/*
+ * codec40_encode_view (codec40_context context, A2Methods_UArray2 pixels,
+ *                      int width, int height, unsigned denominator)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             A2Methods_UArray2 pixels: array of Pnm_rgb pixels
+ *             int width, height: even size of the top left corner of the
+ *                                pixel array to encode
+ *             unsigned denominator: denominator used to scale rgb values
+ * Returns   : A2Methods_UArray2: array of codewords
+ * Does      : encode_pixel_view with the context's methods and arena
+ */
+A2Methods_UArray2 codec40_encode_view (codec40_context context,
+                                       A2Methods_UArray2 pixels, int width,
+                                       int height, unsigned denominator)
+{
+    assert(context != NULL && pixels != NULL);
+    struct pixel_source source = { pixels, context -> methods, NULL, 0,
+                                   denominator };
+    return encode_source(&source, width, height, context);
+}
+
+/*
+ * codec40_encode_rgb8 (codec40_context context,
+ *                      const unsigned char *pixels, size_t stride,
+ *                      int width, int height, unsigned denominator)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             const unsigned char *pixels: first sample of the top row of
+ *                                          packed 8-bit rgb pixels
+ *             size_t stride: bytes from the start of one row to the next
+ *             int width, height: even size of the image in pixels
+ *             unsigned denominator: denominator used to scale rgb values
+ * Returns   : A2Methods_UArray2: array of codewords
+ * Does      : encode_rgb8 with the context's methods and arena
+ */
+A2Methods_UArray2 codec40_encode_rgb8 (codec40_context context,
+                                       const unsigned char *pixels,
+                                       size_t stride, int width, int height,
+                                       unsigned denominator)
+{
+    assert(context != NULL && pixels != NULL);
+    struct pixel_source source = { NULL, NULL, pixels, stride, denominator };
+    return encode_source(&source, width, height, context);
+}
+
+/*
+ * encode_source (pixel_source source, int width, int height,
+ *                codec40_context context)
+ *
+ * Parameters: pixel_source source: the pixels to encode
+ *             int width, height: even size of the image in pixels
+ *             codec40_context context: methods for the codeword array, and
+ *                                      the arena for the planes
+ * Returns   : A2Methods_UArray2: array of codewords
+ * Does      : Reserves the arena for one band's planes, then for each band
+ *             converts its rows to y, pb, and pr, transforms and quantizes
+ *             them (quantization rewrites the transform planes in place),
+ *             and packs the band's codewords into the output array
+ */
+A2Methods_UArray2 encode_source (pixel_source source, int width, int height,
+                                 codec40_context context)
+{
+    A2Methods_T methods = context -> methods;
+    arena40 arena = context -> arena;
+    int blocks_wide = width / 2,
+        blocks_high = height / 2,
+        rows        = band_rows(blocks_wide, blocks_high);
+    stats40_enter(STATS40_BITMAP_PACK);
+    A2Methods_UArray2 word_map = methods -> new(blocks_wide, blocks_high,
+                                                sizeof(uint64_t));
+
+    stats40_enter(STATS40_ARENA);
+    arena40_reserve(arena, plane_set_bytes(width, rows * 2, NUM_YPP_PLANES) +
+                           plane_set_bytes(blocks_wide, rows,
+                                           NUM_DCT_PLANES));
+    stats40_leave();
+
+    for (int top = 0; top < blocks_high; top += rows) {
+        int band = blocks_high - top < rows ? blocks_high - top : rows;
+        arena40_reset(arena);
+        plane_set ypp_rep = plane_set_carve(arena, width, band * 2,
+                                            NUM_YPP_PLANES);
+        plane_set dct_rep = plane_set_carve(arena, blocks_wide, band,
+                                            NUM_DCT_PLANES);
+
+        size_t pixel_bytes = (size_t) width * band * 2 *
+                             (source -> pixels == NULL ? 3 :
+                                          sizeof(struct Pnm_rgb)),
+               ypp_bytes   = plane_set_bytes(width, band * 2,
+                                             NUM_YPP_PLANES),
+               dct_bytes   = plane_set_bytes(blocks_wide, band,
+                                             NUM_DCT_PLANES);
+
+        stats40_begin(STATS40_RGB_TO_YPP);
+        fill_band(source, top * 2, ypp_rep);
+        stats40_end(STATS40_RGB_TO_YPP, pixel_bytes);
+        stats40_begin(STATS40_YPP_TO_DCT);
+        ypp_to_dct_into(ypp_rep, dct_rep);
+        stats40_end(STATS40_YPP_TO_DCT, ypp_bytes);
+        stats40_begin(STATS40_QUANTIZE_C);
+        quantize_c(dct_rep);
+        stats40_end(STATS40_QUANTIZE_C, dct_bytes);
+        stats40_begin(STATS40_BITMAP_PACK);
+        bitmap_pack_rows(methods, dct_rep, word_map, top);
+        stats40_end(STATS40_BITMAP_PACK, dct_bytes);
+    }
+
+    return word_map;
+}
+
+/*
+ * fill_band (pixel_source source, int first_row, plane_set ypp_rep)
+ *
+ * Parameters: pixel_source source: the pixels to encode
+ *             int first_row: first pixel row of the band
+ *             plane_set ypp_rep: the band's y, pb, and pr planes
+ * Returns   : None
+ * Does      : Converts the band's pixels with whichever rgb_ypp stage
+ *             reads the source's format
+ */
+void fill_band (pixel_source source, int first_row, plane_set ypp_rep)
+{
+    if (source -> pixels == NULL) {
+        rgb8_rows_to_ypp(source -> bytes + first_row * source -> stride,
+                         source -> stride, source -> denominator, ypp_rep);
+    } else {
+        rgb_rows_to_ypp(source -> pixels, source -> methods,
+                        source -> denominator, first_row, ypp_rep);
+    }
+}
+
+/*
+ * empty_band (plane_set ypp_rep, pixel_source target, int first_row)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes of one band
+ *             pixel_source target: where the decoded pixels go
+ *             int first_row: row of the target the band's top row fills
+ * Returns   : Nothing
+ * Does      : The inverse of fill_band; converts the band into the target's
+ *             rows, as packed bytes or Pnm_rgbs
+ */
+void empty_band (plane_set ypp_rep, pixel_source target, int first_row)
+{
+    if (target -> pixels == NULL) {
+        ypp_to_rgb8_rows(ypp_rep, (unsigned char *) target -> bytes +
+                                  first_row * target -> stride,
+                         target -> stride);
+    } else {
+        ypp_to_rgb_rows(ypp_rep, target -> pixels, target -> methods,
+                        first_row);
+    }
+}
+
+/*
+ * band_rows (int blocks_wide, int blocks_high)
+ *
+ * Parameters: int blocks_wide, blocks_high: size of the image in 2x2
+ *                                           blocks
+ * Returns   : int: rows of blocks per band, at least 1 and at most the
+ *                  height of the image
+ * Does      : Fits as many rows of blocks as it can into BAND_BYTES of
+ *             y, pb, pr and transform planes
+ */
+int band_rows (int blocks_wide, int blocks_high)
+{
+    size_t row_bytes = plane_set_bytes(blocks_wide * 2, 2, NUM_YPP_PLANES) +
+                       plane_set_bytes(blocks_wide, 1, NUM_DCT_PLANES);
+    size_t rows = BAND_BYTES / row_bytes;
+
+    if (rows > (size_t) blocks_high) {
+        rows = blocks_high;
+    }
+    return rows > 0 ? (int) rows : 1;
+}
+
+/*
+ * decode_codewords (A2Methods_UArray2 words, A2Methods_T methods)
+ *
+ * Parameters: A2Methods_UArray2 words: array of codewords
+ *             A2Methods_T methods: method suite to manipulate 2D arrays
+ * Returns   : A2Methods_UArray2: array of Pnm_rgb pixels, twice the width
+ *                                and height of the codeword array
+ * Does      : Runs the codewords through every decompression stage, a band
+ *             of rows at a time
+ */
+A2Methods_UArray2 decode_codewords (A2Methods_UArray2 words,
+                                    A2Methods_T methods)
+{
+    assert(words != NULL);
+    assert(methods != NULL);
+
+    codec40_context context = codec40_context_new(methods);
+    A2Methods_UArray2 pixels = codec40_decode(context, words);
+    codec40_context_free(&context);
+    return pixels;
+}
+
+/*
+ * codec40_decode (codec40_context context, A2Methods_UArray2 words)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             A2Methods_UArray2 words: array of codewords
+ * Returns   : A2Methods_UArray2: array of Pnm_rgb pixels, twice the width
+ *                                and height of the codeword array
+ * Does      : Runs the codewords through every decompression stage a band
+ *             at a time, mirroring encode_source: each band's codewords
+ *             are unpacked and dequantized in place, inverted into y, pb,
+ *             and pr planes in the arena, and converted into the band's
+ *             rows of the output array
+ */
+A2Methods_UArray2 codec40_decode (codec40_context context,
+                                  A2Methods_UArray2 words)
+{
+    assert(context != NULL && words != NULL);
+    A2Methods_T methods = context -> methods;
+    stats40_enter(STATS40_YPP_TO_RGB);
+    A2Methods_UArray2 pixels = methods -> new(methods -> width(words) * 2,
+                                              methods -> height(words) * 2,
+                                              sizeof(struct Pnm_rgb));
+    stats40_leave();
+
+    struct pixel_source target = { pixels, methods, NULL, 0, 0 };
+    decode_target(context, words, &target);
+    return pixels;
+}
+
+/*
+ * codec40_decode_rgb8 (codec40_context context, A2Methods_UArray2 words,
+ *                      unsigned char *pixels, size_t stride)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             A2Methods_UArray2 words: array of codewords
+ *             unsigned char *pixels: first sample of the top row to fill
+ *             size_t stride: bytes from the start of one row to the next
+ * Returns   : Nothing
+ * Does      : codec40_decode, but into packed 8-bit rows
+ */
+void codec40_decode_rgb8 (codec40_context context, A2Methods_UArray2 words,
+                          unsigned char *pixels, size_t stride)
+{
+    assert(context != NULL && words != NULL && pixels != NULL);
+    assert(stride >= (size_t) context -> methods -> width(words) * 6);
+
+    struct pixel_source target = { NULL, NULL, pixels, stride, 0 };
+    decode_target(context, words, &target);
+}
+
+/*
+ * decode_target (codec40_context context, A2Methods_UArray2 words,
+ *                                         pixel_source target)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             A2Methods_UArray2 words: array of codewords
+ *             pixel_source target: where the pixels go, twice the width
+ *                                  and height of the codeword array
+ * Returns   : Nothing
+ * Does      : Runs the codewords through every decompression stage a band
+ *             at a time, mirroring encode_source: each band's codewords
+ *             are unpacked and dequantized in place, inverted into y, pb,
+ *             and pr planes in the arena, and converted into the band's
+ *             rows of the target
+ */
+void decode_target (codec40_context context, A2Methods_UArray2 words,
+                                             pixel_source target)
+{
+    A2Methods_T methods = context -> methods;
+    arena40 arena = context -> arena;
+    int blocks_wide = methods -> width(words),
+        blocks_high = methods -> height(words),
+        rows        = band_rows(blocks_wide, blocks_high);
+
+    stats40_enter(STATS40_ARENA);
+    arena40_reserve(arena, plane_set_bytes(blocks_wide, rows,
+                                           NUM_DCT_PLANES) +
+                           plane_set_bytes(blocks_wide * 2, rows * 2,
+                                           NUM_YPP_PLANES));
+    stats40_leave();
+
+    for (int top = 0; top < blocks_high; top += rows) {
+        int band = blocks_high - top < rows ? blocks_high - top : rows;
+        arena40_reset(arena);
+        plane_set dct_rep = plane_set_carve(arena, blocks_wide, band,
+                                            NUM_DCT_PLANES);
+        plane_set ypp_rep = plane_set_carve(arena, blocks_wide * 2, band * 2,
+                                            NUM_YPP_PLANES);
+
+        size_t word_bytes = (size_t) blocks_wide * band * sizeof(uint64_t),
+               dct_bytes  = plane_set_bytes(blocks_wide, band,
+                                            NUM_DCT_PLANES),
+               ypp_bytes  = plane_set_bytes(blocks_wide * 2, band * 2,
+                                            NUM_YPP_PLANES);
+
+        stats40_begin(STATS40_BITMAP_UNPACK);
+        bitmap_unpack_rows(methods, words, top, dct_rep);
+        stats40_end(STATS40_BITMAP_UNPACK, word_bytes);
+        stats40_begin(STATS40_QUANTIZE_D);
+        quantize_d(dct_rep);
+        stats40_end(STATS40_QUANTIZE_D, dct_bytes);
+        stats40_begin(STATS40_DCT_TO_YPP);
+        dct_to_ypp_into(dct_rep, ypp_rep);
+        stats40_end(STATS40_DCT_TO_YPP, dct_bytes);
+        stats40_begin(STATS40_YPP_TO_RGB);
+        empty_band(ypp_rep, target, top * 2);
+        stats40_end(STATS40_YPP_TO_RGB, ypp_bytes);
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * Filename  : codec40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Runs the whole chain of compression stages over a 2D array of
+ *             pixels, or the whole chain of decompression stages over a 2D
+ *             array of codewords. Every driver (whole image, streaming)
+ *             goes through these so that they all produce the same output
+ */
+
+#ifndef CODEC40_INCLUDED
+#define CODEC40_INCLUDED
+
+#include "pnm.h"
+#include "a2methods.h"
+#include "assert.h"
+#include <stddef.h>
+
+/*
+ * encode_pixels
+ *
+ * returns a 2D array of codewords, one per 2x2 block of the given 2D array
+ * of Pnm_rgb pixels
+ *
+ * assumes the first 2 arguments are not NULL and that the width and height
+ * of the pixel array are even
+ */
+A2Methods_UArray2 encode_pixels (A2Methods_UArray2 pixels, A2Methods_T methods,
+                                                           unsigned denominator);
+
+/*
+ * encode_pixel_view
+ *
+ * returns a 2D array of codewords, one per 2x2 block of the top left width
+ * by height corner of the given 2D array of Pnm_rgb pixels
+ *
+ * assumes pixels and methods are not NULL and that width and height are
+ * even and at most the width and height of the pixel array
+ */
+A2Methods_UArray2 encode_pixel_view (A2Methods_UArray2 pixels, int width,
+                                     int height, A2Methods_T methods,
+                                     unsigned denominator);
+
+/*
+ * encode_rgb8
+ *
+ * returns a 2D array of codewords, one per 2x2 block of an image held as
+ * rows of packed 8-bit red, green, blue samples, stride bytes apart
+ *
+ * assumes pixels and methods are not NULL, that width and height are even,
+ * and that stride is at least 3 * width
+ */
+A2Methods_UArray2 encode_rgb8 (const unsigned char *pixels, size_t stride,
+                               int width, int height, unsigned denominator,
+                               A2Methods_T methods);
+
+/*
+ * decode_codewords
+ *
+ * returns a 2D array of Pnm_rgb pixels, scaled to a denominator of 255,
+ * twice the width and height of the given 2D array of codewords
+ *
+ * assumes the arguments are not NULL
+ */
+A2Methods_UArray2 decode_codewords (A2Methods_UArray2 words,
+                                    A2Methods_T methods);
+
+/* A codec context keeps what the stages need between images: the method
+ * suite and the arena their planes are carved from. The functions above
+ * make a context for one image and throw it away; a driver that codes
+ * many images keeps one, so memory is only reserved again when an image
+ * needs more than any before it. A context is not safe to share between
+ * threads. */
+typedef struct codec40_context *codec40_context;
+
+/*
+ * codec40_context_new
+ *
+ * returns a new context whose arrays are made with the given methods
+ *
+ * assumes methods is not NULL
+ */
+codec40_context codec40_context_new (A2Methods_T methods);
+
+/*
+ * codec40_context_free
+ *
+ * frees the given context and sets it to NULL
+ */
+void codec40_context_free (codec40_context *context);
+
+/*
+ * codec40_methods
+ *
+ * returns the method suite the given context was made with
+ */
+A2Methods_T codec40_methods (codec40_context context);
+
+/*
+ * codec40_encode_view, codec40_encode_rgb8, codec40_decode
+ *
+ * the same as encode_pixel_view, encode_rgb8, and decode_codewords, using
+ * the context's methods and arena
+ */
+A2Methods_UArray2 codec40_encode_view (codec40_context context,
+                                       A2Methods_UArray2 pixels, int width,
+                                       int height, unsigned denominator);
+A2Methods_UArray2 codec40_encode_rgb8 (codec40_context context,
+                                       const unsigned char *pixels,
+                                       size_t stride, int width, int height,
+                                       unsigned denominator);
+A2Methods_UArray2 codec40_decode (codec40_context context,
+                                  A2Methods_UArray2 words);
+
+/*
+ * codec40_decode_rgb8
+ *
+ * decodes the given codewords, like codec40_decode, into rows of packed
+ * 8-bit red, green, blue samples with a denominator of 255, stride bytes
+ * apart, the first of which starts at pixels
+ *
+ * assumes no pointer is NULL and stride is at least 3 * the image width
+ */
+void codec40_decode_rgb8 (codec40_context context, A2Methods_UArray2 words,
+                          unsigned char *pixels, size_t stride);
+
+#endif
@@ -6,27 +6,27 @@
  * Does      : Holds functions compress and decompress; compress will utilize
  *             functions from all of our helper files in order to compress an
  *             image; decompress will utilize functions from all of our 
- *             helper files in order to decompress an image
+ *             helper files in order to decompress an image. Both go through
+ *             compress40_image and decompress40_image (image40.h), which
+ *             code one image file with a given codec40_context
  */
 
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 #include "assert.h"
 #include "pnm.h"
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
 #include "compress40.h"
-#include "bitmap.h"
+#include "codec40.h"
+#include "image40.h"
 #include "ppm_reader.h"
-#include "quantization.h"
-#include "rgb_ypp.h"
-#include "ypp_dct.h"
 #include "read_bitfile.h"
-
-#define DENOMINATOR 255 /* ppm denominator */
+#include "stats40.h"
 
 A2Methods_UArray2 codeword_info_array (A2Methods_T methods); 
 
@@ -39,22 +39,12 @@ A2Methods_UArray2 codeword_info_array (A2Methods_T methods);
  */ 
 extern void compress40 (FILE *inputfp)
 {
-    A2Methods_T methods = uarray2_methods_plain;
-    assert(methods != NULL);
-
-    Pnm_ppm rgb_rep = read_ppm(inputfp, methods);
-    A2Methods_UArray2 ypp_rep = rgb_to_ypp(rgb_rep -> pixels, 
-                                           methods,
-                                           rgb_rep -> denominator);
-    A2Methods_UArray2 dct_rep = ypp_to_dct(ypp_rep, methods);
-    quantize_c(dct_rep, methods);   
-    A2Methods_UArray2 word_map = bitmap_pack(methods, dct_rep);//, codeword_info);
-    write_bitfile(methods, word_map);
-
-    methods -> free(&ypp_rep);
-    methods -> free(&dct_rep);
-    methods -> free(&word_map);
-    Pnm_ppmfree(&rgb_rep);
+    codec40_context context = codec40_context_new(uarray2_methods_plain);
+
+    fflush(stdout);
+    compress40_image(context, inputfp, STDOUT_FILENO);
+
+    codec40_context_free(&context);
 }
 
 
@@ -68,29 +58,96 @@ extern void compress40 (FILE *inputfp)
  */ 
 extern void decompress40(FILE *inputfp)
 {
-    A2Methods_T methods = uarray2_methods_plain;
-    assert(methods != NULL);
-
-    A2Methods_UArray2 word_map = read_bitfile(inputfp, methods);
-    A2Methods_UArray2 dct_rep2 = bitmap_unpack(methods, word_map);//, 
-                                                        //codeword_info);
-    quantize_d(dct_rep2, methods);
-    A2Methods_UArray2 ypp_rep2 = dct_to_ypp(dct_rep2, methods);
-
-    Pnm_ppm pixmap = malloc(sizeof(struct Pnm_ppm));
-    assert(pixmap != NULL);
-    pixmap -> width = methods -> width(ypp_rep2);
-    pixmap -> height = methods -> height(ypp_rep2);
-    pixmap -> denominator = DENOMINATOR;
-    pixmap -> methods = methods;
-    pixmap -> pixels = ypp_to_rgb(ypp_rep2, methods);
-    
-    write_ppm(pixmap);
-
-    methods -> free(&dct_rep2);
+    codec40_context context = codec40_context_new(uarray2_methods_plain);
+
+    decompress40_image(context, inputfp, stdout);
+
+    codec40_context_free(&context);
+}
+
+/*
+ * compress40_image (codec40_context context, FILE *input, int fd)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             FILE *input: input file, ppm image
+ *             int fd: file descriptor the bit file is written to
+ * Returns   : Nothing
+ * Does      : Encodes straight from the file's bytes when it can be mapped,
+ *             and from a read Pnm_ppm otherwise, then writes the codewords
+ */
+void compress40_image (codec40_context context, FILE *input, int fd)
+{
+    assert(context != NULL && input != NULL && fd >= 0);
+    A2Methods_T methods = codec40_methods(context);
+
+    A2Methods_UArray2 word_map;
+    stats40_begin(STATS40_READ_PPM);
+    ppm_map mapped = map_ppm(input);
+    if (mapped != NULL) { /* encode straight from the file's bytes */
+        stats40_end(STATS40_READ_PPM, mapped -> stride * mapped -> height);
+        word_map = codec40_encode_rgb8(context, mapped -> pixels,
+                                       mapped -> stride, mapped -> width,
+                                       mapped -> height,
+                                       mapped -> denominator);
+        unmap_ppm(&mapped);
+    } else {
+        Pnm_ppm rgb_rep = read_ppm(input, methods);
+        stats40_end(STATS40_READ_PPM, (size_t) rgb_rep -> width *
+                                      rgb_rep -> height * 3);
+        word_map = codec40_encode_view(context, rgb_rep -> pixels,
+                                       rgb_rep -> width, rgb_rep -> height,
+                                       rgb_rep -> denominator);
+        Pnm_ppmfree(&rgb_rep);
+    }
+    stats40_begin(STATS40_WRITE_BITFILE);
+    write_bitfile_fd(fd, methods, word_map);
+    stats40_end(STATS40_WRITE_BITFILE, (size_t) methods -> width(word_map) *
+                                       methods -> height(word_map) * 4);
+
     methods -> free(&word_map);
-    methods -> free(&ypp_rep2);
-    Pnm_ppmfree(&pixmap);
+}
+
+/*
+ * decompress40_image (codec40_context context, FILE *input, FILE *output)
+ *
+ * Parameters: codec40_context context: the context to code with
+ *             FILE *input: input file, compressed image
+ *             FILE *output: file the ppm image is written to
+ * Returns   : Nothing
+ * Does      : Reads the codewords, decodes them into packed 8-bit rows, and
+ *             writes the rows with one fwrite
+ */
+void decompress40_image (codec40_context context, FILE *input, FILE *output)
+{
+    assert(context != NULL && input != NULL && output != NULL);
+    A2Methods_T methods = codec40_methods(context);
+
+    stats40_begin(STATS40_READ_BITFILE);
+    A2Methods_UArray2 word_map = read_bitfile(input, methods);
+    size_t blocks = (size_t) methods -> width(word_map) *
+                    methods -> height(word_map);
+    stats40_end(STATS40_READ_BITFILE, blocks * 4); /* 4 bytes per word */
+
+    int width  = methods -> width(word_map) * 2,
+        height = methods -> height(word_map) * 2;
+    size_t stride = (size_t) width * 3,
+           bytes  = stride * height;
+    stats40_enter(STATS40_YPP_TO_RGB);
+    unsigned char *pixels = bytes > 0 ? malloc(bytes) : NULL;
+    assert(bytes == 0 || pixels != NULL);
+    stats40_stage owner = stats40_allocated(bytes);
+    stats40_leave();
+    if (bytes > 0) {
+        codec40_decode_rgb8(context, word_map, pixels, stride);
+    }
+    methods -> free(&word_map);
+
+    stats40_begin(STATS40_WRITE_PPM);
+    write_ppm_rgb8(output, pixels, width, height);
+    stats40_end(STATS40_WRITE_PPM, bytes);
+
+    stats40_freed(owner, bytes);
+    free(pixels);
 }
 
 /*
@@ -0,0 +1,40 @@
+/*
+ * Filename  : image40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Compresses or decompresses one whole image file through a
+ *             given codec40_context. This is the one image path of
+ *             40image: compress40 and decompress40 are these with a new
+ *             context and standard output, and each batch40 worker calls
+ *             them once per image with its own context. Implemented in
+ *             compress40.c, since compress40.h is the course's interface
+ */
+
+#ifndef IMAGE40_INCLUDED
+#define IMAGE40_INCLUDED
+
+#include <stdio.h>
+#include "codec40.h"
+
+/*
+ * compress40_image
+ *
+ * compresses the ppm image in the given file with the given context, and
+ * writes the bit file to the given file descriptor
+ *
+ * assumes the context and input are not NULL and that fd is open
+ */
+void compress40_image (codec40_context context, FILE *input, int fd);
+
+/*
+ * decompress40_image
+ *
+ * decompresses the bit file in the given file with the given context, and
+ * writes the ppm image to the given output file
+ *
+ * assumes the arguments are not NULL
+ */
+void decompress40_image (codec40_context context, FILE *input, FILE *output);
+
+#endif
@@ -0,0 +1,472 @@
+/*
+ * Filename  : parallel40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the parallel40.h interface. Each codeword
+ *             only depends on its own 2x2 block of pixels, so bands of
+ *             block rows can be encoded or decoded independently. Each
+ *             thread works through its band a slab of rows at a time,
+ *             copying the slab into a small array of its own, running the
+ *             codec on it, and copying the result into its rows of the
+ *             shared output array. When the input ppm can be memory
+ *             mapped, encoding bands read their rows straight out of the
+ *             mapping instead of copying slabs, and decoding bands always
+ *             write packed 8-bit rows straight into one shared buffer,
+ *             which is written with a single fwrite.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "parallel40.h"
+#include "codec40.h"
+#include "ppm_reader.h"
+#include "read_bitfile.h"
+#include "stats40.h"
+
+#define SLAB_BLOCK_ROWS 16 /* rows of 2x2 blocks converted per slab */
+#define DENOMINATOR 255 /* ppm denominator */
+
+/* one thread's share of the image: block rows [first_row, first_row +
+ * num_rows) of the codeword array, and the pixel rows they cover. When
+ * bytes (encoding) or out (decoding) is not NULL the pixels are packed
+ * 8-bit rows, stride bytes apart, and pixels is unused */
+typedef struct band {
+
+    A2Methods_UArray2 pixels;
+    const unsigned char *bytes;
+    unsigned char *out;
+    size_t stride;
+    A2Methods_UArray2 words;
+    A2Methods_T methods;
+    unsigned denominator;
+    int first_row,
+        num_rows;
+
+} *band;
+
+/* closure struct for copying rows between a whole image array and a slab
+ * array; row_offset is the row of the whole array that is row 0 of the
+ * slab */
+typedef struct copy_closure {
+
+    A2Methods_UArray2 whole;
+    A2Methods_T methods;
+    int row_offset;
+
+} *copy_closure;
+
+void *encode_band (void *arg);
+void *decode_band (void *arg);
+void init_bands (band bands, unsigned nthreads, A2Methods_UArray2 pixels,
+                                                A2Methods_UArray2 words,
+                                                A2Methods_T methods,
+                                                unsigned denominator);
+void run_bands (band bands, unsigned nthreads, void *work(void *arg));
+void split_bands (band bands, unsigned nthreads, int block_rows);
+void copy_slab (A2Methods_T methods, A2Methods_UArray2 slab,
+                                     A2Methods_UArray2 whole,
+                                     int row_offset, bool into_slab);
+void copy_slab_in (int i, int j, A2Methods_UArray2 array2,
+                                 A2Methods_Object *ptr,
+                                 void *cl);
+void copy_slab_out (int i, int j, A2Methods_UArray2 array2,
+                                  A2Methods_Object *ptr,
+                                  void *cl);
+
+/*
+ * compress40_parallel (FILE *inputfp, unsigned nthreads)
+ *
+ * Parameters: FILE *inputfp: input file, ppm image
+ *             unsigned nthreads: number of threads to encode with
+ * Returns   : None
+ * Does      : Reads the whole image, splits its block rows into one band
+ *             per thread, encodes the bands in parallel into a shared
+ *             codeword array, and writes that array in order
+ */
+void compress40_parallel (FILE *inputfp, unsigned nthreads)
+{
+    A2Methods_T methods = uarray2_methods_plain;
+    assert(methods != NULL);
+    assert(nthreads >= 1);
+
+    Pnm_ppm rgb_rep = NULL;
+    ppm_map mapped = map_ppm(inputfp);
+    int width, height;
+    if (mapped != NULL) {
+        width  = mapped -> width / 2;
+        height = mapped -> height / 2;
+    } else {
+        rgb_rep = read_ppm(inputfp, methods);
+        width  = rgb_rep -> width / 2;
+        height = rgb_rep -> height / 2;
+    }
+    if (width == 0 || height == 0) { /* nothing to encode */
+        write_bitfile_header(width * 2, height * 2);
+        Pnm_ppmfree(&rgb_rep);
+        return;
+    }
+    if (nthreads > (unsigned) height) {
+        nthreads = height;
+    }
+
+    A2Methods_UArray2 word_map = methods -> new(width, height,
+                                                sizeof(uint64_t));
+    struct band bands[nthreads];
+    if (mapped != NULL) {
+        init_bands(bands, nthreads, NULL, word_map, methods,
+                                    mapped -> denominator);
+        for (unsigned t = 0; t < nthreads; t++) {
+            bands[t].bytes  = mapped -> pixels;
+            bands[t].stride = mapped -> stride;
+        }
+    } else {
+        init_bands(bands, nthreads, rgb_rep -> pixels, word_map, methods,
+                                    rgb_rep -> denominator);
+    }
+    split_bands(bands, nthreads, height);
+    run_bands(bands, nthreads, encode_band);
+
+    fflush(stdout);
+    write_bitfile_fd(STDOUT_FILENO, methods, word_map);
+
+    methods -> free(&word_map);
+    if (mapped != NULL) {
+        unmap_ppm(&mapped);
+    } else {
+        Pnm_ppmfree(&rgb_rep);
+    }
+}
+
+/*
+ * decompress40_parallel (FILE *inputfp, unsigned nthreads)
+ *
+ * Parameters: FILE *inputfp: input file, compressed bit file
+ *             unsigned nthreads: number of threads to decode with
+ * Returns   : None
+ * Does      : Reads every codeword, splits the codeword rows into one band
+ *             per thread, decodes the bands in parallel straight into
+ *             packed 8-bit rows, and writes them in one go
+ */
+void decompress40_parallel (FILE *inputfp, unsigned nthreads)
+{
+    A2Methods_T methods = uarray2_methods_plain;
+    assert(methods != NULL);
+    assert(nthreads >= 1);
+
+    A2Methods_UArray2 word_map = read_bitfile(inputfp, methods);
+    int width  = methods -> width(word_map),
+        height = methods -> height(word_map);
+    if (nthreads > (unsigned) height) {
+        nthreads = height;
+    }
+
+    size_t stride = (size_t) width * 2 * 3,
+           bytes  = stride * height * 2;
+    unsigned char *pixels = bytes > 0 ? malloc(bytes) : NULL;
+    assert(bytes == 0 || pixels != NULL);
+    stats40_stage owner = stats40_allocated(bytes);
+
+    if (bytes > 0) {
+        struct band bands[nthreads];
+        init_bands(bands, nthreads, NULL, word_map, methods, DENOMINATOR);
+        for (unsigned t = 0; t < nthreads; t++) {
+            bands[t].out    = pixels;
+            bands[t].stride = stride;
+        }
+        split_bands(bands, nthreads, height);
+        run_bands(bands, nthreads, decode_band);
+    }
+    methods -> free(&word_map);
+
+    write_ppm_rgb8(stdout, pixels, width * 2, height * 2);
+
+    stats40_freed(owner, bytes);
+    free(pixels);
+}
+
+/*
+ * init_bands (band bands, unsigned nthreads, A2Methods_UArray2 pixels,
+ *                                            A2Methods_UArray2 words,
+ *                                            A2Methods_T methods,
+ *                                            unsigned denominator)
+ *
+ * Parameters: band bands: array of nthreads bands
+ *             unsigned nthreads: number of bands
+ *             A2Methods_UArray2 pixels: whole array of Pnm_rgb pixels,
+ *                                       or NULL if the bands are given
+ *                                       packed bytes afterwards
+ *             A2Methods_UArray2 words: whole array of codewords
+ *             A2Methods_T methods: methods for both arrays
+ *             unsigned denominator: denominator of the pixels
+ * Returns   : None
+ * Does      : Points every band at the shared arrays; split_bands picks
+ *             the rows each band covers
+ */
+void init_bands (band bands, unsigned nthreads, A2Methods_UArray2 pixels,
+                                                A2Methods_UArray2 words,
+                                                A2Methods_T methods,
+                                                unsigned denominator)
+{
+    for (unsigned t = 0; t < nthreads; t++) {
+        bands[t].pixels      = pixels;
+        bands[t].bytes       = NULL;
+        bands[t].out         = NULL;
+        bands[t].stride      = 0;
+        bands[t].words       = words;
+        bands[t].methods     = methods;
+        bands[t].denominator = denominator;
+    }
+}
+
+/*
+ * split_bands (band bands, unsigned nthreads, int block_rows)
+ *
+ * Parameters: band bands: array of nthreads bands
+ *             unsigned nthreads: number of bands
+ *             int block_rows: number of rows of 2x2 blocks in the image
+ * Returns   : None
+ * Does      : Gives each band a contiguous run of block rows, in order,
+ *             with sizes that differ by at most one row
+ */
+void split_bands (band bands, unsigned nthreads, int block_rows)
+{
+    int first = 0;
+    for (unsigned t = 0; t < nthreads; t++) {
+        int rows = block_rows / nthreads;
+        if (t < block_rows % nthreads) {
+            rows++;
+        }
+        bands[t].first_row = first;
+        bands[t].num_rows  = rows;
+        first += rows;
+    }
+}
+
+/*
+ * run_bands (band bands, unsigned nthreads, void *work(void *arg))
+ *
+ * Parameters: band bands: array of nthreads bands
+ *             unsigned nthreads: number of bands
+ *             void *work(void *arg): function to run on each band
+ * Returns   : None
+ * Does      : Runs work on every band, the first on the calling thread
+ *             and the rest on threads of their own, and waits for all of
+ *             them to finish
+ */
+void run_bands (band bands, unsigned nthreads, void *work(void *arg))
+{
+    pthread_t threads[nthreads];
+    for (unsigned t = 1; t < nthreads; t++) {
+        int err = pthread_create(&threads[t], NULL, work, &bands[t]);
+        assert(err == 0);
+    }
+    work(&bands[0]);
+    for (unsigned t = 1; t < nthreads; t++) {
+        int err = pthread_join(threads[t], NULL);
+        assert(err == 0);
+    }
+}
+
+/*
+ * encode_band (void *arg)
+ *
+ * Parameters: void *arg: the band to encode
+ * Returns   : NULL
+ * Does      : Encodes the band a slab of block rows at a time with a
+ *             codec context of its own, writing each slab's codewords into
+ *             the band's rows of the shared codeword array. Packed bytes
+ *             are encoded in place; a Pnm_rgb array is first copied a slab
+ *             at a time into a slab array that is only made again for a
+ *             shorter last slab. Only touches the band's own rows, so
+ *             bands can run at the same time.
+ */
+void *encode_band (void *arg)
+{
+    band b = (band) arg;
+    A2Methods_T methods = b -> methods;
+    int width = methods -> width(b -> words) * 2;
+    codec40_context context = codec40_context_new(methods);
+    A2Methods_UArray2 slab = NULL;
+
+    for (int row = b -> first_row; row < b -> first_row + b -> num_rows;
+                                   row += SLAB_BLOCK_ROWS) {
+        int rows = b -> first_row + b -> num_rows - row;
+        if (rows > SLAB_BLOCK_ROWS) {
+            rows = SLAB_BLOCK_ROWS;
+        }
+        A2Methods_UArray2 word_slab;
+        if (b -> bytes != NULL) {
+            word_slab = codec40_encode_rgb8(context, b -> bytes +
+                                            (size_t) row * 2 * b -> stride,
+                                            b -> stride, width, rows * 2,
+                                            b -> denominator);
+        } else {
+            if (slab == NULL || methods -> height(slab) != rows * 2) {
+                if (slab != NULL) {
+                    methods -> free(&slab);
+                }
+                slab = methods -> new(width, rows * 2,
+                                      sizeof(struct Pnm_rgb));
+            }
+            copy_slab(methods, slab, b -> pixels, row * 2, true);
+            word_slab = codec40_encode_view(context, slab, width, rows * 2,
+                                            b -> denominator);
+        }
+        copy_slab(methods, word_slab, b -> words, row, false);
+
+        methods -> free(&word_slab);
+    }
+
+    if (slab != NULL) {
+        methods -> free(&slab);
+    }
+    codec40_context_free(&context);
+    return NULL;
+}
+
+/*
+ * copy_slab (A2Methods_T methods, A2Methods_UArray2 slab,
+ *                                 A2Methods_UArray2 whole,
+ *                                 int row_offset, bool into_slab)
+ *
+ * Parameters: A2Methods_T methods: methods for both arrays
+ *             A2Methods_UArray2 slab: the slab array
+ *             A2Methods_UArray2 whole: the whole image array, at least as
+ *                                      wide as the slab
+ *             int row_offset: row of the whole array that is row 0 of the
+ *                             slab
+ *             bool into_slab: copy from the whole array into the slab if
+ *                             true, from the slab into the whole array if
+ *                             false
+ * Returns   : None
+ * Does      : Copies the slab's rows between the two arrays. When both
+ *             keep their rows contiguous, each row is a single memcpy;
+ *             otherwise every element is copied through copy_slab_in or
+ *             copy_slab_out.
+ */
+void copy_slab (A2Methods_T methods, A2Methods_UArray2 slab,
+                                     A2Methods_UArray2 whole,
+                                     int row_offset, bool into_slab)
+{
+    int width = methods -> width(slab);
+    if (methods -> blocksize(slab) == 1 && methods -> blocksize(whole) == 1 &&
+        width > 0) {
+        size_t bytes = (size_t) width * methods -> size(slab);
+        for (int j = 0; j < methods -> height(slab); j++) {
+            void *slab_row  = methods -> at(slab, 0, j),
+                 *whole_row = methods -> at(whole, 0, j + row_offset);
+            if (into_slab) {
+                memcpy(slab_row, whole_row, bytes);
+            } else {
+                memcpy(whole_row, slab_row, bytes);
+            }
+        }
+        return;
+    }
+
+    struct copy_closure cl = { whole, methods, row_offset };
+    methods -> map_row_major(slab, into_slab ? copy_slab_in : copy_slab_out,
+                             &cl);
+}
+
+/*
+ * copy_slab_in (int i, int j, A2Methods_UArray2 array2,
+ *                             A2Methods_Object *ptr,
+ *                             void *cl)
+ *
+ * Parameters: int i: index of column of the slab
+ *             int j: index of row of the slab
+ *             A2Methods_UArray2 array2: the slab
+ *             A2Methods_Object *ptr: the element of the slab at (i, j)
+ *             void *cl: copy_closure holding the whole array
+ * Returns   : None
+ * Does      : Copies the element of the whole array that lines up with
+ *             (i, j) of the slab into the slab
+ */
+void copy_slab_in (int i, int j, A2Methods_UArray2 array2,
+                                 A2Methods_Object *ptr,
+                                 void *cl)
+{
+    copy_closure cl_struct = (copy_closure) cl;
+    A2Methods_T methods = cl_struct -> methods;
+    memcpy(ptr, methods -> at(cl_struct -> whole, i,
+                              j + cl_struct -> row_offset),
+                methods -> size(array2));
+}
+
+/*
+ * copy_slab_out (int i, int j, A2Methods_UArray2 array2,
+ *                              A2Methods_Object *ptr,
+ *                              void *cl)
+ *
+ * Parameters: int i: index of column of the slab
+ *             int j: index of row of the slab
+ *             A2Methods_UArray2 array2: the slab
+ *             A2Methods_Object *ptr: the element of the slab at (i, j)
+ *             void *cl: copy_closure holding the whole array
+ * Returns   : None
+ * Does      : Copies the element at (i, j) of the slab into the element of
+ *             the whole array that lines up with it
+ */
+void copy_slab_out (int i, int j, A2Methods_UArray2 array2,
+                                  A2Methods_Object *ptr,
+                                  void *cl)
+{
+    copy_closure cl_struct = (copy_closure) cl;
+    A2Methods_T methods = cl_struct -> methods;
+    memcpy(methods -> at(cl_struct -> whole, i, j + cl_struct -> row_offset),
+           ptr, methods -> size(array2));
+}
+
+/*
+ * decode_band (void *arg)
+ *
+ * Parameters: void *arg: the band to decode
+ * Returns   : NULL
+ * Does      : Decodes the band a slab of codeword rows at a time with a
+ *             codec context of its own, writing each slab's pixels as
+ *             packed 8-bit rows into the band's rows of the shared buffer.
+ *             The slab of codewords is only made again for a shorter last
+ *             slab. Only touches the band's own rows, so bands can run at
+ *             the same time.
+ */
+void *decode_band (void *arg)
+{
+    band b = (band) arg;
+    A2Methods_T methods = b -> methods;
+    int width = methods -> width(b -> words);
+    codec40_context context = codec40_context_new(methods);
+    A2Methods_UArray2 word_slab = NULL;
+
+    for (int row = b -> first_row; row < b -> first_row + b -> num_rows;
+                                   row += SLAB_BLOCK_ROWS) {
+        int rows = b -> first_row + b -> num_rows - row;
+        if (rows > SLAB_BLOCK_ROWS) {
+            rows = SLAB_BLOCK_ROWS;
+        }
+        if (word_slab == NULL || methods -> height(word_slab) != rows) {
+            if (word_slab != NULL) {
+                methods -> free(&word_slab);
+            }
+            word_slab = methods -> new(width, rows, sizeof(uint64_t));
+        }
+        copy_slab(methods, word_slab, b -> words, row, true);
+        codec40_decode_rgb8(context, word_slab,
+                            b -> out + (size_t) row * 2 * b -> stride,
+                            b -> stride);
+    }
+
+    if (word_slab != NULL) {
+        methods -> free(&word_slab);
+    }
+    codec40_context_free(&context);
+    return NULL;
+}
@@ -0,0 +1,39 @@
+/*
+ * Filename  : parallel40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Multithreaded versions of compress40 and decompress40 which
+ *             split the image into horizontal bands of 2x2 blocks and run
+ *             every stage of the codec on each band in its own thread
+ */
+
+#ifndef PARALLEL40_INCLUDED
+#define PARALLEL40_INCLUDED
+
+#include <stdio.h>
+
+/*
+ * compress40_parallel
+ *
+ * compresses the ppm image in the given file using the given number of
+ * threads, each of which encodes one band of rows. Produces exactly the
+ * same bit file as compress40
+ *
+ * assumes fp is not NULL and nthreads is at least 1
+ */
+void compress40_parallel (FILE *inputfp, unsigned nthreads);
+
+/*
+ * decompress40_parallel
+ *
+ * decompresses the bit file in the given file using the given number of
+ * threads, each of which decodes one band of codeword rows into a shared
+ * buffer of packed 8-bit rows. Produces exactly the same ppm image as
+ * decompress40
+ *
+ * assumes fp is not NULL and nthreads is at least 1
+ */
+void decompress40_parallel (FILE *inputfp, unsigned nthreads);
+
+#endif
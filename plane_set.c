@@ -0,0 +1,119 @@
+/*
+ * Filename  : plane_set.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the plane_set.h interface
+ */
+
+#include <stdlib.h>
+#include "plane_set.h"
+#include "stats40.h"
+
+#define FLOATS_PER_ALIGN (PLANE_ALIGN / sizeof(float))
+
+size_t row_stride (int width);
+
+/*
+ * plane_set_new (int width, int height, int depth)
+ *
+ * Parameters: int width, height: size of each plane in elements
+ *             int depth: number of planes
+ * Returns   : plane_set: the new, uninitialized planes
+ * Does      : Rounds the row stride up to a whole number of PLANE_ALIGN
+ *             byte lines and allocates every plane in one aligned block,
+ *             so each row of each plane starts on a line boundary
+ */
+plane_set plane_set_new (int width, int height, int depth)
+{
+    assert(width >= 0 && height >= 0 && depth > 0);
+
+    plane_set planes = malloc(sizeof(*planes));
+    assert(planes != NULL);
+    planes -> width  = width;
+    planes -> height = height;
+    planes -> depth  = depth;
+    planes -> stride = row_stride(width);
+
+    size_t bytes = planes -> stride * height * depth * sizeof(float);
+    void *data = NULL;
+    int err = posix_memalign(&data, PLANE_ALIGN,
+                             bytes > 0 ? bytes : PLANE_ALIGN);
+    assert(err == 0);
+    planes -> data  = data;
+    planes -> owner = stats40_allocated(bytes);
+
+    return planes;
+}
+
+/*
+ * plane_set_free (plane_set *planes)
+ *
+ * Parameters: plane_set *planes: pointer to the planes to free
+ * Returns   : Nothing
+ * Does      : Frees the planes' storage and the plane_set, and sets it to
+ *             NULL
+ */
+void plane_set_free (plane_set *planes)
+{
+    assert(planes != NULL && *planes != NULL);
+    stats40_freed((*planes) -> owner, (*planes) -> stride *
+                  (*planes) -> height * (*planes) -> depth * sizeof(float));
+    free((*planes) -> data);
+    free(*planes);
+    *planes = NULL;
+}
+
+/*
+ * plane_set_carve (arena40 arena, int width, int height, int depth)
+ *
+ * Parameters: arena40 arena: arena to carve the plane_set from
+ *             int width, height: size of each plane in elements
+ *             int depth: number of planes
+ * Returns   : plane_set: the new, uninitialized planes
+ * Does      : Lays the planes out as plane_set_new does, taking both the
+ *             plane_set and its storage from the arena
+ */
+plane_set plane_set_carve (arena40 arena, int width, int height, int depth)
+{
+    assert(arena != NULL);
+    assert(width >= 0 && height >= 0 && depth > 0);
+    assert(ARENA40_ALIGN % PLANE_ALIGN == 0);
+
+    plane_set planes = arena40_alloc(arena, sizeof(*planes));
+    planes -> width  = width;
+    planes -> height = height;
+    planes -> depth  = depth;
+    planes -> stride = row_stride(width);
+    planes -> owner  = STATS40_ARENA;
+    planes -> data   = arena40_alloc(arena, planes -> stride * height *
+                                            depth * sizeof(float));
+    return planes;
+}
+
+/*
+ * plane_set_bytes (int width, int height, int depth)
+ *
+ * Parameters: int width, height: size of each plane in elements
+ *             int depth: number of planes
+ * Returns   : size_t: arena space used by plane_set_carve for those sizes
+ * Does      : Adds up the two allocations plane_set_carve makes
+ */
+size_t plane_set_bytes (int width, int height, int depth)
+{
+    return arena40_round(sizeof(struct plane_set)) +
+           arena40_round(row_stride(width) * height * depth * sizeof(float));
+}
+
+/*
+ * row_stride (int width)
+ *
+ * Parameters: int width: elements in a row
+ * Returns   : size_t: floats from one row to the next, rounded up to a
+ *                     whole number of PLANE_ALIGN byte lines
+ */
+size_t row_stride (int width)
+{
+    return (width + FLOATS_PER_ALIGN - 1) / FLOATS_PER_ALIGN *
+           FLOATS_PER_ALIGN;
+}
@@ -0,0 +1,90 @@
+/*
+ * Filename  : plane_set.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : A planar image: one 2D array of floats per component, stored
+ *             one after another, with every row starting on a 64-byte
+ *             boundary. The codec stages hand images to each other as
+ *             plane_sets, so each stage reads and writes contiguous runs
+ *             of a single component instead of strided struct fields.
+ */
+
+#ifndef PLANE_SET_INCLUDED
+#define PLANE_SET_INCLUDED
+
+#include <stddef.h>
+#include "assert.h"
+#include "arena40.h"
+#include "stats40.h"
+
+#define PLANE_ALIGN 64 /* bytes; rows of every plane start on this boundary */
+
+/* planes of a component video image, made by rgb_to_ypp */
+enum { Y_PLANE, PB_PLANE, PR_PLANE, NUM_YPP_PLANES };
+
+/* planes of a transformed image, one element per 2x2 block, made by
+ * ypp_to_dct; quantization replaces the values with scaled integers */
+enum { AVGPB_PLANE, AVGPR_PLANE, A_PLANE, B_PLANE, C_PLANE, D_PLANE,
+       NUM_DCT_PLANES };
+
+typedef struct plane_set {
+
+    int width,
+        height,
+        depth;      /* number of planes */
+    size_t stride;  /* floats from the start of one row to the next */
+    float *data;
+    stats40_stage owner; /* stage charged for data by plane_set_new */
+
+} *plane_set;
+
+/*
+ * plane_set_new
+ *
+ * returns a new plane_set of depth planes, each width by height, whose
+ * elements are uninitialized
+ *
+ * assumes width and height are not negative and depth is positive
+ */
+plane_set plane_set_new (int width, int height, int depth);
+
+/*
+ * plane_set_free
+ *
+ * frees the given plane_set and sets it to NULL
+ *
+ * assumes the argument is not NULL
+ */
+void plane_set_free (plane_set *planes);
+
+/*
+ * plane_set_carve
+ *
+ * returns a plane_set like plane_set_new, but carved from the given arena;
+ * it lives until the arena is reset and must not be passed to
+ * plane_set_free
+ */
+plane_set plane_set_carve (arena40 arena, int width, int height, int depth);
+
+/*
+ * plane_set_bytes
+ *
+ * returns the arena space plane_set_carve needs for a plane_set of the
+ * given size
+ */
+size_t plane_set_bytes (int width, int height, int depth);
+
+/*
+ * plane_row
+ *
+ * returns a pointer to the first element of the given row of the given
+ * plane; the row's width elements follow it contiguously
+ */
+static inline float *plane_row (plane_set planes, int plane, int row)
+{
+    return planes -> data + ((size_t) plane * planes -> height + row) *
+                            planes -> stride;
+}
+
+#endif
@@ -7,12 +7,24 @@
  *             image and trims it to be even, or writes a ppm image
  */
 
+#include <stdlib.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "ppm_reader.h"
+#include "except.h"
 
-void trim_ppm(Pnm_ppm image, int width, int height, int size);
-void copy_trimmed (int i, int j, A2Methods_UArray2 array2,
-                                 A2Methods_Object *ptr, 
-                                 void *cl);
+#define RGB8_DENOMINATOR 255 /* largest packed 8-bit sample */
+
+unsigned read_header_number (FILE *fp);
+void fault_in (const void *mapping, size_t bytes);
+bool scan_header_number (FILE *fp, unsigned *n);
+bool check_plain_samples (FILE *fp, size_t count, unsigned denominator);
+void print_pixel (int i, int j, A2Methods_UArray2 array2,
+                                A2Methods_Object *ptr,
+                                void *cl);
 
 /*
  * read_ppm(FILE *fp, A2Methods_T methods)
@@ -23,33 +35,20 @@ void copy_trimmed (int i, int j, A2Methods_UArray2 array2,
  * Returns   : Pnm_ppm: Pnm_ppm containing the ppm representation of the image
  * Does      : Reads the file from the first argument and creates a
  *             Pnm_ppm representation of the image. Trims the width
- *             and height by 1 if they are not even.
+ *             and height by 1 if they are not even. The pixel array is
+ *             left as it was read, so after trimming it is a cropped view:
+ *             only its top left width by height corner is part of the
+ *             image.
  */
 Pnm_ppm read_ppm (FILE *fp, A2Methods_T methods) 
 {
     assert(fp != NULL);
     assert(methods != NULL);
     
-        Pnm_ppm image = Pnm_ppmread(fp, methods);
-    int width  = image -> width, /* obtain information about the image */
-        height = image -> height,
-        size   = image -> methods -> size(image -> pixels);
-
-    bool need_trim = false;
-    if (width % 2 != 0) {
-        width--;
-        need_trim = true;
-    }
-    if (height % 2 != 0) {
-        height--;
-        need_trim = true;
-    }
-    if (need_trim) { /* trim if necessary */
-        trim_ppm(image, width, height, size);
-        return image;
-    } else {
-        return image;
-    }
+    Pnm_ppm image = Pnm_ppmread(fp, methods);
+    image -> width  -= image -> width % 2;
+    image -> height -= image -> height % 2;
+    return image;
 }
 
 /*
@@ -67,66 +66,460 @@ void write_ppm (Pnm_ppm image)
 }
 
 /*
- * trim_ppm(Pnm_ppm image, int width, int height, int size)
+ * write_ppm_to
  * 
- * Parameters: Pnm_ppm image: Pnm_ppm representation of an image,
- *             int width: Integer width of image in pixels,
- *             int height: Integer height of image in pixels,
- *             int size: Integer size of representation of each pixel in bytes
+ * Parameters: FILE *fp: file to write to
+ *             Pnm_ppm image: Pnm_ppm representation of an image
  * Returns   : Nothing
- * Does      : Using the new width and height given as arguments, creates a
- *             new 2D array representation of the image according to the
- *             new dimensions. Does so by creating a new, smaller array (if
- *             necessary), and copies the RGB values from the original array
- *             into the new one
+ * Does      : Writes the ppm image representation to the given file in the
+ *             desired format.
  */
-void trim_ppm (Pnm_ppm image, int width, int height, int size) 
+void write_ppm_to (FILE *fp, Pnm_ppm image) 
 {
-        A2Methods_UArray2 original = image -> pixels; /* keep copy of the original
-                                                   * image */
-    image -> pixels = image -> methods -> new(width, height, size);
-    image -> width  = width;
-    image -> height = height;
+    assert(fp != NULL && image != NULL);
+    Pnm_ppmwrite(fp, image);
+}
 
-    image -> methods -> map_row_major(original, copy_trimmed, &image);
-    
-    image -> methods -> free(&original);
+/*
+ * write_ppm_header (unsigned width, unsigned height, unsigned denominator)
+ * 
+ * Parameters: unsigned width: width of the image in pixels
+ *             unsigned height: height of the image in pixels
+ *             unsigned denominator: maximum value of a pixel sample
+ * Returns   : Nothing
+ * Does      : Writes the header of a binary ppm image to standard out, in
+ *             the same format Pnm_ppmwrite uses
+ */
+void write_ppm_header (unsigned width, unsigned height, unsigned denominator)
+{
+    fprintf(stdout, "P6\n%u %u\n%u\n", width, height, denominator);
 }
 
 /*
- * copy_trimmed(int i, int j, A2Methods_UArray2 array2,
- *                            A2Methods_Object *ptr, 
+ * write_ppm_rgb8 (FILE *fp, const unsigned char *pixels, unsigned width,
+ *                                                        unsigned height)
+ * 
+ * Parameters: FILE *fp: file to write to
+ *             const unsigned char *pixels: rows of packed 8-bit samples,
+ *                                          3 * width bytes apart
+ *             unsigned width: width of the image in pixels
+ *             unsigned height: height of the image in pixels
+ * Returns   : Nothing
+ * Does      : Writes the same header Pnm_ppmwrite does, then every row in
+ *             one fwrite
+ */
+void write_ppm_rgb8 (FILE *fp, const unsigned char *pixels, unsigned width,
+                                                            unsigned height)
+{
+    assert(fp != NULL);
+    fprintf(fp, "P6\n%u %u\n%u\n", width, height,
+            RGB8_DENOMINATOR);
+    size_t bytes = (size_t) width * height * 3;
+    if (bytes > 0) {
+        assert(pixels != NULL);
+        size_t written = fwrite(pixels, 1, bytes, fp);
+        assert(written == bytes);
+    }
+}
+
+/*
+ * write_ppm_rows (A2Methods_UArray2 rows, A2Methods_T methods)
+ * 
+ * Parameters: A2Methods_UArray2 rows: 2D array of Pnm_rgb pixels
+ *             A2Methods_T methods: Method suite for the rows array
+ * Returns   : Nothing
+ * Does      : Writes every pixel in the array, in row major order, to
+ *             standard out as one byte per sample
+ */
+void write_ppm_rows (A2Methods_UArray2 rows, A2Methods_T methods)
+{
+    assert(rows != NULL);
+    assert(methods != NULL);
+    methods -> map_row_major(rows, print_pixel, NULL);
+}
+
+/*
+ * open_ppm_stream (FILE *fp)
+ * 
+ * Parameters: FILE *fp: Pointer to a ppm image file
+ * Returns   : ppm_stream: stream positioned at the first row of pixels
+ * Does      : Reads the magic number, width, height, and denominator of the
+ *             image, and trims the width and height by 1 if they are not
+ *             even. Raises Pnm_Badformat if the header is malformed.
+ */
+ppm_stream open_ppm_stream (FILE *fp)
+{
+    assert(fp != NULL);
+
+    if (getc(fp) != 'P') {
+        RAISE(Pnm_Badformat);
+    }
+    int magic = getc(fp);
+    if (magic != '3' && magic != '6') {
+        RAISE(Pnm_Badformat);
+    }
+
+    ppm_stream stream = malloc(sizeof(*stream));
+    assert(stream != NULL);
+    stream -> fp          = fp;
+    stream -> plain       = (magic == '3');
+    stream -> file_width  = read_header_number(fp);
+    stream -> height      = read_header_number(fp);
+    stream -> denominator = read_header_number(fp);
+    if (stream -> file_width == 0 || stream -> height == 0 ||
+        stream -> denominator == 0 || stream -> denominator > 65535) {
+        RAISE(Pnm_Badformat);
+    }
+    stream -> width  = stream -> file_width - stream -> file_width % 2;
+    stream -> height = stream -> height - stream -> height % 2;
+    stream -> bytes_per_sample = (stream -> denominator < 256) ? 1 : 2;
+
+    stream -> row_buffer = NULL;
+    if (!stream -> plain) {
+        stream -> row_buffer = malloc(stream -> file_width * 3 *
+                                      stream -> bytes_per_sample);
+        assert(stream -> row_buffer != NULL);
+    }
+    return stream;
+}
+
+/*
+ * read_ppm_rows (ppm_stream stream, A2Methods_UArray2 rows,
+ *                                   A2Methods_T methods)
+ * 
+ * Parameters: ppm_stream stream: stream returned by open_ppm_stream
+ *             A2Methods_UArray2 rows: 2D array of Pnm_rgb pixels to fill,
+ *                                     as wide as the stream
+ *             A2Methods_T methods: Method suite for the rows array
+ * Returns   : Nothing
+ * Does      : Reads the next rows of pixels from the file, dropping the
+ *             last column of each row if the file's width is odd. Raises
+ *             Pnm_Badformat if the file ends early.
+ */
+void read_ppm_rows (ppm_stream stream, A2Methods_UArray2 rows,
+                                       A2Methods_T methods)
+{
+    assert(stream != NULL);
+    assert(rows != NULL);
+    assert(methods != NULL);
+    assert((unsigned) methods -> width(rows) == stream -> width);
+
+    int height = methods -> height(rows);
+    unsigned row_bytes = stream -> file_width * 3 * stream -> bytes_per_sample;
+
+    for (int j = 0; j < height; j++) {
+        if (!stream -> plain &&
+            fread(stream -> row_buffer, 1, row_bytes, stream -> fp) !=
+            row_bytes) {
+            RAISE(Pnm_Badformat);
+        }
+        unsigned char *sample = stream -> row_buffer;
+        for (unsigned i = 0; i < stream -> file_width; i++) {
+            unsigned values[3];
+            for (int k = 0; k < 3; k++) {
+                if (stream -> plain) {
+                    if (fscanf(stream -> fp, "%u", &values[k]) != 1) {
+                        RAISE(Pnm_Badformat);
+                    }
+                } else if (stream -> bytes_per_sample == 1) {
+                    values[k] = *sample++;
+                } else { /* two byte samples are big endian */
+                    values[k] = (sample[0] << 8) | sample[1];
+                    sample += 2;
+                }
+            }
+            if (i >= stream -> width) { /* trimmed column */
+                continue;
+            }
+            Pnm_rgb pixel = (Pnm_rgb) methods -> at(rows, i, j);
+            pixel -> red   = values[0];
+            pixel -> green = values[1];
+            pixel -> blue  = values[2];
+        }
+    }
+}
+
+/*
+ * print_pixel (int i, int j, A2Methods_UArray2 array2,
+ *                            A2Methods_Object *ptr,
  *                            void *cl)
  * 
  * Parameters: Integer current column,
  *             Integer current row,
  *             UArray2 representation of the pixel array,
- *             Pointer to the current element in the array (in this case a 
- *                 Pnm_rgb),
- *             Pointer to a closure, which is a closure structure in this case
+ *             Pointer to the current element in the array (a Pnm_rgb),
+ *             Closure, unused
  * Returns   : Nothing
- * Does      : Copies the elements from the original array into the new, 
- *             trimmed array.
+ * Does      : Writes the red, green, and blue samples of the pixel to
+ *             standard out
  */
-void copy_trimmed (int i, int j, A2Methods_UArray2 array2,
-                                 A2Methods_Object *ptr, 
-                                 void *cl) 
-{    
+void print_pixel (int i, int j, A2Methods_UArray2 array2,
+                                A2Methods_Object *ptr,
+                                void *cl)
+{
+    (void) i;
+    (void) j;
     (void) array2;
+    (void) cl;
+
+    Pnm_rgb pixel = (Pnm_rgb) ptr;
+    putchar(pixel -> red);
+    putchar(pixel -> green);
+    putchar(pixel -> blue);
+}
+
+/*
+ * close_ppm_stream (ppm_stream *stream)
+ * 
+ * Parameters: ppm_stream *stream: pointer to the stream to free
+ * Returns   : Nothing
+ * Does      : Frees the stream and its row buffer and sets it to NULL
+ */
+void close_ppm_stream (ppm_stream *stream)
+{
+    assert(stream != NULL && *stream != NULL);
+    free((*stream) -> row_buffer);
+    free(*stream);
+    *stream = NULL;
+}
 
-    Pnm_ppm image = *((Pnm_ppm *) cl);
-    if (i > (int) (image -> width) - 1) {
-        return;
-    } else if (j > (int) (image -> height) - 1) {
-        return;
-    }
-
-    Pnm_rgb old_array_rgb     = (Pnm_rgb) ptr;
-    Pnm_rgb trimmed_array_rgb = (Pnm_rgb) image->methods->at(image->pixels,
-                                                             i, 
-                                                             j);
-    /* make deep copy of rgb values */
-    trimmed_array_rgb -> red   = old_array_rgb -> red; 
-    trimmed_array_rgb -> green = old_array_rgb -> green;
-    trimmed_array_rgb -> blue  = old_array_rgb -> blue;
-}
\ No newline at end of file
+/*
+ * map_ppm (FILE *fp)
+ * 
+ * Parameters: FILE *fp: Pointer to a ppm image file
+ * Returns   : ppm_map: the mapped image, or NULL if it could not be mapped
+ * Does      : Maps a regular file holding a P6 image with a denominator
+ *             below 256 and points into the mapping at its first pixel, so
+ *             no pixel is copied, faulting every page in before returning.
+ *             An odd last column or row is trimmed by
+ *             narrowing the view, not by copying. Anything else leaves fp
+ *             where it was and returns NULL. Raises Pnm_Badformat if a P6
+ *             header is malformed or the file is too short for it.
+ */
+ppm_map map_ppm (FILE *fp)
+{
+    assert(fp != NULL);
+
+    struct stat info;
+    off_t start = ftello(fp);
+    if (start < 0 || fstat(fileno(fp), &info) != 0 ||
+        !S_ISREG(info.st_mode)) {
+        return NULL;
+    }
+    if (getc(fp) != 'P' || getc(fp) != '6') {
+        fseeko(fp, start, SEEK_SET);
+        return NULL;
+    }
+    unsigned file_width  = read_header_number(fp);
+    unsigned height      = read_header_number(fp);
+    unsigned denominator = read_header_number(fp);
+    if (file_width == 0 || height == 0 || denominator == 0) {
+        RAISE(Pnm_Badformat);
+    }
+    if (denominator > 255 || file_width < 2 || height < 2) {
+        fseeko(fp, start, SEEK_SET); /* read_ppm handles these */
+        return NULL;
+    }
+
+    off_t offset  = ftello(fp);
+    size_t stride = (size_t) file_width * 3;
+    if (offset < 0 || info.st_size - offset < (off_t) (stride * height)) {
+        RAISE(Pnm_Badformat);
+    }
+    size_t mapping_size = (size_t) offset + stride * height;
+    void *mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE,
+                         fileno(fp), 0);
+    if (mapping == MAP_FAILED) {
+        fseeko(fp, start, SEEK_SET);
+        return NULL;
+    }
+    madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+    fault_in(mapping, mapping_size);
+
+    ppm_map map = malloc(sizeof(*map));
+    assert(map != NULL);
+    map -> width        = file_width - file_width % 2;
+    map -> height       = height - height % 2;
+    map -> denominator  = denominator;
+    map -> pixels       = (const unsigned char *) mapping + offset;
+    map -> stride       = stride;
+    map -> mapping      = mapping;
+    map -> mapping_size = mapping_size;
+
+    fseeko(fp, (off_t) mapping_size, SEEK_SET); /* past the pixels */
+    return map;
+}
+
+/*
+ * fault_in (const void *mapping, size_t bytes)
+ * 
+ * Parameters: const void *mapping: start of a read only mapping
+ *             size_t bytes: length of the mapping
+ * Returns   : Nothing
+ * Does      : Reads one byte of every page, so the file is read in and
+ *             mapped now. The cost of reading the image is then paid (and
+ *             timed by --stats) in map_ppm, as read_ppm's would be, rather
+ *             than as page faults in whichever stage first touches the
+ *             pixels. MAP_POPULATE would do the same, but not every kernel
+ *             honours it.
+ */
+void fault_in (const void *mapping, size_t bytes)
+{
+    const volatile unsigned char *byte = mapping;
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    unsigned char sink = 0;
+    for (size_t offset = 0; offset < bytes; offset += page) {
+        sink ^= byte[offset];
+    }
+    (void) sink;
+}
+
+/*
+ * unmap_ppm (ppm_map *map)
+ * 
+ * Parameters: ppm_map *map: pointer to the map to release
+ * Returns   : Nothing
+ * Does      : Unmaps the image, frees the map and sets it to NULL
+ */
+void unmap_ppm (ppm_map *map)
+{
+    assert(map != NULL && *map != NULL);
+    munmap((*map) -> mapping, (*map) -> mapping_size);
+    free(*map);
+    *map = NULL;
+}
+
+/*
+ * check_ppm (FILE *fp)
+ * 
+ * Parameters: FILE *fp: Pointer to a ppm image file
+ * Returns   : bool: false if the file is known not to hold a whole image
+ * Does      : Reads the header the way map_ppm does, without raising, and
+ *             checks a binary image's pixels fit in what is left of the
+ *             file, one byte per sample below a denominator of 256 and two
+ *             from there on. A plain image's samples are read through with
+ *             check_plain_samples, since only reading them shows whether
+ *             they are all there. Seeks fp back to where it was.
+ */
+bool check_ppm (FILE *fp)
+{
+    assert(fp != NULL);
+
+    struct stat info;
+    off_t start = ftello(fp);
+    if (start < 0 || fstat(fileno(fp), &info) != 0 ||
+        !S_ISREG(info.st_mode)) {
+        return true;
+    }
+    int p = getc(fp),
+        kind = getc(fp);
+    unsigned width, height, denominator;
+    bool whole = p == 'P' && (kind == '3' || kind == '6') &&
+                 scan_header_number(fp, &width) &&
+                 scan_header_number(fp, &height) &&
+                 scan_header_number(fp, &denominator) &&
+                 width > 0 && height > 0 && denominator > 0 &&
+                 denominator < 65536;
+    if (whole && kind == '6') {
+        off_t offset = ftello(fp);
+        size_t sample = denominator < 256 ? 1 : 2,
+               bytes  = (size_t) width * height * 3 * sample;
+        whole = offset >= 0 && (uintmax_t) (info.st_size - offset) >= bytes;
+    } else if (whole) {
+        whole = check_plain_samples(fp, (size_t) width * height * 3,
+                                    denominator);
+    }
+
+    fseeko(fp, start, SEEK_SET);
+    return whole;
+}
+
+/*
+ * check_plain_samples (FILE *fp, size_t count, unsigned denominator)
+ * 
+ * Parameters: FILE *fp: Pointer to a plain (P3) ppm image file, at its
+ *                       first sample
+ *             size_t count: number of samples the header promises
+ *             unsigned denominator: the largest sample allowed
+ * Returns   : bool: true if there are count well formed samples, none
+ *                   above the denominator
+ * Does      : Reads every sample, skipping whitespace and comments between
+ *             them; the last may end the file
+ */
+bool check_plain_samples (FILE *fp, size_t count, unsigned denominator)
+{
+    for (size_t k = 0; k < count; k++) {
+        int c = getc(fp);
+        while (isspace(c) || c == '#') {
+            if (c == '#') {
+                while (c != '\n' && c != EOF) {
+                    c = getc(fp);
+                }
+            }
+            c = getc(fp);
+        }
+        if (!isdigit(c)) {
+            return false;
+        }
+        unsigned long sample = 0;
+        while (isdigit(c)) {
+            if (sample <= denominator) { /* stop growing once too big */
+                sample = sample * 10 + (c - '0');
+            }
+            c = getc(fp);
+        }
+        if (sample > denominator || (c != EOF && !isspace(c))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * read_header_number (FILE *fp)
+ * 
+ * Parameters: FILE *fp: Pointer to a ppm image file inside its header
+ * Returns   : unsigned: the next number in the header
+ * Does      : Reads the number with scan_header_number, raising
+ *             Pnm_Badformat if there is not one
+ */
+unsigned read_header_number (FILE *fp)
+{
+    unsigned n;
+    if (!scan_header_number(fp, &n)) {
+        RAISE(Pnm_Badformat);
+    }
+    return n;
+}
+
+/*
+ * scan_header_number (FILE *fp, unsigned *n)
+ * 
+ * Parameters: FILE *fp: Pointer to a ppm image file inside its header
+ *             unsigned *n: set to the next number in the header
+ * Returns   : bool: false if the header has no well formed number next
+ * Does      : Skips whitespace and comments, then reads a decimal number.
+ *             The single whitespace character ending the number is
+ *             consumed, so after the denominator fp is at the first pixel.
+ */
+bool scan_header_number (FILE *fp, unsigned *n)
+{
+    int c = getc(fp);
+    while (isspace(c) || c == '#') {
+        if (c == '#') { /* comments run to the end of the line */
+            while (c != '\n' && c != EOF) {
+                c = getc(fp);
+            }
+        }
+        c = getc(fp);
+    }
+    if (!isdigit(c)) {
+        return false;
+    }
+    *n = 0;
+    while (isdigit(c)) {
+        *n = *n * 10 + (c - '0');
+        c = getc(fp);
+    }
+    return isspace(c);
+}
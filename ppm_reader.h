@@ -20,7 +20,9 @@
 /*
  * read_ppm
  * 
- * returns a Pnm_ppm representation of a given ppm image file
+ * returns a Pnm_ppm representation of a given ppm image file, with its width
+ * and height trimmed to be even. The pixel array is not copied when an odd
+ * row or column is trimmed, so it may be one wider or taller than the image
  * 
  * assumes the arguments are not NULL
  */
@@ -36,4 +38,141 @@ Pnm_ppm read_ppm (FILE *fp, A2Methods_T methods);
  */
 void write_ppm (Pnm_ppm image);
 
+/*
+ * write_ppm_to
+ * 
+ * same as write_ppm, but writes to the given file
+ * 
+ * assumes the arguments are not NULL
+ */
+void write_ppm_to (FILE *fp, Pnm_ppm image);
+
+/*
+ * write_ppm_header
+ * 
+ * writes the header of a binary ppm image with the given width, height,
+ * and denominator to standard output
+ */
+void write_ppm_header (unsigned width, unsigned height, unsigned denominator);
+
+/*
+ * write_ppm_rgb8
+ * 
+ * writes a binary ppm image with a denominator of 255 to the given file,
+ * whose width by height pixels are held as contiguous rows of packed 8-bit
+ * red, green, blue samples, with one fwrite
+ * 
+ * assumes fp is not NULL, nor pixels unless the image is empty
+ */
+void write_ppm_rgb8 (FILE *fp, const unsigned char *pixels, unsigned width,
+                                                            unsigned height);
+
+/*
+ * write_ppm_rows
+ * 
+ * writes the pixels in the given 2D array of Pnm_rgb elements, whose values
+ * must be at most 255, to standard output as rows of a binary ppm image.
+ * Used after write_ppm_header when the image is produced a few rows at a
+ * time
+ * 
+ * assumes the arguments are not NULL
+ */
+void write_ppm_rows (A2Methods_UArray2 rows, A2Methods_T methods);
+
+/* state for reading a ppm image a few rows at a time instead of all at
+ * once; width and height are already trimmed to be even */
+typedef struct ppm_stream {
+
+    FILE *fp;
+    bool plain;             /* P3 (ascii) rather than P6 (binary) */
+    unsigned width,
+             height,
+             file_width,    /* width before trimming */
+             denominator,
+             bytes_per_sample;
+    unsigned char *row_buffer; /* one raw row of a binary ppm */
+
+} *ppm_stream;
+
+/*
+ * open_ppm_stream
+ * 
+ * reads the header of a ppm image file and returns a ppm_stream ready to
+ * read the image's rows, top to bottom
+ * 
+ * assumes the argument is not NULL
+ */
+ppm_stream open_ppm_stream (FILE *fp);
+
+/*
+ * read_ppm_rows
+ * 
+ * reads the next rows of the image into the given 2D array of Pnm_rgb
+ * pixels, which must be as wide as the stream; as many rows are read as
+ * the array is tall
+ * 
+ * assumes the arguments are not NULL
+ */
+void read_ppm_rows (ppm_stream stream, A2Methods_UArray2 rows,
+                                       A2Methods_T methods);
+
+/*
+ * close_ppm_stream
+ * 
+ * frees the given ppm_stream; does not close its file
+ * 
+ * assumes the argument is not NULL
+ */
+void close_ppm_stream (ppm_stream *stream);
+
+/* a binary ppm image whose pixels are read in place from a memory mapping
+ * of its file; width and height are already trimmed to be even, and each
+ * row of pixels starts stride bytes after the one above it */
+typedef struct ppm_map {
+
+    unsigned width,
+             height,
+             denominator;
+    const unsigned char *pixels; /* red, green, blue bytes of pixel (0, 0) */
+    size_t stride;
+    void *mapping;               /* whole mapping, for unmap_ppm */
+    size_t mapping_size;
+
+} *ppm_map;
+
+/*
+ * map_ppm
+ * 
+ * returns a ppm_map of the binary ppm image with 8-bit samples in the given
+ * file, or NULL without consuming any input if the file cannot be mapped
+ * or holds some other kind of ppm, so the caller can fall back to read_ppm.
+ * The whole image is read into memory before it returns
+ * 
+ * assumes the argument is not NULL
+ */
+ppm_map map_ppm (FILE *fp);
+
+/*
+ * unmap_ppm
+ * 
+ * unmaps the image and frees the given ppm_map
+ * 
+ * assumes the argument is not NULL
+ */
+void unmap_ppm (ppm_map *map);
+
+/*
+ * check_ppm
+ * 
+ * returns false if the given file is a regular file that is not a whole
+ * ppm image: its header is malformed, it is a binary image whose file is
+ * too short for the header's size, or it is a plain (P3) image with a
+ * sample missing, malformed, or above the denominator. Files that are not
+ * regular cannot be checked without reading them, and pass. Never raises,
+ * and leaves the file where it was
+ * 
+ * assumes the argument is not NULL
+ */
+bool check_ppm (FILE *fp);
+
 #endif
\ No newline at end of file
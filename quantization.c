@@ -8,10 +8,21 @@
  *             of the correct size for bitpacking
  */
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+#include <pthread.h>
 #include "quantization.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define fit_bit_a 63.0 /* turns into unsigned 9 bit */
 #define fit_bit_bcd 100.0 /* turns into signed 5 bit */
+#define NUM_CHROMA 16 /* number of 4-bit chroma indices */
+#define KERNEL_BLOCKS 4 /* blocks quantized per pass of the row kernels */
 
 /* struct containing discrete cosine information */
 typedef struct dctrans {
@@ -25,113 +36,102 @@ typedef struct dctrans {
 
 } *dctrans;
 
+/* chroma_thresholds[k] is the smallest float whose chroma index is more
+ * than k, and chroma_values[n] is the chroma of index n; both are filled
+ * from arith40 the first time either is needed */
+static float chroma_thresholds[NUM_CHROMA - 1];
+static float chroma_values[NUM_CHROMA];
+static pthread_once_t chroma_tables_once = PTHREAD_ONCE_INIT;
+
+void build_chroma_tables (void);
+uint32_t float_order (float x);
+float order_float (uint32_t order);
+unsigned index_of_chroma (float x);
+void quantize_row (plane_set dct_rep, int row);
+void dequantize_row (plane_set dct_rep, int row);
+void load_dct (plane_set dct_rep, int i, int j, dctrans dct);
+void store_dct (plane_set dct_rep, int i, int j, dctrans dct);
 void check_positive (dctrans dct);
 void check_negative (dctrans dct);
 void floats_to_ints (dctrans dct);
 void ints_to_floats (dctrans dct);
-void perform_quantization (int i, int j, A2Methods_UArray2 array2,
-                                         A2Methods_Object *ptr, 
-                                         void *cl);
-void reverse_quantization (int i, int j, A2Methods_UArray2 array2,
-                                         A2Methods_Object *ptr, 
-                                         void *cl);
 
 /* 
- * quantize_c (A2Methods_UArray2 array2, A2Methods_T methods)
+ * quantize_c (plane_set dct_rep)
  * 
- * Parameters: A2Methods_UArray2 array2: array of dctrans structs
- *             A2Methods_T methods: methods for UArray
+ * Parameters: plane_set dct_rep: avgpb, avgpr, a, b, c, and d planes
  * Returns   : None
- * Does      : Maps through the array, performing the necessary quantization on
- *             a, b, c, d, pb, and pr, in order to turn them into the necessary
- *             scaled values
+ * Does      : Goes through the planes a row at a time, performing the
+ *             necessary quantization on a, b, c, d, pb, and pr, in order to
+ *             turn them into the necessary scaled values
  */ 
-void quantize_c (A2Methods_UArray2 array2, A2Methods_T methods) 
+void quantize_c (plane_set dct_rep) 
 {
-    assert(array2 != NULL);
-    assert(methods != NULL);
-    methods -> map_row_major(array2, perform_quantization, methods);
+    assert(dct_rep != NULL);
+    pthread_once(&chroma_tables_once, build_chroma_tables);
+
+    for (int j = 0; j < dct_rep -> height; j++) {
+        quantize_row(dct_rep, j);
+    }
 }
 
 /* 
- * quantize_d (A2Methods_UArray2 array2, A2Methods_T methods)
+ * quantize_d (plane_set dct_rep)
  * 
- * Parameters: A2Methods_UArray2 array2: array of dctrans structs
- *             A2Methods_T methods: methods for UArray2
+ * Parameters: plane_set dct_rep: planes of scaled avgpb, avgpr, a, b, c,
+ *                                and d values
  * Returns   : None
- * Does      : Maps through the array, performing the necessary de-quantization
- *             on scaled values a, b, c, d, pb, and pr, in order to turn them
- *             into the necessary decimal values
+ * Does      : Goes through the planes a row at a time, performing the
+ *             necessary de-quantization on scaled values a, b, c, d, pb,
+ *             and pr, in order to turn them into the necessary decimal
+ *             values
  */ 
-void quantize_d (A2Methods_UArray2 array2, A2Methods_T methods) 
+void quantize_d (plane_set dct_rep) 
 {    
-    assert(array2 != NULL);
-    assert(methods != NULL);
-    methods -> map_row_major(array2, reverse_quantization, methods);
+    assert(dct_rep != NULL);
+    pthread_once(&chroma_tables_once, build_chroma_tables);
+
+    for (int j = 0; j < dct_rep -> height; j++) {
+        dequantize_row(dct_rep, j);
+    }
 }
 
 /* 
- * perform_quantization (int i, int j, A2Methods_UArray2 array2, 
- *                                     A2Methods_Object *ptr, 
- *                                     void *cl)
+ * load_dct (plane_set dct_rep, int i, int j, dctrans dct)
  * 
- * Parameters: int i: index of column
- *             int j: index of row
- *             A2Methods_UArray2 array2: array of dctrans structs
- *             A2Methods_Object *ptr: the dctrans struct at the current index
- *             void *cl: closure struct holding the array of dctrans
- *                       structs and the methods for that array
+ * Parameters: plane_set dct_rep: transform planes
+ *             int i, j: column and row of a block
+ *             dctrans dct: where to store the block's values
  * Returns   : None
- * Does      : apply function which calls helper functions to quantize the a,
- *             b, c, d, pb, and pr values to scaled values in their respective
- *             ranges
- */ 
-void perform_quantization (int i, int j, A2Methods_UArray2 array2,
-                                         A2Methods_Object *ptr, 
-                                         void *cl) 
+ * Does      : gathers one block's values from the six planes
+ */
+void load_dct (plane_set dct_rep, int i, int j, dctrans dct)
 {
-    (void) cl;
-    (void) i;
-    (void) j;
-    (void) array2;
-    
-    dctrans dct = (dctrans) ptr;
-
-    check_positive(dct);
-    check_negative(dct);
-    floats_to_ints(dct);
+    dct -> avgpb = plane_row(dct_rep, AVGPB_PLANE, j)[i];
+    dct -> avgpr = plane_row(dct_rep, AVGPR_PLANE, j)[i];
+    dct -> a     = plane_row(dct_rep, A_PLANE, j)[i];
+    dct -> b     = plane_row(dct_rep, B_PLANE, j)[i];
+    dct -> c     = plane_row(dct_rep, C_PLANE, j)[i];
+    dct -> d     = plane_row(dct_rep, D_PLANE, j)[i];
 }
 
 /* 
- * reverse_quantization (int i, int j, A2Methods_UArray2 array2, 
- *                                     A2Methods_Object *ptr, 
- *                                     void *cl)
+ * store_dct (plane_set dct_rep, int i, int j, dctrans dct)
  * 
- * Parameters: int i: index of column
- *             int j: index of row
- *             A2Methods_UArray2 array2: array of scaled dctrans structs
- *             A2Methods_Object *ptr: the dctrans struct at the current index
- *             void *cl: closure struct holding the array of dctrans
- *                        structs and the methods for that array
+ * Parameters: plane_set dct_rep: transform planes
+ *             int i, j: column and row of a block
+ *             dctrans dct: the block's values
  * Returns   : None
- * Does      : apply function which calls helper functions to de-quantize the
- *             a, b, c, d, pb, and pr values to decimal float values in their
- *             respective ranges
- */ 
-void reverse_quantization (int i, int j, A2Methods_UArray2 array2,
-                                         A2Methods_Object *ptr, 
-                                         void *cl) 
+ * Does      : scatters one block's values into the six planes
+ */
+void store_dct (plane_set dct_rep, int i, int j, dctrans dct)
 {
-    (void) cl;
-    (void) i;
-    (void) j;
-    (void) array2;
-
-    dctrans dct = (dctrans) ptr;
-
-    ints_to_floats(dct);
-    check_positive(dct);
-    check_negative(dct);
+    plane_row(dct_rep, AVGPB_PLANE, j)[i] = dct -> avgpb;
+    plane_row(dct_rep, AVGPR_PLANE, j)[i] = dct -> avgpr;
+    plane_row(dct_rep, A_PLANE, j)[i]     = dct -> a;
+    plane_row(dct_rep, B_PLANE, j)[i]     = dct -> b;
+    plane_row(dct_rep, C_PLANE, j)[i]     = dct -> c;
+    plane_row(dct_rep, D_PLANE, j)[i]     = dct -> d;
 }
 
 
@@ -183,8 +183,8 @@ void check_negative (dctrans dct)
  * Returns   : None
  * Does      : performs the actual quantization of a, b, c, and d values,
  *             transforming a into a 9-bit scaled integer, b, c, and d into
- *             5-bit scaled integers, and calling Arith_40_index_of_chroma
- *             on the pb and pr values to get 4-bit scaled integers.
+ *             5-bit scaled integers, and looking up the 4-bit chroma index
+ *             Arith40_index_of_chroma would give for the pb and pr values.
  */
 void floats_to_ints (dctrans dct) 
 {   
@@ -192,13 +192,13 @@ void floats_to_ints (dctrans dct)
     dct -> b = round((dct -> b) * fit_bit_bcd);
     dct -> c = round((dct -> c) * fit_bit_bcd);
     dct -> d = round((dct -> d) * fit_bit_bcd);
-    dct -> avgpb = Arith40_index_of_chroma(dct -> avgpb);
-    dct -> avgpr = Arith40_index_of_chroma(dct -> avgpr);
+    dct -> avgpb = index_of_chroma(dct -> avgpb);
+    dct -> avgpr = index_of_chroma(dct -> avgpr);
 }
 
 
 /* 
- * floats_to_ints (dctrans dct)
+ * ints_to_floats (dctrans dct)
  * 
  * Parameters: dctrans dct: dctrans struct at the current index in array
  * Returns   : None
@@ -211,6 +211,241 @@ void ints_to_floats (dctrans dct)
     dct -> b = (dct -> b) / fit_bit_bcd;
     dct -> c = (dct -> c) / fit_bit_bcd;
     dct -> d = (dct -> d) / fit_bit_bcd;
-    dct -> avgpb = Arith40_chroma_of_index(dct -> avgpb);
-    dct -> avgpr = Arith40_chroma_of_index(dct -> avgpr);
-}
\ No newline at end of file
+    dct -> avgpb = chroma_values[(unsigned) dct -> avgpb];
+    dct -> avgpr = chroma_values[(unsigned) dct -> avgpr];
+}
+
+/* 
+ * build_chroma_tables (void)
+ * 
+ * Parameters: None
+ * Returns   : None
+ * Does      : fills chroma_values from Arith40_chroma_of_index, and finds
+ *             each of chroma_thresholds by bisecting over every float for
+ *             the first one Arith40_index_of_chroma puts past that index.
+ *             Since the thresholds come from arith40 itself, counting the
+ *             thresholds at or below a value gives exactly the index
+ *             arith40 would. Called once, through pthread_once.
+ */
+void build_chroma_tables (void)
+{
+    for (unsigned n = 0; n < NUM_CHROMA; n++) {
+        chroma_values[n] = Arith40_chroma_of_index(n);
+    }
+    for (unsigned k = 0; k < NUM_CHROMA - 1; k++) {
+        uint32_t low  = float_order(-FLT_MAX), /* index <= k */
+                 high = float_order(FLT_MAX);  /* index >  k */
+        while (high - low > 1) {
+            uint32_t mid = low + (high - low) / 2;
+            if (Arith40_index_of_chroma(order_float(mid)) > k) {
+                high = mid;
+            } else {
+                low = mid;
+            }
+        }
+        chroma_thresholds[k] = order_float(high);
+    }
+}
+
+/* 
+ * float_order (float x)
+ * 
+ * Parameters: float x: any float other than NaN
+ * Returns   : uint32_t: key which sorts the same way the floats do
+ * Does      : flips the bits of negative floats and the sign bit of
+ *             positive ones, so that comparing keys compares floats
+ */
+uint32_t float_order (float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+/* 
+ * order_float (uint32_t order)
+ * 
+ * Parameters: uint32_t order: key made by float_order
+ * Returns   : float: the float the key was made from
+ * Does      : undoes float_order
+ */
+float order_float (uint32_t order)
+{
+    uint32_t bits = (order & 0x80000000u) ? order & 0x7fffffffu : ~order;
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/* 
+ * index_of_chroma (float x)
+ * 
+ * Parameters: float x: average chroma of a block
+ * Returns   : unsigned: the 4-bit index Arith40_index_of_chroma gives x
+ * Does      : counts the chroma thresholds at or below x
+ */
+unsigned index_of_chroma (float x)
+{
+    unsigned n = 0;
+    for (unsigned k = 0; k < NUM_CHROMA - 1; k++) {
+        n += (x >= chroma_thresholds[k]);
+    }
+    return n;
+}
+
+#ifdef __SSE2__
+/* 
+ * round_away_pd (__m128d x)
+ * 
+ * Parameters: __m128d x: two doubles, each a float times 63 or 100
+ * Returns   : __m128d: each rounded half away from zero, as round() does
+ * Does      : truncates |x| + 0.5 and puts the sign back. The adds are
+ *             exact because x has at most 31 significant bits, so this
+ *             matches round() for every value quantization can see.
+ */
+static inline __m128d round_away_pd (__m128d x)
+{
+    __m128d sign = _mm_and_pd(x, _mm_set1_pd(-0.0));
+    __m128d mag  = _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+    __m128d r    = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_add_pd(mag,
+                                                   _mm_set1_pd(0.5))));
+    return _mm_or_pd(r, sign);
+}
+
+/* 
+ * scale_ps (__m128 v, double scale, bool quantize)
+ * 
+ * Parameters: __m128 v: four floats
+ *             double scale: factor to scale by
+ *             bool quantize: multiply and round if true, divide if false
+ * Returns   : __m128: each float scaled in double precision, as the scalar
+ *             code does, and rounded back to a float
+ */
+static inline __m128 scale_ps (__m128 v, double scale, bool quantize)
+{
+    __m128d lanes[2] = { _mm_cvtps_pd(v), _mm_cvtps_pd(_mm_movehl_ps(v, v)) };
+    for (int h = 0; h < 2; h++) {
+        if (quantize) {
+            lanes[h] = round_away_pd(_mm_mul_pd(lanes[h],
+                                                _mm_set1_pd(scale)));
+        } else {
+            lanes[h] = _mm_div_pd(lanes[h], _mm_set1_pd(scale));
+        }
+    }
+    return _mm_movelh_ps(_mm_cvtpd_ps(lanes[0]), _mm_cvtpd_ps(lanes[1]));
+}
+
+/* 
+ * clamp_bcd_ps (__m128 v)
+ * 
+ * Parameters: __m128 v: four b, c, or d values
+ * Returns   : __m128: each value held to [-0.3, 0.3]
+ * Does      : the same as check_positive and check_negative: a float is
+ *             above the double 0.3 exactly when it is at least the float
+ *             0.3, so a float min and max give the same results
+ */
+static inline __m128 clamp_bcd_ps (__m128 v)
+{
+    return _mm_max_ps(_mm_min_ps(v, _mm_set1_ps(0.3f)),
+                      _mm_set1_ps(-0.3f));
+}
+#endif
+
+/* 
+ * quantize_row (plane_set dct_rep, int row)
+ * 
+ * Parameters: plane_set dct_rep: transform planes
+ *             int row: row of the planes to quantize
+ * Returns   : None
+ * Does      : clamps and quantizes a whole row of every plane,
+ *             KERNEL_BLOCKS at a time with SSE2 where it is available,
+ *             giving the same values as the scalar helpers. Each plane is
+ *             loaded and stored in place, with no gathering. Leftover
+ *             blocks at the end of the row go through check_positive,
+ *             check_negative, and floats_to_ints.
+ */
+void quantize_row (plane_set dct_rep, int row)
+{
+    int blocks = dct_rep -> width,
+        i      = 0;
+
+#ifdef __SSE2__
+    float *plane[NUM_DCT_PLANES];
+    for (int c = 0; c < NUM_DCT_PLANES; c++) {
+        plane[c] = plane_row(dct_rep, c, row);
+    }
+    for (; i + KERNEL_BLOCKS <= blocks; i += KERNEL_BLOCKS) {
+        for (int c = AVGPB_PLANE; c <= AVGPR_PLANE; c++) {
+            __m128 x = _mm_load_ps(&plane[c][i]);
+            __m128i n = _mm_setzero_si128(); /* thresholds at or below */
+            for (int k = 0; k < NUM_CHROMA - 1; k++) {
+                n = _mm_sub_epi32(n, _mm_castps_si128(_mm_cmpge_ps(x,
+                                  _mm_set1_ps(chroma_thresholds[k]))));
+            }
+            _mm_store_ps(&plane[c][i], _mm_cvtepi32_ps(n));
+        }
+        _mm_store_ps(&plane[A_PLANE][i], scale_ps(_mm_load_ps(
+                     &plane[A_PLANE][i]), fit_bit_a, true));
+        for (int c = B_PLANE; c <= D_PLANE; c++) {
+            _mm_store_ps(&plane[c][i], scale_ps(clamp_bcd_ps(
+                         _mm_load_ps(&plane[c][i])), fit_bit_bcd, true));
+        }
+    }
+#endif
+
+    for (; i < blocks; i++) {
+        struct dctrans dct;
+        load_dct(dct_rep, i, row, &dct);
+        check_positive(&dct);
+        check_negative(&dct);
+        floats_to_ints(&dct);
+        store_dct(dct_rep, i, row, &dct);
+    }
+}
+
+/* 
+ * dequantize_row (plane_set dct_rep, int row)
+ * 
+ * Parameters: plane_set dct_rep: planes of quantized values
+ *             int row: row of the planes to dequantize
+ * Returns   : None
+ * Does      : dequantizes and clamps a whole row of every plane,
+ *             KERNEL_BLOCKS at a time with SSE2 where it is available,
+ *             giving the same values as the scalar helpers. Leftover
+ *             blocks at the end of the row go through ints_to_floats,
+ *             check_positive, and check_negative.
+ */
+void dequantize_row (plane_set dct_rep, int row)
+{
+    int blocks = dct_rep -> width,
+        i      = 0;
+
+#ifdef __SSE2__
+    float *plane[NUM_DCT_PLANES];
+    for (int c = 0; c < NUM_DCT_PLANES; c++) {
+        plane[c] = plane_row(dct_rep, c, row);
+    }
+    for (; i + KERNEL_BLOCKS <= blocks; i += KERNEL_BLOCKS) {
+        for (int c = AVGPB_PLANE; c <= AVGPR_PLANE; c++) {
+            for (int k = 0; k < KERNEL_BLOCKS; k++) {
+                plane[c][i + k] = chroma_values[(unsigned) plane[c][i + k]];
+            }
+        }
+        _mm_store_ps(&plane[A_PLANE][i], scale_ps(_mm_load_ps(
+                     &plane[A_PLANE][i]), fit_bit_a, false));
+        for (int c = B_PLANE; c <= D_PLANE; c++) {
+            _mm_store_ps(&plane[c][i], clamp_bcd_ps(scale_ps(
+                         _mm_load_ps(&plane[c][i]), fit_bit_bcd, false)));
+        }
+    }
+#endif
+
+    for (; i < blocks; i++) {
+        struct dctrans dct;
+        load_dct(dct_rep, i, row, &dct);
+        ints_to_floats(&dct);
+        check_positive(&dct);
+        check_negative(&dct);
+        store_dct(dct_rep, i, row, &dct);
+    }
+}
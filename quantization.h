@@ -16,25 +16,26 @@
 #include "arith40.h"
 #include "pnm.h"
 #include "assert.h"
+#include "plane_set.h"
 
 /*
  * quantize_c
  * 
- * scales the discrete cosine values in the given array2 so the 
+ * scales the discrete cosine values in the given planes so the 
  * values are represented as both signed and unsigned integers
  * 
- * assumes the arguments are not NULL
+ * assumes the argument is not NULL
  */
-void quantize_c (A2Methods_UArray2 array2, A2Methods_T methods);
+void quantize_c (plane_set dct_rep);
 
 /*
  * quantize_d
  * 
- * scales the discrete cosine values in the given array2 so the 
+ * scales the discrete cosine values in the given planes so the 
  * values are represented as floating point values
  * 
- * assumes the arguments are not NULL
+ * assumes the argument is not NULL
  */
-void quantize_d (A2Methods_UArray2 array2, A2Methods_T methods);
+void quantize_d (plane_set dct_rep);
 
 #endif
\ No newline at end of file
@@ -6,30 +6,41 @@
  * Summary   : Implementation of the read_bitfile.h interface
  */
 
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "read_bitfile.h"
 
-#define PRINT_TYPE uint32_t
 #define SIZE 64
 #define SIGNED_T int64_t
 #define UNSIGNED_T uint64_t
+#define CODEWORD_BYTES 4 /* bytes of each codeword in the file */
+#define WRITE_BUFFER_BYTES (1 << 18) /* bytes handed to each write */
+#define READ_BUFFER_BYTES (1 << 18) /* bytes asked for by each fread */
 
 /* exception to be raised when not enough codewords are read */
 Except_T NO_CODEWORDS_LEFT = { "Not enough words to complete the image" };
 
-/* closure struct containing a uarray2 and the methods for a uarray2 */
-typedef struct closure_struct {
+/* exception to be raised when the bit file cannot be written */
+Except_T WRITE_FAILED = { "Could not write the compressed image" };
 
-    FILE *fp;
-    A2Methods_T methods;
+/* function which writes n bytes to a sink (a FILE * or a file descriptor) */
+typedef void emit_fun(void *sink, const unsigned char *bytes, size_t n);
 
-} *closure_struct;
-
-void print_codewords (int i, int j, A2Methods_UArray2 array2,
-                                 A2Methods_Object *ptr, 
-                                 void *cl);
-void populate_word_array (int i, int j, A2Methods_UArray2 array2,
-                                        A2Methods_Object *ptr, 
-                                        void *cl);
+void emit_codewords (A2Methods_T methods, A2Methods_UArray2 array2,
+                                          emit_fun emit, void *sink);
+void pack_big_endian (const UNSIGNED_T *words, int count,
+                      unsigned char *bytes);
+void emit_stdio (void *sink, const unsigned char *bytes, size_t n);
+void emit_fd (void *sink, const unsigned char *bytes, size_t n);
+bool map_codewords (FILE *fp, A2Methods_T methods, A2Methods_UArray2 array2);
+void store_codeword_row (A2Methods_T methods, A2Methods_UArray2 array2,
+                                              int row,
+                                              const unsigned char *bytes);
+void unpack_big_endian (const unsigned char *bytes, int count,
+                        UNSIGNED_T *words);
 
 /*
  * read_bitfile(FILE *fp, A2Methods_T)
@@ -39,93 +50,228 @@ void populate_word_array (int i, int j, A2Methods_UArray2 array2,
  *                                  manipulate 2D arrays
  * Returns   : A2Methods_UArray2 of codewords
  * Does      : Reads the given file and returns a 2D array where each block
- *             of pixels is represented by a 32 bit codeword
+ *             of pixels is represented by a 32 bit codeword. Regular files
+ *             are memory mapped; anything else is read with large freads.
  */
 A2Methods_UArray2 read_bitfile (FILE *fp, A2Methods_T methods)
 {
     assert(fp != NULL);
     assert(methods != NULL);
     unsigned height, width;
-    int read = fscanf(fp, "COMP40 Compressed image format 2\n%u %u", &width, 
-                                                                     &height);
-    assert(read == 2);
-    int c = getc(fp);
-    assert(c == '\n');
+    read_bitfile_header(fp, &width, &height);
     width = width / 2; /* we got the width of the image, not the blocked
                         * representation */
     height = height / 2;
     A2Methods_UArray2 codeword_rep = methods -> new(width, height, 
                                                            sizeof(UNSIGNED_T));
-    
-    closure_struct cl = malloc(sizeof(*cl));
-    cl -> fp = fp;
-    cl -> methods = methods;
+    if (!map_codewords(fp, methods, codeword_rep)) {
+        read_codewords(fp, methods, codeword_rep);
+    }
 
-    methods -> map_row_major(codeword_rep, populate_word_array, cl);
+    return codeword_rep;
+}
 
-    free(cl);
+/*
+ * read_bitfile_header (FILE *fp, unsigned *width, unsigned *height)
+ * 
+ * Parameters: FILE *fp: pointer to an image file containing 32 bit codewords
+ *             unsigned *width: set to the width of the image in pixels
+ *             unsigned *height: set to the height of the image in pixels
+ * Returns   : Nothing
+ * Does      : Reads the header of the bit file, leaving fp at the first
+ *             codeword
+ */
+void read_bitfile_header (FILE *fp, unsigned *width, unsigned *height)
+{
+    assert(fp != NULL);
+    assert(width != NULL && height != NULL);
+    int read = fscanf(fp, "COMP40 Compressed image format 2\n%u %u", width, 
+                                                                     height);
+    assert(read == 2);
+    int c = getc(fp);
+    assert(c == '\n');
+}
 
-    return codeword_rep;
+/*
+ * check_bitfile (FILE *fp)
+ * 
+ * Parameters: FILE *fp: pointer to an image file containing 32 bit codewords
+ * Returns   : bool: false if the file is known not to hold a whole image
+ * Does      : Reads the header as read_bitfile_header does, without its
+ *             asserts, and checks the rest of the file holds a codeword for
+ *             every 2x2 block, as map_codewords does. Seeks fp back to
+ *             where it was.
+ */
+bool check_bitfile (FILE *fp)
+{
+    assert(fp != NULL);
+
+    struct stat info;
+    off_t start = ftello(fp);
+    if (start < 0 || fstat(fileno(fp), &info) != 0 ||
+        !S_ISREG(info.st_mode)) {
+        return true;
+    }
+    unsigned width, height;
+    int read = fscanf(fp, "COMP40 Compressed image format 2\n%u %u", &width,
+                                                                  &height);
+    bool whole = read == 2 && getc(fp) == '\n';
+    if (whole) {
+        off_t offset = ftello(fp);
+        size_t payload = (size_t) (width / 2) * (height / 2) *
+                         CODEWORD_BYTES;
+        whole = offset >= 0 &&
+                (uintmax_t) (info.st_size - offset) >= payload;
+    }
+
+    fseeko(fp, start, SEEK_SET);
+    return whole;
 }
 
 /*
- * populate_word_array (int i, int j, A2Methods_UArray2 array2,
- *                                    A2Methods_Object *ptr, 
- *                                    void *cl)
+ * read_codewords (FILE *fp, A2Methods_T methods, A2Methods_UArray2 array2)
  * 
- * Parameters: int i: current col
- *             int j: current row
- *             A2Methods_UArray2 array2: codeword array being mapped through
- *             A2Methods_Object *ptr: pointer to the current codeword in the
- *                                    array
- *             void *cl: closure
+ * Parameters: FILE *fp: pointer to an image file, positioned at a codeword
+ *             A2Methods_T methods: method suite to manipulate 2D arrays
+ *             A2Methods_UArray2 array2: 2D array of codewords to fill
  * Returns   : Nothing
- * Does      : Reads the next 32 bits in the file to obtain the codeword for 
- *             the current position in the 2D array representation
+ * Does      : Reads as many codewords as the array holds, in row major
+ *             order, from the file into the array. Whole rows are read
+ *             with one fread per READ_BUFFER_BYTES; raises
+ *             NO_CODEWORDS_LEFT the first time the file comes up short.
  */
-void populate_word_array (int i, int j, A2Methods_UArray2 array2,
-                                        A2Methods_Object *ptr, 
-                                        void *cl)
+void read_codewords (FILE *fp, A2Methods_T methods, A2Methods_UArray2 array2)
 {
-    (void) i;
-    (void) j;
-    (void) array2;
-
-    closure_struct cl_struct = (closure_struct) cl;
-    UNSIGNED_T *word = (UNSIGNED_T *) ptr;
-    
-    int c = getc(cl_struct -> fp);
-    if (c == EOF) {
-        if((i + 1) * (j + 1) != (cl_struct -> methods -> width(array2) *
-                                 cl_struct -> methods -> height(array2))) {
-            RAISE(NO_CODEWORDS_LEFT);
-        }
+    assert(fp != NULL);
+    assert(methods != NULL);
+    assert(array2 != NULL);
+
+    int width  = methods -> width(array2),
+        height = methods -> height(array2);
+    if (width == 0 || height == 0) {
+        return;
     }
-    *word = Bitpack_newu(*word, 8, 24, c);
-    c = getc(cl_struct -> fp);
-    if (c == EOF) {
-        if((i + 1) * (j + 1) != (cl_struct -> methods -> width(array2) *
-                                 cl_struct -> methods -> height(array2))) {
-            RAISE(NO_CODEWORDS_LEFT);
-        }
+    size_t row_bytes = (size_t) width * CODEWORD_BYTES;
+    int buffer_rows = READ_BUFFER_BYTES / row_bytes;
+    if (buffer_rows < 1) {
+        buffer_rows = 1;
     }
-    *word = Bitpack_newu(*word, 8, 16, c);
-    c = getc(cl_struct -> fp);
-    if (c == EOF) {
-        if((i + 1) * (j + 1) != (cl_struct -> methods -> width(array2) *
-                                 cl_struct -> methods -> height(array2))) {
+    unsigned char *buffer = malloc(row_bytes * buffer_rows);
+    assert(buffer != NULL);
+
+    for (int j = 0; j < height; j += buffer_rows) {
+        int rows = height - j < buffer_rows ? height - j : buffer_rows;
+        if (fread(buffer, row_bytes, rows, fp) != (size_t) rows) {
+            free(buffer);
             RAISE(NO_CODEWORDS_LEFT);
         }
+        for (int k = 0; k < rows; k++) {
+            store_codeword_row(methods, array2, j + k,
+                               buffer + k * row_bytes);
+        }
     }
-    *word = Bitpack_newu(*word, 8, 8, c);
-    c = getc(cl_struct -> fp);
-    if (c == EOF) {
-        if((i + 1) * (j + 1) != (cl_struct -> methods -> width(array2) *
-                                 cl_struct -> methods -> height(array2))) {
-            RAISE(NO_CODEWORDS_LEFT);
+    free(buffer);
+}
+
+/*
+ * map_codewords (FILE *fp, A2Methods_T methods, A2Methods_UArray2 array2)
+ * 
+ * Parameters: FILE *fp: pointer to an image file, positioned at the first
+ *                       codeword
+ *             A2Methods_T methods: method suite to manipulate 2D arrays
+ *             A2Methods_UArray2 array2: 2D array of codewords to fill
+ * Returns   : bool: true if the codewords were read, false if the file
+ *                   cannot be memory mapped (a pipe, for instance)
+ * Does      : Checks up front that the file holds every codeword, raising
+ *             NO_CODEWORDS_LEFT if it does not, then maps the file and
+ *             converts the codewords straight out of the mapping. Leaves
+ *             fp just past the last codeword.
+ */
+bool map_codewords (FILE *fp, A2Methods_T methods, A2Methods_UArray2 array2)
+{
+    struct stat info;
+    int fd = fileno(fp);
+    off_t offset = ftello(fp); /* stdio may have read ahead of fd */
+    if (fd < 0 || offset < 0 || fstat(fd, &info) != 0 ||
+        !S_ISREG(info.st_mode)) {
+        return false;
+    }
+
+    int width  = methods -> width(array2),
+        height = methods -> height(array2);
+    size_t row_bytes = (size_t) width * CODEWORD_BYTES,
+           payload   = row_bytes * height;
+    if ((uintmax_t) (info.st_size - offset) < payload) {
+        RAISE(NO_CODEWORDS_LEFT);
+    }
+    if (payload == 0) {
+        return true;
+    }
+
+    unsigned char *file = mmap(NULL, offset + payload, PROT_READ,
+                               MAP_PRIVATE, fd, 0);
+    if (file == MAP_FAILED) {
+        return false;
+    }
+    madvise(file, offset + payload, MADV_SEQUENTIAL);
+    for (int j = 0; j < height; j++) {
+        store_codeword_row(methods, array2, j,
+                           file + offset + j * row_bytes);
+    }
+    munmap(file, offset + payload);
+
+    int seeked = fseeko(fp, offset + payload, SEEK_SET);
+    assert(seeked == 0);
+    return true;
+}
+
+/*
+ * store_codeword_row (A2Methods_T methods, A2Methods_UArray2 array2,
+ *                                          int row,
+ *                                          const unsigned char *bytes)
+ * 
+ * Parameters: A2Methods_T methods: method suite to manipulate 2D arrays
+ *             A2Methods_UArray2 array2: 2D array of codewords to fill
+ *             int row: row of the array to fill
+ *             const unsigned char *bytes: the row's codewords, big endian
+ * Returns   : Nothing
+ * Does      : Converts a row of codewords from the file into the array,
+ *             in one pass when the array keeps its rows contiguous (a
+ *             blocksize of 1) and through at() when it does not
+ */
+void store_codeword_row (A2Methods_T methods, A2Methods_UArray2 array2,
+                                              int row,
+                                              const unsigned char *bytes)
+{
+    int width = methods -> width(array2);
+    if (methods -> blocksize(array2) == 1) {
+        unpack_big_endian(bytes, width, methods -> at(array2, 0, row));
+    } else {
+        for (int i = 0; i < width; i++) {
+            unpack_big_endian(bytes + i * CODEWORD_BYTES, 1,
+                              methods -> at(array2, i, row));
         }
     }
-    *word = Bitpack_newu(*word, 8, 0, c);
+}
+
+/*
+ * unpack_big_endian (const unsigned char *bytes, int count,
+ *                    UNSIGNED_T *words)
+ * 
+ * Parameters: const unsigned char *bytes: 4 * count bytes from the file
+ *             int count: number of codewords
+ *             UNSIGNED_T *words: contiguous codewords to fill
+ * Returns   : Nothing
+ * Does      : Reassembles each big endian 32 bit codeword
+ */
+void unpack_big_endian (const unsigned char *bytes, int count,
+                        UNSIGNED_T *words)
+{
+    for (int i = 0; i < count; i++) {
+        const unsigned char *b = bytes + i * CODEWORD_BYTES;
+        words[i] = (uint32_t) b[0] << 24 | (uint32_t) b[1] << 16 |
+                   (uint32_t) b[2] << 8  | (uint32_t) b[3];
+    }
 }
 
 /*
@@ -143,39 +289,177 @@ void write_bitfile (A2Methods_T methods, A2Methods_UArray2 array2)
     assert(array2 != NULL);
     int width  = methods -> width(array2),
         height = methods -> height(array2);
-    fprintf(stdout, "COMP40 Compressed image format 2\n%u %u", width * 2, height * 2);
+    write_bitfile_header(width * 2, height * 2);
+    write_codewords(methods, array2);
+}
+
+/*
+ * write_bitfile_header (unsigned width, unsigned height)
+ * 
+ * Parameters: unsigned width: width of the image in pixels
+ *             unsigned height: height of the image in pixels
+ * Returns   : Nothing
+ * Does      : Writes the bitfile header for an image of the given size to
+ *             stdout according to the specifications
+ */
+void write_bitfile_header (unsigned width, unsigned height)
+{
+    fprintf(stdout, "COMP40 Compressed image format 2\n%u %u", width, height);
     fprintf(stdout, "\n");
-    methods -> map_row_major(array2, print_codewords, methods);
-    
 }
 
 /*
- * print_codewords (int i, int j, A2Methods_UArray2 array2,
- *                                A2Methods_Object *ptr, 
- *                                void *cl)
+ * write_codewords (A2Methods_T methods, A2Methods_UArray2 array2)
+ * 
+ * Parameters: A2Methods_T methods: method suite to manipulate 2D arrays
+ *             A2Methods_UArray2 array2: 2D array of codewords
+ * Returns   : Nothing
+ * Does      : Writes every codeword in the given array to stdout, without
+ *             a header
+ */
+void write_codewords (A2Methods_T methods, A2Methods_UArray2 array2)
+{
+    assert(methods != NULL);
+    assert(array2 != NULL);
+    emit_codewords(methods, array2, emit_stdio, stdout);
+}
+
+/*
+ * write_bitfile_fd (int fd, A2Methods_T methods, A2Methods_UArray2 array2)
+ * 
+ * Parameters: int fd: file descriptor open for writing
+ *             A2Methods_T methods: method suite to manipulate 2D arrays
+ *             A2Methods_UArray2 array2: 2D array of codewords
+ * Returns   : Nothing
+ * Does      : Writes the header and every codeword straight to the file
+ *             descriptor with write, bypassing stdio
+ */
+void write_bitfile_fd (int fd, A2Methods_T methods, A2Methods_UArray2 array2)
+{
+    assert(fd >= 0);
+    assert(methods != NULL);
+    assert(array2 != NULL);
+    char header[64];
+    int length = snprintf(header, sizeof(header),
+                          "COMP40 Compressed image format 2\n%u %u\n",
+                          methods -> width(array2) * 2,
+                          methods -> height(array2) * 2);
+    assert(length > 0 && (size_t) length < sizeof(header));
+    emit_fd(&fd, (unsigned char *) header, length);
+    emit_codewords(methods, array2, emit_fd, &fd);
+}
+
+/*
+ * emit_codewords (A2Methods_T methods, A2Methods_UArray2 array2,
+ *                                      emit_fun emit, void *sink)
+ * 
+ * Parameters: A2Methods_T methods: method suite to manipulate 2D arrays
+ *             A2Methods_UArray2 array2: 2D array of codewords
+ *             emit_fun emit: function which writes bytes to the sink
+ *             void *sink: where the codewords go
+ * Returns   : Nothing
+ * Does      : Converts whole rows of codewords to big endian bytes in a
+ *             buffer of about WRITE_BUFFER_BYTES, and hands the buffer to
+ *             emit each time it fills, so the file is written with a few
+ *             large writes rather than four putchars per codeword
+ */
+void emit_codewords (A2Methods_T methods, A2Methods_UArray2 array2,
+                                          emit_fun emit, void *sink)
+{
+    int width  = methods -> width(array2),
+        height = methods -> height(array2);
+    if (width == 0 || height == 0) {
+        return;
+    }
+    size_t row_bytes = (size_t) width * CODEWORD_BYTES;
+    int buffer_rows = WRITE_BUFFER_BYTES / row_bytes;
+    if (buffer_rows < 1) {
+        buffer_rows = 1;
+    }
+    unsigned char *buffer = malloc(row_bytes * buffer_rows);
+    assert(buffer != NULL);
+
+    /* arrays with a blocksize of 1 keep each row contiguous in memory */
+    bool contiguous = methods -> blocksize(array2) == 1;
+    int buffered = 0;
+    for (int j = 0; j < height; j++) {
+        unsigned char *row = buffer + buffered * row_bytes;
+        if (contiguous) {
+            pack_big_endian(methods -> at(array2, 0, j), width, row);
+        } else {
+            for (int i = 0; i < width; i++) {
+                pack_big_endian(methods -> at(array2, i, j), 1,
+                                row + i * CODEWORD_BYTES);
+            }
+        }
+        buffered++;
+        if (buffered == buffer_rows || j == height - 1) {
+            emit(sink, buffer, buffered * row_bytes);
+            buffered = 0;
+        }
+    }
+    free(buffer);
+}
+
+/*
+ * pack_big_endian (const UNSIGNED_T *words, int count, unsigned char *bytes)
+ * 
+ * Parameters: const UNSIGNED_T *words: contiguous codewords
+ *             int count: number of codewords
+ *             unsigned char *bytes: 4 * count bytes to fill
+ * Returns   : Nothing
+ * Does      : Stores the low 32 bits of each codeword in big endian order
+ */
+void pack_big_endian (const UNSIGNED_T *words, int count,
+                      unsigned char *bytes)
+{
+    for (int i = 0; i < count; i++) {
+        uint32_t codeword = (uint32_t) words[i];
+        bytes[i * CODEWORD_BYTES]     = codeword >> 24;
+        bytes[i * CODEWORD_BYTES + 1] = codeword >> 16;
+        bytes[i * CODEWORD_BYTES + 2] = codeword >> 8;
+        bytes[i * CODEWORD_BYTES + 3] = codeword;
+    }
+}
+
+/*
+ * emit_stdio (void *sink, const unsigned char *bytes, size_t n)
  * 
- * Parameters: int i: current col
- *             int j: current row
- *             A2Methods_UArray2 array2: codeword array being mapped through
- *             A2Methods_Object *ptr: pointer to the current codeword in the
- *                                    array
- *             void *cl: closure
+ * Parameters: void *sink: FILE * to write to
+ *             const unsigned char *bytes: bytes to write
+ *             size_t n: number of bytes
  * Returns   : Nothing
- * Does      : Prints the codewords in big endian order to standard output
+ * Does      : Writes the bytes with one fwrite; raises WRITE_FAILED if
+ *             they are not all written
  */
-void print_codewords (int i, int j, A2Methods_UArray2 array2,
-                                 A2Methods_Object *ptr, 
-                                 void *cl) 
+void emit_stdio (void *sink, const unsigned char *bytes, size_t n)
 {
-    (void) i;
-    (void) j;
-    (void) array2;
-    (void) cl;
-
-    PRINT_TYPE codeword = *((PRINT_TYPE *) ptr);
-
-    putchar(Bitpack_getu(codeword, 8, 24));
-    putchar(Bitpack_gets(codeword, 8, 16));
-    putchar(Bitpack_getu(codeword, 8, 8));
-    putchar(Bitpack_getu(codeword, 8, 0));
-}
\ No newline at end of file
+    if (fwrite(bytes, 1, n, (FILE *) sink) != n) {
+        RAISE(WRITE_FAILED);
+    }
+}
+
+/*
+ * emit_fd (void *sink, const unsigned char *bytes, size_t n)
+ * 
+ * Parameters: void *sink: pointer to the file descriptor to write to
+ *             const unsigned char *bytes: bytes to write
+ *             size_t n: number of bytes
+ * Returns   : Nothing
+ * Does      : Calls write until every byte is written, retrying when
+ *             interrupted; raises WRITE_FAILED on any other error
+ */
+void emit_fd (void *sink, const unsigned char *bytes, size_t n)
+{
+    int fd = *(int *) sink;
+    while (n > 0) {
+        ssize_t written = write(fd, bytes, n);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            RAISE(WRITE_FAILED);
+        }
+        bytes += written;
+        n -= written;
+    }
+}
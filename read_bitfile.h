@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "a2methods.h"
 #include "malloc.h"
 #include "a2plain.h"
@@ -28,6 +29,39 @@
  */
 A2Methods_UArray2 read_bitfile (FILE *fp, A2Methods_T methods);
 
+/*
+ * read_bitfile_header
+ * 
+ * reads the header of a bit file, giving the width and height of the image
+ * in pixels, and leaves the file at the first codeword
+ * 
+ * assumes the arguments are not NULL
+ */
+void read_bitfile_header (FILE *fp, unsigned *width, unsigned *height);
+
+/*
+ * check_bitfile
+ * 
+ * returns false if the given file is a regular file that is not a whole
+ * bit file: its header is malformed, or it is too short for the codewords
+ * the header promises. Files that are not regular pass. Never raises, and
+ * leaves the file where it was
+ * 
+ * assumes the argument is not NULL
+ */
+bool check_bitfile (FILE *fp);
+
+/*
+ * read_codewords
+ * 
+ * reads the next codewords of a bit file into the given 2D array of 64 bit
+ * codewords, in row major order, until the array is full. Used after
+ * read_bitfile_header when the codewords are consumed a few rows at a time
+ * 
+ * assumes the arguments are not NULL
+ */
+void read_codewords (FILE *fp, A2Methods_T methods, A2Methods_UArray2 array2);
+
 /*
  * write_bitfile
  * 
@@ -38,4 +72,34 @@ A2Methods_UArray2 read_bitfile (FILE *fp, A2Methods_T methods);
  */
 void write_bitfile (A2Methods_T methods, A2Methods_UArray2 array2);
 
+/*
+ * write_bitfile_header
+ * 
+ * writes the header of a bit file for an image of the given width and
+ * height (in pixels) to standard output
+ */
+void write_bitfile_header (unsigned width, unsigned height);
+
+/*
+ * write_codewords
+ * 
+ * writes the codewords in the given 2D array, in row major order and big
+ * endian byte order, to standard output. Used after write_bitfile_header
+ * when the codewords are produced a few rows at a time
+ * 
+ * assumes the arguments are not NULL
+ */
+void write_codewords (A2Methods_T methods, A2Methods_UArray2 array2);
+
+/*
+ * write_bitfile_fd
+ * 
+ * same as write_bitfile, but writes straight to the given file descriptor
+ * with write instead of going through stdio. Anything already written to
+ * a FILE * on the same descriptor must be flushed first
+ * 
+ * assumes fd is open for writing and the other arguments are not NULL
+ */
+void write_bitfile_fd (int fd, A2Methods_T methods, A2Methods_UArray2 array2);
+
 #endif
\ No newline at end of file
@@ -1,177 +1,549 @@
-/* 
+/*
  * Filename: rgb_ypp.c
- * 
+ *
  * Authors   : Robert Lester, Craig Cagner
  * Assignment: Arith
- * Summary   : In compression, transforms an array of Pnm_rgb structs to an
- *             array of component_video structs. In decompression, transforms
- *             an array of component_video structs to an array of Pnm_rgb
- *             structs. 
+ * Summary   : In compression, transforms an array of Pnm_rgb structs to
+ *             y, pb, and pr planes. In decompression, transforms y, pb, and
+ *             pr planes to an array of Pnm_rgb structs.
+ *
+ *             Every path gives the same bits as pixel_to_cv, so compressed
+ *             images do not depend on the method suite or the input format.
+ *             Rows of 8-bit samples look each channel's three products up
+ *             in a table built once per call (ypp_table), and Pnm_rgb rows,
+ *             whose samples can be 16 bits, are split into lanes with
+ *             shuffles.
  */
 
 #include "rgb_ypp.h"
 
-/* struct created to hold the y, pb, and pr values of a cv per pixel,
- * converted from rgb pixels */
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define KERNEL_PIXELS 8 /* pixels converted per pass of the row kernels */
+#define TABLE_SAMPLES 256 /* entries of a ypp_table: every 8-bit sample */
+#define NUM_CHANNELS 3  /* red, green, and blue */
+#define RGB8_CHUNK 64   /* pixels staged as Pnm_rgbs by ypp_to_rgb8_rows */
+
+/* struct created to hold the y, pb, and pr values of one pixel, converted
+ * from an rgb pixel; the scalar helpers work a pixel at a time on these */
 typedef struct component_video {
 
-    float y, 
-          pb, 
+    float y,
+          pb,
           pr;
 
 } *component_video;
 
+/* each channel's term of y, pb, and pr for every 8-bit sample at one
+ * denominator: the double product of the weight and the scaled sample
+ * exactly as pixel_to_cv forms it, with the sign of a subtracted term
+ * folded in, so adding a pixel's three terms in pixel_to_cv's order gives
+ * its bits */
+typedef struct ypp_table {
 
-/* closure struct which holds a 2d uarray and the methods for a 2d uarray 
- * as well as an unsigned integer representing the ppm image's denominator */
-typedef struct closure_struct {
+    double terms[NUM_YPP_PLANES][NUM_CHANNELS][TABLE_SAMPLES];
 
-    A2Methods_UArray2 array2;
-    A2Methods_T methods;
-    unsigned denominator;
+} *ypp_table;
 
-} *closure_struct;
 
-void convert_to_cv (int i, int j, A2Methods_UArray2 array2,
-                                  A2Methods_Object *ptr, 
-                                  void *cl);
-void convert_to_rgb (int i, int j, A2Methods_UArray2 array2,
-                                   A2Methods_Object *ptr, 
-                                   void *cl);
+void pixel_to_cv (Pnm_rgb rgb_rep, component_video ypp_rep, float denominator);
+void store_cv (component_video ypp_rep, plane_set planes, int i, int j);
+void rgb_row_to_ypp (const struct Pnm_rgb *rgb_row, float *y, float *pb,
+                                                    float *pr, int width,
+                                                    unsigned denominator);
+void fill_ypp_table (ypp_table table, unsigned denominator);
+void rgb8_row_to_ypp (const unsigned char *rgb_row, float *y, float *pb,
+                                                    float *pr, int width,
+                                                    ypp_table table);
+void cv_to_pixel (component_video ypp_rep, Pnm_rgb rgb_rep);
+void ypp_row_to_rgb (const float *y, const float *pb, const float *pr,
+                     struct Pnm_rgb *rgb_row, int width);
 
-/* 
- * rgb_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods,
+/*
+ * rgb_to_ypp (A2Methods_UArray2 array2, int width, int height,
+ *                                       A2Methods_T methods,
  *                                       unsigned denominator)
- * 
+ *
  * Parameters: A2Methods_UArray2 array2: array of rgb pixels from ppm image
+ *             int width, height: size of the top left corner of array2 to
+ *                                convert, at most the size of array2
  *             A2Methods_T methods: methods for UArray2
  *             unsigned denominator: denominator used to scale rgb values
- * Returns   : A2Methods_UArray2: array of component_video structs in place
- *                                of the rgb pixels 
- * Does      : Takes in a Pnm_ppm pixel map and overwrites the Pnm_rgb
- *             structs with component_video structs
+ * Returns   : plane_set: width by height y, pb, and pr planes in place of
+ *                        the rgb pixels
+ * Does      : Takes in a Pnm_ppm pixel map and converts its Pnm_rgb
+ *             structs into y, pb, and pr planes. Pixels outside the given
+ *             width and height, such as the odd last column of an image
+ *             trimmed by read_ppm, are skipped.
  */
-A2Methods_UArray2 rgb_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods,
-                                                        unsigned denominator) 
+plane_set rgb_to_ypp (A2Methods_UArray2 array2, int width, int height,
+                                                A2Methods_T methods,
+                                                unsigned denominator)
 {
     assert(array2 != NULL);
     assert(methods != NULL);
-    A2Methods_UArray2 ypp_rep = methods -> new(methods -> width(array2), 
-                                               methods -> height(array2),
-                                               sizeof(struct component_video));
-    closure_struct cl = malloc(sizeof(*cl));
-    assert(cl != NULL);
-    cl -> array2 = ypp_rep;
-    cl -> methods = methods;
-    cl -> denominator = denominator;
+    plane_set ypp_rep = plane_set_new(width, height, NUM_YPP_PLANES);
 
-    methods -> map_row_major(array2, convert_to_cv, cl);
-
-    free(cl);
+    rgb_rows_to_ypp(array2, methods, denominator, 0, ypp_rep);
 
     return ypp_rep;
 }
 
-/* 
- * ypp_to_rgb (A2Methods_UArray2 array2, A2Methods_T methods)
- * 
- * Parameters: A2Methods_UArray2 array2: array of component_video structs
+/*
+ * rgb_rows_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods,
+ *                  unsigned denominator, int first_row, plane_set ypp_rep)
+ *
+ * Parameters: A2Methods_UArray2 array2: array of rgb pixels from ppm image
  *             A2Methods_T methods: methods for UArray2
- * Returns   : A2Methods_UArray2: array of Pnm_rgb structs for a Pnm_ppm 
+ *             unsigned denominator: denominator used to scale rgb values
+ *             int first_row: row of array2 that goes in the planes' top row
+ *             plane_set ypp_rep: y, pb, and pr planes to fill
+ * Returns   : None
+ * Does      : Converts the pixels from first_row down that the planes have
+ *             room for, leaving the rest of array2 alone, so an image can
+ *             be converted a band of rows at a time into the same planes
+ */
+void rgb_rows_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods,
+                      unsigned denominator, int first_row, plane_set ypp_rep)
+{
+    assert(array2 != NULL && methods != NULL && ypp_rep != NULL);
+    int width  = ypp_rep -> width,
+        height = ypp_rep -> height;
+    assert(width <= methods -> width(array2));
+    assert(first_row >= 0 && first_row + height <= methods -> height(array2));
+
+    /* arrays with a blocksize of 1 keep each row contiguous in memory, so
+     * whole rows can go through the row kernel */
+    if (methods -> blocksize(array2) == 1 && width > 0) {
+        for (int j = 0; j < height; j++) {
+            rgb_row_to_ypp(methods -> at(array2, 0, first_row + j),
+                           plane_row(ypp_rep, Y_PLANE, j),
+                           plane_row(ypp_rep, PB_PLANE, j),
+                           plane_row(ypp_rep, PR_PLANE, j),
+                           width, denominator);
+        }
+        return;
+    }
+
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            struct component_video cv;
+            pixel_to_cv(methods -> at(array2, i, first_row + j), &cv,
+                        (float) denominator);
+            store_cv(&cv, ypp_rep, i, j);
+        }
+    }
+}
+
+/*
+ * rgb8_to_ypp (const unsigned char *pixels, size_t stride, int width,
+ *              int height, unsigned denominator)
+ *
+ * Parameters: const unsigned char *pixels: first sample of the top row of
+ *                                          packed 8-bit rgb pixels
+ *             size_t stride: bytes from the start of one row to the next
+ *             int width, height: size of the image in pixels
+ *             unsigned denominator: denominator used to scale rgb values
+ * Returns   : plane_set: y, pb, and pr planes
+ * Does      : Converts an image held as rows of bytes, such as the pixels
+ *             of a memory mapped binary ppm, without building Pnm_rgb
+ *             structs first. The stride may be wider than the image, so
+ *             an odd column can be left off without copying.
+ */
+plane_set rgb8_to_ypp (const unsigned char *pixels, size_t stride,
+                       int width, int height, unsigned denominator)
+{
+    assert(pixels != NULL);
+    assert(stride >= (size_t) width * 3);
+    plane_set ypp_rep = plane_set_new(width, height, NUM_YPP_PLANES);
+
+    rgb8_rows_to_ypp(pixels, stride, denominator, ypp_rep);
+
+    return ypp_rep;
+}
+
+/*
+ * rgb8_rows_to_ypp (const unsigned char *pixels, size_t stride,
+ *                   unsigned denominator, plane_set ypp_rep)
+ *
+ * Parameters: const unsigned char *pixels: first sample of the first row
+ *                                          to convert
+ *             size_t stride: bytes from the start of one row to the next
+ *             unsigned denominator: denominator used to scale rgb values
+ *             plane_set ypp_rep: y, pb, and pr planes to fill
+ * Returns   : None
+ * Does      : Fills a ypp_table for the denominator, then converts as many
+ *             rows of bytes as the planes have room for through it
+ */
+void rgb8_rows_to_ypp (const unsigned char *pixels, size_t stride,
+                       unsigned denominator, plane_set ypp_rep)
+{
+    assert(pixels != NULL && ypp_rep != NULL);
+    assert(stride >= (size_t) ypp_rep -> width * 3);
+
+    struct ypp_table table;
+    fill_ypp_table(&table, denominator);
+    for (int j = 0; j < ypp_rep -> height; j++) {
+        rgb8_row_to_ypp(pixels + j * stride,
+                        plane_row(ypp_rep, Y_PLANE, j),
+                        plane_row(ypp_rep, PB_PLANE, j),
+                        plane_row(ypp_rep, PR_PLANE, j),
+                        ypp_rep -> width, &table);
+    }
+}
+
+/*
+ * ypp_to_rgb (plane_set ypp_rep, A2Methods_T methods)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes
+ *             A2Methods_T methods: methods for the new UArray2
+ * Returns   : A2Methods_UArray2: array of Pnm_rgb structs for a Pnm_ppm
  *                                pixel map
- * Does      : Takes in a UArray2 of component_video structs, converts the 
- *             values to red, green, and blue pixel values for Pnm_rgb structs
- *             and overwrites the array with Pnm_rgb structs in place of
- *             component_video structs
+ * Does      : Takes in y, pb, and pr planes, converts the values to red,
+ *             green, and blue pixel values, and returns them as an array of
+ *             Pnm_rgb structs
  */
-A2Methods_UArray2 ypp_to_rgb (A2Methods_UArray2 array2, A2Methods_T methods) 
+A2Methods_UArray2 ypp_to_rgb (plane_set ypp_rep, A2Methods_T methods)
 {
-    assert(array2 != NULL);
+    assert(ypp_rep != NULL);
     assert(methods != NULL);
-    A2Methods_UArray2 rgb_rep = methods -> new(methods -> width(array2), 
-                                               methods -> height(array2),
+    A2Methods_UArray2 rgb_rep = methods -> new(ypp_rep -> width,
+                                               ypp_rep -> height,
                                                sizeof(struct Pnm_rgb));
-    closure_struct cl = malloc(sizeof(*cl));
-    assert(cl != NULL);
-    cl -> array2 = rgb_rep;
-    cl -> methods = methods;
-    cl -> denominator = (unsigned) 0; /* don't need denominator at this point
-                                       * for decompression */
-    methods -> map_row_major(array2, convert_to_rgb, cl);
 
-    free(cl);
+    ypp_to_rgb_rows(ypp_rep, rgb_rep, methods, 0);
 
     return rgb_rep;
 }
 
-/* 
- * void convert_to_cv (int i, int j, A2Methods_UArray2 array2, 
- *                                   A2Methods_Object *ptr, 
- *                                   void *cl)
- * 
- * Parameters: int i: index of column
- *             int j: index of row
- *             A2Methods_UArray2 array2: pixel map for ppm image
- *             A2Methods_Object *ptr: the Pnm_rgb struct at the current index
- *             void *cl: closure struct holding the array of component_video
- *                       structs and the methods for that array
+/*
+ * ypp_to_rgb_rows (plane_set ypp_rep, A2Methods_UArray2 rgb_rep,
+ *                  A2Methods_T methods, int first_row)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes
+ *             A2Methods_UArray2 rgb_rep: array of Pnm_rgb structs to fill
+ *             A2Methods_T methods: methods for rgb_rep
+ *             int first_row: row of rgb_rep that the planes' top row fills
  * Returns   : None
- * Does      : apply function performs the actual calculations to transform
- *             the red, green, and blue values into the y, pb, and pr values
- *             for a component_video struct, and overwrites the array of 
- *             Pnm_rgb structs
+ * Does      : The inverse of rgb_rows_to_ypp; fills the rows of rgb_rep
+ *             from first_row down that the planes cover
+ */
+void ypp_to_rgb_rows (plane_set ypp_rep, A2Methods_UArray2 rgb_rep,
+                      A2Methods_T methods, int first_row)
+{
+    assert(ypp_rep != NULL && rgb_rep != NULL && methods != NULL);
+    int width  = ypp_rep -> width,
+        height = ypp_rep -> height;
+    assert(width <= methods -> width(rgb_rep));
+    assert(first_row >= 0 && first_row + height <= methods -> height(rgb_rep));
+
+    /* as in rgb_rows_to_ypp, contiguous rows go through the row kernel */
+    if (methods -> blocksize(rgb_rep) == 1 && width > 0) {
+        for (int j = 0; j < height; j++) {
+            ypp_row_to_rgb(plane_row(ypp_rep, Y_PLANE, j),
+                           plane_row(ypp_rep, PB_PLANE, j),
+                           plane_row(ypp_rep, PR_PLANE, j),
+                           methods -> at(rgb_rep, 0, first_row + j), width);
+        }
+        return;
+    }
+
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            struct component_video cv = {
+                plane_row(ypp_rep, Y_PLANE, j)[i],
+                plane_row(ypp_rep, PB_PLANE, j)[i],
+                plane_row(ypp_rep, PR_PLANE, j)[i]
+            };
+            cv_to_pixel(&cv, methods -> at(rgb_rep, i, first_row + j));
+        }
+    }
+}
+
+/*
+ * ypp_to_rgb8_rows (plane_set ypp_rep, unsigned char *pixels, size_t stride)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes
+ *             unsigned char *pixels: first sample of the top row to fill
+ *             size_t stride: bytes from the start of one row to the next
+ * Returns   : None
+ * Does      : Converts each row RGB8_CHUNK pixels at a time through the
+ *             row kernel into a small array of Pnm_rgbs on the stack, then
+ *             narrows those to bytes, so the output is bit-identical to
+ *             ypp_to_rgb_rows. RGB8_CHUNK is a multiple of KERNEL_PIXELS,
+ *             so every chunk starts on an aligned element of the planes
  */
-void convert_to_cv (int i, int j, A2Methods_UArray2 array2,
-                                  A2Methods_Object *ptr, 
-                                  void *cl) 
-{    
-    (void) array2;
-    
-    closure_struct cl_struct = (closure_struct) cl;
-    Pnm_rgb rgb_rep = (Pnm_rgb) ptr;
-    
+void ypp_to_rgb8_rows (plane_set ypp_rep, unsigned char *pixels,
+                       size_t stride)
+{
+    assert(ypp_rep != NULL && pixels != NULL);
+    int width  = ypp_rep -> width,
+        height = ypp_rep -> height;
+    assert(stride >= (size_t) width * 3);
+
+    struct Pnm_rgb chunk[RGB8_CHUNK];
+    for (int j = 0; j < height; j++) {
+        unsigned char *row = pixels + j * stride;
+        for (int i = 0; i < width; i += RGB8_CHUNK) {
+            int n = width - i < RGB8_CHUNK ? width - i : RGB8_CHUNK;
+            ypp_row_to_rgb(plane_row(ypp_rep, Y_PLANE, j) + i,
+                           plane_row(ypp_rep, PB_PLANE, j) + i,
+                           plane_row(ypp_rep, PR_PLANE, j) + i, chunk, n);
+            for (int k = 0; k < n; k++) {
+                row[(i + k) * 3]     = chunk[k].red;
+                row[(i + k) * 3 + 1] = chunk[k].green;
+                row[(i + k) * 3 + 2] = chunk[k].blue;
+            }
+        }
+    }
+}
+
+/*
+ * pixel_to_cv (Pnm_rgb rgb_rep, component_video ypp_rep, float denominator)
+ *
+ * Parameters: Pnm_rgb rgb_rep: pixel to convert
+ *             component_video ypp_rep: where to store the converted pixel
+ *             float denominator: denominator used to scale rgb values
+ * Returns   : None
+ * Does      : performs the actual calculations to transform the red, green,
+ *             and blue values of one pixel into y, pb, and pr values
+ */
+void pixel_to_cv (Pnm_rgb rgb_rep, component_video ypp_rep, float denominator)
+{
     /* obtain values */
-    float red   = (float) rgb_rep -> red / (float) cl_struct -> denominator,
-          green = (float) rgb_rep -> green / (float) cl_struct -> denominator,
-          blue  = (float) rgb_rep -> blue / (float) cl_struct -> denominator;
-    
-    component_video ypp_rep = (component_video) cl_struct -> 
-                                                methods -> 
-                                                at(cl_struct -> array2, i, j);
+    float red   = (float) rgb_rep -> red / denominator,
+          green = (float) rgb_rep -> green / denominator,
+          blue  = (float) rgb_rep -> blue / denominator;
+
     /* make necessary calculations */
     ypp_rep -> y  = 0.299 * red + 0.587 * green + 0.114 * blue;
     ypp_rep -> pb = -0.168736 * red - 0.331264 * green + 0.5 * blue;
     ypp_rep -> pr = 0.5 * red - 0.418688 * green - 0.081312 * blue;
 }
 
+/*
+ * store_cv (component_video ypp_rep, plane_set planes, int i, int j)
+ *
+ * Parameters: component_video ypp_rep: values of one pixel
+ *             plane_set planes: y, pb, and pr planes to store them in
+ *             int i, j: column and row of the pixel
+ * Returns   : None
+ * Does      : writes the pixel's y, pb, and pr values into their planes
+ */
+void store_cv (component_video ypp_rep, plane_set planes, int i, int j)
+{
+    plane_row(planes, Y_PLANE, j)[i]  = ypp_rep -> y;
+    plane_row(planes, PB_PLANE, j)[i] = ypp_rep -> pb;
+    plane_row(planes, PR_PLANE, j)[i] = ypp_rep -> pr;
+}
+
+/*
+ * fill_ypp_table (ypp_table table, unsigned denominator)
+ *
+ * Parameters: ypp_table table: the table to fill
+ *             unsigned denominator: denominator used to scale rgb values
+ * Returns   : None
+ * Does      : Scales every 8-bit sample the way pixel_to_cv does, and
+ *             multiplies it by each channel's weight for y, pb, and pr
+ */
+void fill_ypp_table (ypp_table table, unsigned denominator)
+{
+    static const double weights[NUM_YPP_PLANES][NUM_CHANNELS] = {
+        {  0.299,     0.587,     0.114    },
+        { -0.168736, -0.331264,  0.5      },
+        {  0.5,      -0.418688, -0.081312 }
+    };
+    for (int v = 0; v < TABLE_SAMPLES; v++) {
+        float scaled = (float) v / (float) denominator;
+        for (int p = 0; p < NUM_YPP_PLANES; p++) {
+            for (int c = 0; c < NUM_CHANNELS; c++) {
+                table -> terms[p][c][v] = weights[p][c] * scaled;
+            }
+        }
+    }
+}
+
+/*
+ * sum_terms (double terms[][TABLE_SAMPLES],
+ *            const unsigned char *sample)
+ *
+ * Parameters: double terms[][TABLE_SAMPLES]: one plane's terms from a
+ *                                            ypp_table
+ *             const unsigned char *sample: a pixel's red, green, and blue
+ * Returns   : float: the pixel's value in the plane
+ * Does      : Adds the three terms in the order pixel_to_cv does
+ */
+static inline float sum_terms (double terms[][TABLE_SAMPLES],
+                               const unsigned char *sample)
+{
+    return (terms[0][sample[0]] + terms[1][sample[1]]) + terms[2][sample[2]];
+}
+
+#ifdef __SSE2__
+/*
+ * samples_to_ypp (__m128 red, __m128 green, __m128 blue, float *y,
+ *                 float *pb, float *pr)
+ *
+ * Parameters: __m128 red, green, blue: 4 samples each, already divided by
+ *                                      the denominator
+ *             float *y, *pb, *pr: 4 elements of each plane to fill,
+ *                                 16-byte aligned
+ * Returns   : None
+ * Does      : the SSE2 core of rgb_row_to_ypp. The samples are combined in
+ *             double precision exactly as pixel_to_cv does, two pixels per
+ *             register, so both give bit-identical results.
+ */
+static inline void samples_to_ypp (__m128 red, __m128 green, __m128 blue,
+                                   float *y, float *pb, float *pr)
+{
+    __m128 out[NUM_YPP_PLANES][2];
+    for (int h = 0; h < 2; h++) { /* low half, then high half */
+        __m128d r = _mm_cvtps_pd(h == 0 ? red : _mm_movehl_ps(red, red)),
+                g = _mm_cvtps_pd(h == 0 ? green : _mm_movehl_ps(green,
+                                                                green)),
+                b = _mm_cvtps_pd(h == 0 ? blue : _mm_movehl_ps(blue, blue));
+        __m128d yd = _mm_add_pd(_mm_add_pd(
+                _mm_mul_pd(_mm_set1_pd(0.299), r),
+                _mm_mul_pd(_mm_set1_pd(0.587), g)),
+                _mm_mul_pd(_mm_set1_pd(0.114), b));
+        __m128d pbd = _mm_add_pd(_mm_sub_pd(
+                _mm_mul_pd(_mm_set1_pd(-0.168736), r),
+                _mm_mul_pd(_mm_set1_pd(0.331264), g)),
+                _mm_mul_pd(_mm_set1_pd(0.5), b));
+        __m128d prd = _mm_sub_pd(_mm_sub_pd(
+                _mm_mul_pd(_mm_set1_pd(0.5), r),
+                _mm_mul_pd(_mm_set1_pd(0.418688), g)),
+                _mm_mul_pd(_mm_set1_pd(0.081312), b));
+        out[Y_PLANE][h]  = _mm_cvtpd_ps(yd);
+        out[PB_PLANE][h] = _mm_cvtpd_ps(pbd);
+        out[PR_PLANE][h] = _mm_cvtpd_ps(prd);
+    }
+    _mm_store_ps(y,  _mm_movelh_ps(out[Y_PLANE][0], out[Y_PLANE][1]));
+    _mm_store_ps(pb, _mm_movelh_ps(out[PB_PLANE][0], out[PB_PLANE][1]));
+    _mm_store_ps(pr, _mm_movelh_ps(out[PR_PLANE][0], out[PR_PLANE][1]));
+}
+
+/*
+ * split_channels (const struct Pnm_rgb *pixels, __m128 denom, __m128 *red,
+ *                 __m128 *green, __m128 *blue)
+ *
+ * Parameters: const struct Pnm_rgb *pixels: 4 contiguous pixels
+ *             __m128 denom: denominator used to scale rgb values
+ *             __m128 *red, *green, *blue: set to the 4 scaled samples of
+ *                                         each channel
+ * Returns   : None
+ * Does      : Loads the 12 samples as three vectors, r0 g0 b0 r1 | g1 b1 r2
+ *             g2 | b2 r3 g3 b3, gathers each channel with two shuffles
+ *             into pairs and one more into place, and divides by the
+ *             denominator as pixel_to_cv does
+ */
+static inline void split_channels (const struct Pnm_rgb *pixels,
+                                   __m128 denom, __m128 *red,
+                                   __m128 *green, __m128 *blue)
+{
+    const __m128i *samples = (const __m128i *) pixels;
+    __m128 a = _mm_castsi128_ps(_mm_loadu_si128(&samples[0])),
+           b = _mm_castsi128_ps(_mm_loadu_si128(&samples[1])),
+           c = _mm_castsi128_ps(_mm_loadu_si128(&samples[2]));
+
+    __m128 r = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)),
+                              _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+                              _MM_SHUFFLE(2, 0, 2, 0)),
+           g = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                              _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                              _MM_SHUFFLE(2, 0, 2, 0)),
+           bl = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                               _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+                               _MM_SHUFFLE(2, 0, 2, 0));
+
+    *red   = _mm_div_ps(_mm_cvtepi32_ps(_mm_castps_si128(r)), denom);
+    *green = _mm_div_ps(_mm_cvtepi32_ps(_mm_castps_si128(g)), denom);
+    *blue  = _mm_div_ps(_mm_cvtepi32_ps(_mm_castps_si128(bl)), denom);
+}
+#endif
 
-/* 
- * void convert_to_rgb (int i, int j, A2Methods_UArray2 array2, 
- *                                    A2Methods_Object *ptr, 
- *                                    void *cl)
- * 
- * Parameters: int i: index of column
- *             int j: index of row
- *             A2Methods_UArray2 array2: array of component_video structs
- *             A2Methods_Object *ptr: the component_video struct at the 
- *                                    current index
- *             void *cl: closure struct holding the array of Pnm_rgb
- *                       structs and the methods for that array
+/*
+ * rgb_row_to_ypp (const struct Pnm_rgb *rgb_row, float *y, float *pb,
+ *                                                float *pr, int width,
+ *                                                unsigned denominator)
+ *
+ * Parameters: const struct Pnm_rgb *rgb_row: contiguous row of pixels
+ *             float *y, *pb, *pr: rows of the planes to fill
+ *             int width: number of pixels in the row
+ *             unsigned denominator: denominator used to scale rgb values
  * Returns   : None
- * Does      : apply function performs the actual calculations to transform
- *             the y, pb, and pr values into the red, green, and blue values
- *             for a Pnm_rgb struct, and overwrites the array of 
- *             component_video structs
+ * Does      : converts a whole row of pixels, 4 at a time with SSE2 where
+ *             it is available, splitting them into channels with
+ *             split_channels for samples_to_ypp. Samples may be 16 bits,
+ *             too many for a ypp_table, so they are still divided.
+ *             Leftover pixels at the end of the row go through pixel_to_cv.
  */
-void convert_to_rgb (int i, int j, A2Methods_UArray2 array2,
-                                   A2Methods_Object *ptr, 
-                                   void *cl) 
+void rgb_row_to_ypp (const struct Pnm_rgb *rgb_row, float *y, float *pb,
+                                                    float *pr, int width,
+                                                    unsigned denominator)
 {
-    (void) array2;
+    int i = 0;
 
-    closure_struct cl_struct = (closure_struct) cl;
-    component_video ypp_rep = (component_video) ptr;
+#ifdef __SSE2__
+    __m128 denom = _mm_set1_ps((float) denominator);
+    for (; i + 4 <= width; i += 4) {
+        __m128 red, green, blue;
+        split_channels(&rgb_row[i], denom, &red, &green, &blue);
+        samples_to_ypp(red, green, blue, &y[i], &pb[i], &pr[i]);
+    }
+#endif
 
+    for (; i < width; i++) {
+        struct component_video ypp_rep;
+        pixel_to_cv((Pnm_rgb) &rgb_row[i], &ypp_rep, (float) denominator);
+        y[i]  = ypp_rep.y;
+        pb[i] = ypp_rep.pb;
+        pr[i] = ypp_rep.pr;
+    }
+}
+
+/*
+ * rgb8_row_to_ypp (const unsigned char *rgb_row, float *y, float *pb,
+ *                                                float *pr, int width,
+ *                                                ypp_table table)
+ *
+ * Parameters: const unsigned char *rgb_row: row of packed 8-bit red,
+ *                                           green, blue samples
+ *             float *y, *pb, *pr: rows of the planes to fill
+ *             int width: number of pixels in the row
+ *             ypp_table table: terms for the image's denominator
+ * Returns   : None
+ * Does      : the same as rgb_row_to_ypp, but reads the samples straight
+ *             from the bytes of a binary ppm, and adds up each value from
+ *             three table lookups instead of dividing and multiplying. A
+ *             byte always indexes the table, even one above the
+ *             denominator.
+ */
+void rgb8_row_to_ypp (const unsigned char *rgb_row, float *y, float *pb,
+                                                    float *pr, int width,
+                                                    ypp_table table)
+{
+    for (int i = 0; i < width; i++, rgb_row += NUM_CHANNELS) {
+        y[i]  = sum_terms(table -> terms[Y_PLANE], rgb_row);
+        pb[i] = sum_terms(table -> terms[PB_PLANE], rgb_row);
+        pr[i] = sum_terms(table -> terms[PR_PLANE], rgb_row);
+    }
+}
+
+/*
+ * cv_to_pixel (component_video ypp_rep, Pnm_rgb rgb_rep)
+ *
+ * Parameters: component_video ypp_rep: component video values to convert
+ *             Pnm_rgb rgb_rep: where to store the converted pixel
+ * Returns   : None
+ * Does      : performs the actual calculations to transform the y, pb, and
+ *             pr values of one pixel into red, green, and blue values scaled
+ *             to a denominator of 255
+ */
+void cv_to_pixel (component_video ypp_rep, Pnm_rgb rgb_rep)
+{
     /* obtain values */
     float y  = ypp_rep -> y,
           pb = ypp_rep -> pb,
@@ -197,11 +569,87 @@ void convert_to_rgb (int i, int j, A2Methods_UArray2 array2,
         blue = 0;
     } else if (blue > 1)
         blue = 1;
-    
-    Pnm_rgb rgb_rep = (Pnm_rgb) (cl_struct -> methods -> at(cl_struct -> array2, 
-                                                            i, j));
+
     /* scale values */
     rgb_rep -> red = red * 255;
     rgb_rep -> green = green * 255;
     rgb_rep -> blue = blue * 255;
-}
\ No newline at end of file
+}
+
+/*
+ * ypp_row_to_rgb (const float *y, const float *pb, const float *pr,
+ *                 struct Pnm_rgb *rgb_row, int width)
+ *
+ * Parameters: const float *y, *pb, *pr: rows of the y, pb, and pr planes
+ *             struct Pnm_rgb *rgb_row: contiguous row of pixels to fill
+ *             int width: number of pixels in the row
+ * Returns   : None
+ * Does      : converts a whole row, KERNEL_PIXELS at a time with SSE2
+ *             where it is available. The weighted sums are done in double
+ *             precision in the same order as cv_to_pixel, the if/else
+ *             bounds checks become a max and a min, and the scaled values
+ *             are truncated the same way a float to unsigned cast does, so
+ *             both give bit-identical pixels. Leftover pixels at the end of
+ *             the row go through cv_to_pixel.
+ */
+void ypp_row_to_rgb (const float *y, const float *pb, const float *pr,
+                     struct Pnm_rgb *rgb_row, int width)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    for (; i + KERNEL_PIXELS <= width; i += KERNEL_PIXELS) {
+        int red[KERNEL_PIXELS], green[KERNEL_PIXELS], blue[KERNEL_PIXELS];
+        for (int k = 0; k < KERNEL_PIXELS; k += 4) {
+            __m128 yv  = _mm_load_ps(&y[i + k]),
+                   pbv = _mm_load_ps(&pb[i + k]),
+                   prv = _mm_load_ps(&pr[i + k]);
+            __m128 rgb[3][2];
+            for (int h = 0; h < 2; h++) { /* low half, then high half */
+                __m128d yd  = _mm_cvtps_pd(h == 0 ? yv :
+                                           _mm_movehl_ps(yv, yv));
+                __m128d pbd = _mm_cvtps_pd(h == 0 ? pbv :
+                                           _mm_movehl_ps(pbv, pbv));
+                __m128d prd = _mm_cvtps_pd(h == 0 ? prv :
+                                           _mm_movehl_ps(prv, prv));
+                __m128d one = _mm_set1_pd(1.0),
+                        zero = _mm_setzero_pd();
+                __m128d rd = _mm_add_pd(_mm_add_pd(
+                        _mm_mul_pd(one, yd),
+                        _mm_mul_pd(zero, pbd)),
+                        _mm_mul_pd(_mm_set1_pd(1.402), prd));
+                __m128d gd = _mm_sub_pd(_mm_sub_pd(
+                        _mm_mul_pd(one, yd),
+                        _mm_mul_pd(_mm_set1_pd(0.344136), pbd)),
+                        _mm_mul_pd(_mm_set1_pd(0.714136), prd));
+                __m128d bd = _mm_add_pd(_mm_add_pd(
+                        _mm_mul_pd(one, yd),
+                        _mm_mul_pd(_mm_set1_pd(1.772), pbd)),
+                        _mm_mul_pd(zero, prd));
+                rgb[0][h] = _mm_cvtpd_ps(rd);
+                rgb[1][h] = _mm_cvtpd_ps(gd);
+                rgb[2][h] = _mm_cvtpd_ps(bd);
+            }
+            int *out[3] = { &red[k], &green[k], &blue[k] };
+            for (int c = 0; c < 3; c++) {
+                __m128 v = _mm_movelh_ps(rgb[c][0], rgb[c][1]);
+                v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()),
+                               _mm_set1_ps(1.0f));
+                __m128i scaled = _mm_cvttps_epi32(_mm_mul_ps(v,
+                                                  _mm_set1_ps(255.0f)));
+                _mm_storeu_si128((__m128i *) out[c], scaled);
+            }
+        }
+        for (int k = 0; k < KERNEL_PIXELS; k++) { /* interleave lanes */
+            rgb_row[i + k].red   = red[k];
+            rgb_row[i + k].green = green[k];
+            rgb_row[i + k].blue  = blue[k];
+        }
+    }
+#endif
+
+    for (; i < width; i++) {
+        struct component_video ypp_rep = { y[i], pb[i], pr[i] };
+        cv_to_pixel(&ypp_rep, &rgb_row[i]);
+    }
+}
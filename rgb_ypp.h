@@ -2,9 +2,9 @@
  * Authors: Robert Lester, Craig Cagner
  * Filename: rgb_ypp.h
  * Assignment: Arith
- * Summary: In compression, transforms an array of Pnm_rgb structs to an array
- *          of component_video structs. In decompression, transforms an array 
- *          of component_video structs to an array of Pnm_rgb structs.
+ * Summary: In compression, transforms an array of Pnm_rgb structs to y, pb,
+ *          and pr planes. In decompression, transforms y, pb, and pr planes
+ *          to an array of Pnm_rgb structs.
  */
 
 #ifndef RGB_TO_YPP_INCLUDED
@@ -14,27 +14,90 @@
 #include "a2methods.h"
 #include "a2plain.h"
 #include "assert.h"
+#include "plane_set.h"
 #include <malloc.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 /*
  * rgb_to_ypp
  * 
- * returns a 2D array of component video elements whose values are equivalent
- * to those of the given 2D array of RGB values
+ * returns width by height y, pb, and pr planes whose values are equivalent
+ * to those in the top left corner of the given 2D array of RGB values
  * 
- * assumes the first 2 arguments are not NULL
+ * assumes array2 and methods are not NULL and that width and height are at
+ * most the width and height of array2
  */
-A2Methods_UArray2 rgb_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods,
-                                                        unsigned denominator);
+plane_set rgb_to_ypp (A2Methods_UArray2 array2, int width, int height,
+                                                A2Methods_T methods,
+                                                unsigned denominator);
+
+/*
+ * rgb_rows_to_ypp
+ * 
+ * fills the given y, pb, and pr planes from the pixels of array2 starting
+ * at column 0 of first_row, as many rows and columns as the planes hold
+ * 
+ * assumes no argument is NULL and the planes fit inside array2 there
+ */
+void rgb_rows_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods,
+                      unsigned denominator, int first_row, plane_set ypp_rep);
+
+/*
+ * rgb8_to_ypp
+ * 
+ * returns y, pb, and pr planes converted from an image held as rows of
+ * packed 8-bit red, green, blue samples, stride bytes apart
+ * 
+ * assumes pixels is not NULL and stride is at least 3 * width
+ */
+plane_set rgb8_to_ypp (const unsigned char *pixels, size_t stride,
+                       int width, int height, unsigned denominator);
+
+/*
+ * rgb8_rows_to_ypp
+ * 
+ * fills the given y, pb, and pr planes from rows of packed 8-bit samples,
+ * the first of which starts at pixels
+ * 
+ * assumes neither pointer is NULL and stride is at least 3 * the planes'
+ * width
+ */
+void rgb8_rows_to_ypp (const unsigned char *pixels, size_t stride,
+                       unsigned denominator, plane_set ypp_rep);
 
 /* 
  * ypp_to_rgb
  * 
  * returns a 2D array of Pnm_rgb elements whose values are equivalent to those
- * of the given 2D array of component video elements
+ * of the given y, pb, and pr planes
  * 
  * assumes the arguments are not NULL
  */
-A2Methods_UArray2 ypp_to_rgb (A2Methods_UArray2 array2, A2Methods_T methods);
+A2Methods_UArray2 ypp_to_rgb (plane_set ypp_rep, A2Methods_T methods);
+
+/*
+ * ypp_to_rgb_rows
+ * 
+ * converts the given y, pb, and pr planes into the Pnm_rgb elements of
+ * rgb_rep starting at column 0 of first_row
+ * 
+ * assumes no argument is NULL and the planes fit inside rgb_rep there
+ */
+void ypp_to_rgb_rows (plane_set ypp_rep, A2Methods_UArray2 rgb_rep,
+                      A2Methods_T methods, int first_row);
+
+/*
+ * ypp_to_rgb8_rows
+ * 
+ * the inverse of rgb8_rows_to_ypp; converts the given y, pb, and pr planes
+ * into rows of packed 8-bit samples, stride bytes apart, the first of
+ * which starts at pixels
+ * 
+ * assumes neither pointer is NULL and stride is at least 3 * the planes'
+ * width
+ */
+void ypp_to_rgb8_rows (plane_set ypp_rep, unsigned char *pixels,
+                       size_t stride);
 
-#endif
\ No newline at end of file
+#endif
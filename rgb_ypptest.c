@@ -0,0 +1,218 @@
+/*
+ * Filename  : rgb_ypptest.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Differential test of the decompression row kernel in
+ *             rgb_ypp.c (make test). ypp_to_rgb_rows sends the rows of a
+ *             plain array through ypp_row_to_rgb, and converts the pixels
+ *             of a blocked array one at a time with the scalar
+ *             cv_to_pixel, so converting the same planes into both and
+ *             comparing checks the kernel bit for bit against the scalar
+ *             code; ypp_to_rgb8_rows is checked against the same pixels.
+ *             The values cover the clamp at both ends, the points where
+ *             scaling to 255 truncates to the next sample, and huge
+ *             values, and every row width up to two kernel passes plus
+ *             each possible leftover, so that every tail length goes
+ *             through the scalar finish. Prints each mismatch and exits
+ *             with failure if there are any
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "plane_set.h"
+#include "rgb_ypp.h"
+
+#define KERNEL_PIXELS 8   /* pixels per pass of ypp_row_to_rgb */
+#define MAX_WIDTH (2 * KERNEL_PIXELS + KERNEL_PIXELS - 1)
+#define RANDOM_PIXELS 100000
+#define MAX_VALUES 4096
+
+/* y, pb, and pr of every pixel to convert */
+typedef struct value_list {
+
+    float values[MAX_VALUES][NUM_YPP_PLANES];
+    int length;
+
+} *value_list;
+
+void add_value (value_list list, float y, float pb, float pr);
+void add_extremes (value_list list);
+long check_width (value_list list, int first, int width);
+bool same_pixel (Pnm_rgb kernel, Pnm_rgb scalar);
+
+/*
+ * main (void)
+ *
+ * Parameters: None
+ * Returns   : int: EXIT_SUCCESS if every pixel matched, else EXIT_FAILURE
+ * Does      : Builds the list of values, then checks every width from 0 to
+ *             MAX_WIDTH at every starting point in the list, so each value
+ *             lands in both the kernel and the scalar finish
+ */
+int main (void)
+{
+    static struct value_list list;
+    list.length = 0;
+    add_extremes(&list);
+
+    long mismatches = 0,
+         checked    = 0;
+    for (int width = 0; width <= MAX_WIDTH; width++) {
+        for (int first = 0; first + width <= list.length;
+                            first += width > 0 ? width : 1) {
+            mismatches += check_width(&list, first, width);
+            checked += width;
+        }
+    }
+
+    /* and a run of ordinary values, the pixels of a real image */
+    srand(40);
+    for (int n = 0; n < RANDOM_PIXELS; n += MAX_WIDTH) {
+        list.length = 0;
+        for (int i = 0; i < MAX_WIDTH; i++) {
+            add_value(&list, rand() / (float) RAND_MAX * 1.2f - 0.1f,
+                             rand() / (float) RAND_MAX * 1.2f - 0.6f,
+                             rand() / (float) RAND_MAX * 1.2f - 0.6f);
+        }
+        mismatches += check_width(&list, 0, MAX_WIDTH);
+        checked += MAX_WIDTH;
+    }
+
+    printf("rgb_ypptest: %ld pixels checked, %ld mismatched\n", checked,
+                                                                mismatches);
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * add_value (value_list list, float y, float pb, float pr)
+ *
+ * Parameters: value_list list: the list to add to
+ *             float y, pb, pr: the pixel to add
+ * Returns   : None
+ * Does      : Appends the pixel to the list
+ */
+void add_value (value_list list, float y, float pb, float pr)
+{
+    assert(list -> length < MAX_VALUES);
+    list -> values[list -> length][Y_PLANE]  = y;
+    list -> values[list -> length][PB_PLANE] = pb;
+    list -> values[list -> length][PR_PLANE] = pr;
+    list -> length++;
+}
+
+/*
+ * add_extremes (value_list list)
+ *
+ * Parameters: value_list list: the list to add to
+ * Returns   : None
+ * Does      : Adds every combination of values that push a channel just
+ *             below 0, onto 0 and 1, just past 1, and far past both, and
+ *             each grey level k / 255 with its neighbouring floats, where
+ *             truncating after scaling to 255 changes the sample
+ */
+void add_extremes (value_list list)
+{
+    const float ys[] = {
+        -1e30f, -1.0f, -1e-7f, 0.0f, 1e-7f, 0.5f, nextafterf(1.0f, 0.0f),
+        1.0f, nextafterf(1.0f, 2.0f), 2.0f, 1e30f
+    };
+    const float chromas[] = {
+        -1e30f, -0.6f, -0.5f, -1e-7f, 0.0f, 1e-7f, 0.5f, 0.6f, 1e30f
+    };
+    int num_ys      = sizeof(ys) / sizeof(ys[0]),
+        num_chromas = sizeof(chromas) / sizeof(chromas[0]);
+
+    for (int y = 0; y < num_ys; y++) {
+        for (int pb = 0; pb < num_chromas; pb++) {
+            for (int pr = 0; pr < num_chromas; pr++) {
+                add_value(list, ys[y], chromas[pb], chromas[pr]);
+            }
+        }
+    }
+    for (int k = 0; k <= 255; k++) {
+        float grey = k / 255.0f;
+        add_value(list, nextafterf(grey, -1.0f), 0.0f, 0.0f);
+        add_value(list, grey, 0.0f, 0.0f);
+        add_value(list, nextafterf(grey, 2.0f), 0.0f, 0.0f);
+    }
+}
+
+/*
+ * check_width (value_list list, int first, int width)
+ *
+ * Parameters: value_list list: the values to convert
+ *             int first: index of the row's first value in the list
+ *             int width: number of pixels in the row
+ * Returns   : long: number of pixels that differ
+ * Does      : Fills a one row plane_set, converts it into a plain array
+ *             (the row kernel), a blocked array with a blocksize of 2
+ *             (cv_to_pixel), and packed
+ *             bytes, and compares each pixel of the kernel's output with
+ *             the scalar one
+ */
+long check_width (value_list list, int first, int width)
+{
+    A2Methods_T plain   = uarray2_methods_plain,
+                blocked = uarray2_methods_blocked;
+    plane_set planes = plane_set_new(width, 1, NUM_YPP_PLANES);
+    for (int i = 0; i < width; i++) {
+        for (int p = 0; p < NUM_YPP_PLANES; p++) {
+            plane_row(planes, p, 0)[i] = list -> values[first + i][p];
+        }
+    }
+
+    long mismatches = 0;
+    if (width > 0) {
+        /* one row is too short for ypp_to_rgb to pick a blocksize above
+         * 1, so the blocked array is made by hand */
+        A2Methods_UArray2 kernel = ypp_to_rgb(planes, plain),
+                          scalar = blocked -> new_with_blocksize(width, 1,
+                                             sizeof(struct Pnm_rgb), 2);
+        ypp_to_rgb_rows(planes, scalar, blocked, 0);
+        unsigned char bytes[MAX_WIDTH * 3];
+        ypp_to_rgb8_rows(planes, bytes, sizeof(bytes));
+
+        for (int i = 0; i < width; i++) {
+            Pnm_rgb want = blocked -> at(scalar, i, 0);
+            struct Pnm_rgb packed = { bytes[i * 3], bytes[i * 3 + 1],
+                                      bytes[i * 3 + 2] };
+            if (!same_pixel(plain -> at(kernel, i, 0), want) ||
+                !same_pixel(&packed, want)) {
+                float *v = list -> values[first + i];
+                fprintf(stderr, "width %d pixel %d: y %a pb %a pr %a\n",
+                        width, i, v[Y_PLANE], v[PB_PLANE], v[PR_PLANE]);
+                mismatches++;
+            }
+        }
+        plain -> free(&kernel);
+        blocked -> free(&scalar);
+    }
+
+    plane_set_free(&planes);
+    return mismatches;
+}
+
+/*
+ * same_pixel (Pnm_rgb kernel, Pnm_rgb scalar)
+ *
+ * Parameters: Pnm_rgb kernel, scalar: the two pixels to compare
+ * Returns   : bool: true if every sample is the same
+ * Does      : Compares the samples, printing both pixels if they differ
+ */
+bool same_pixel (Pnm_rgb kernel, Pnm_rgb scalar)
+{
+    if (kernel -> red == scalar -> red && kernel -> green == scalar -> green &&
+        kernel -> blue == scalar -> blue) {
+        return true;
+    }
+    fprintf(stderr, "kernel %u %u %u, scalar %u %u %u; ", kernel -> red,
+            kernel -> green, kernel -> blue, scalar -> red, scalar -> green,
+            scalar -> blue);
+    return false;
+}
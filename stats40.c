@@ -0,0 +1,447 @@
+/*
+ * Filename  : stats40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the stats40.h interface. Each counter is
+ *             its own perf event, counting user space in the calling
+ *             thread from the moment it is opened; a stage's count is the
+ *             difference between reads taken at stats40_begin and
+ *             stats40_end. Opening them one by one means a machine that
+ *             lacks one counter (a virtual machine without an LLC event,
+ *             say) still reports the rest.
+ * 
+ *             Memory tracking keeps a running total of live bytes for the
+ *             process and one for each stage, updated with atomic
+ *             operations so worker threads can share them, and a
+ *             thread-local current stage to charge allocations to; a free
+ *             comes off the stage its allocation was charged to. The
+ *             peak's stage is recorded just after the peak itself, so
+ *             under heavy contention it can name a stage a moment late
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "assert.h"
+#include "stats40.h"
+
+#define NS_PER_S 1000000000.0
+
+enum { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+/* the memory bucket for allocations made outside every stage */
+#define OUTSIDE_STAGES STATS40_NUM_STAGES
+
+/* the clocks and counters at one moment */
+typedef struct reading {
+
+    double wall_ns,
+           cpu_ns;
+    uint64_t counts[NUM_COUNTERS];
+
+} *reading;
+
+/* what one stage has added up so far */
+typedef struct stage_totals {
+
+    unsigned long calls;
+    uint64_t bytes;
+    double wall_ns,
+           cpu_ns;
+    uint64_t counts[NUM_COUNTERS];
+
+} *stage_totals;
+
+/* what has been allocated while one stage was running */
+typedef struct memory_totals {
+
+    uint64_t allocations,
+             bytes,
+             peak_live;     /* most of the stage's own bytes live at once */
+    int64_t live;           /* the stage's bytes not yet freed */
+
+} *memory_totals;
+
+static const char *stage_names[STATS40_NUM_STAGES] = {
+    "read_ppm", "rgb_to_ypp", "ypp_to_dct", "quantize_c", "bitmap_pack",
+    "write_bitfile", "read_bitfile", "bitmap_unpack", "quantize_d",
+    "dct_to_ypp", "ypp_to_rgb", "write_ppm", "arena"
+};
+
+static const char *counter_names[NUM_COUNTERS] = {
+    "cycles", "instructions", "llc_misses", "branch_misses"
+};
+
+static const uint64_t counter_configs[NUM_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static bool enabled = false;
+static int counter_fds[NUM_COUNTERS] = { -1, -1, -1, -1 };
+static struct reading run_start;
+static struct reading stage_start[STATS40_NUM_STAGES];
+static struct stage_totals totals[STATS40_NUM_STAGES];
+
+static bool tracking_memory = false;
+static __thread int current_stage = OUTSIDE_STAGES;
+static int64_t live_bytes = 0;
+static uint64_t peak_bytes = 0;
+static int peak_stage = OUTSIDE_STAGES;
+static struct memory_totals memory[STATS40_NUM_STAGES + 1];
+
+int open_counter (uint64_t config);
+void take_reading (reading now);
+void write_counts (FILE *fp, const uint64_t *counts);
+bool raise_to (uint64_t *maximum, uint64_t value);
+void report_memory (void);
+
+/*
+ * stats40_enable (void)
+ *
+ * Parameters: None
+ * Returns   : Nothing
+ * Does      : Opens each counter, leaving -1 for any that cannot be
+ *             opened, clears the totals, and takes the run's first reading
+ */
+void stats40_enable (void)
+{
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        counter_fds[c] = open_counter(counter_configs[c]);
+    }
+    memset(totals, 0, sizeof(totals));
+    enabled = true;
+    take_reading(&run_start);
+}
+
+/*
+ * stats40_begin (stats40_stage stage)
+ *
+ * Parameters: stats40_stage stage: the stage about to run
+ * Returns   : Nothing
+ * Does      : Charges the thread's allocations to the stage, and takes the
+ *             reading stats40_end will subtract
+ */
+void stats40_begin (stats40_stage stage)
+{
+    current_stage = stage;
+    if (enabled) {
+        take_reading(&stage_start[stage]);
+    }
+}
+
+/*
+ * stats40_end (stats40_stage stage, size_t bytes)
+ *
+ * Parameters: stats40_stage stage: the stage that just ran
+ *             size_t bytes: bytes of input the stage went through
+ * Returns   : Nothing
+ * Does      : Stops charging the stage, and adds the time and counts
+ *             since stats40_begin to its totals
+ */
+void stats40_end (stats40_stage stage, size_t bytes)
+{
+    current_stage = OUTSIDE_STAGES;
+    if (!enabled) {
+        return;
+    }
+    struct reading now;
+    take_reading(&now);
+
+    stage_totals total = &totals[stage];
+    total -> calls++;
+    total -> bytes   += bytes;
+    total -> wall_ns += now.wall_ns - stage_start[stage].wall_ns;
+    total -> cpu_ns  += now.cpu_ns - stage_start[stage].cpu_ns;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        total -> counts[c] += now.counts[c] - stage_start[stage].counts[c];
+    }
+}
+
+/*
+ * stats40_report (FILE *fp, const char *command)
+ *
+ * Parameters: FILE *fp: where the JSON goes
+ *             const char *command: what the run did, such as "compress"
+ * Returns   : Nothing
+ * Does      : Writes one JSON object holding the run's totals, the list of
+ *             counters that were available, and one entry per stage that
+ *             was called, then closes the counters and stops collecting
+ */
+void stats40_report (FILE *fp, const char *command)
+{
+    assert(enabled && fp != NULL && command != NULL);
+    struct reading now;
+    take_reading(&now);
+    uint64_t run_counts[NUM_COUNTERS];
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        run_counts[c] = now.counts[c] - run_start.counts[c];
+    }
+
+    fprintf(fp, "{\"command\": \"%s\", \"wall_ns\": %.0f, \"cpu_ns\": %.0f",
+            command, now.wall_ns - run_start.wall_ns,
+            now.cpu_ns - run_start.cpu_ns);
+    write_counts(fp, run_counts);
+    fprintf(fp, ",\n \"counters\": [");
+    bool first = true;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (counter_fds[c] >= 0) {
+            fprintf(fp, "%s\"%s\"", first ? "" : ", ", counter_names[c]);
+            first = false;
+        }
+    }
+    fprintf(fp, "],\n \"stages\": [");
+
+    first = true;
+    for (int s = 0; s < STATS40_NUM_STAGES; s++) {
+        stage_totals total = &totals[s];
+        if (total -> calls == 0) {
+            continue;
+        }
+        fprintf(fp, "%s\n  {\"stage\": \"%s\", \"calls\": %lu, "
+                    "\"bytes\": %llu, \"wall_ns\": %.0f, \"cpu_ns\": %.0f",
+                first ? "" : ",", stage_names[s], total -> calls,
+                (unsigned long long) total -> bytes, total -> wall_ns,
+                total -> cpu_ns);
+        write_counts(fp, total -> counts);
+        fprintf(fp, "}");
+        first = false;
+    }
+    fprintf(fp, "\n ]}\n");
+    fflush(fp);
+
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (counter_fds[c] >= 0) {
+            close(counter_fds[c]);
+            counter_fds[c] = -1;
+        }
+    }
+    enabled = false;
+}
+
+/*
+ * stats40_enter (stats40_stage stage), stats40_leave (void)
+ *
+ * Parameters: stats40_stage stage: the stage to charge
+ * Returns   : Nothing
+ * Does      : Sets the stage the calling thread's allocations are charged
+ *             to, or goes back to charging no stage
+ */
+void stats40_enter (stats40_stage stage)
+{
+    current_stage = stage;
+}
+
+void stats40_leave (void)
+{
+    current_stage = OUTSIDE_STAGES;
+}
+
+/*
+ * stats40_track_memory (void)
+ *
+ * Parameters: None
+ * Returns   : Nothing
+ * Does      : Starts counting allocations, and registers report_memory to
+ *             run at exit
+ */
+void stats40_track_memory (void)
+{
+    if (!tracking_memory) {
+        tracking_memory = true;
+        atexit(report_memory);
+    }
+}
+
+/*
+ * stats40_allocated (size_t bytes)
+ *
+ * Parameters: size_t bytes: bytes just allocated
+ * Returns   : stats40_stage: the stage charged, to give back to
+ *                            stats40_freed
+ * Does      : Adds the bytes to the process's and the current stage's live
+ *             totals, raising either peak that the new total is above
+ */
+stats40_stage stats40_allocated (size_t bytes)
+{
+    int stage = current_stage;
+    if (!tracking_memory) {
+        return stage;
+    }
+    int64_t live = __atomic_add_fetch(&live_bytes, (int64_t) bytes,
+                                      __ATOMIC_RELAXED);
+
+    memory_totals total = &memory[stage];
+    int64_t stage_live = __atomic_add_fetch(&total -> live, (int64_t) bytes,
+                                            __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total -> allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total -> bytes, bytes, __ATOMIC_RELAXED);
+    raise_to(&total -> peak_live, stage_live);
+    if (raise_to(&peak_bytes, live)) {
+        __atomic_store_n(&peak_stage, stage, __ATOMIC_RELAXED);
+    }
+    return stage;
+}
+
+/*
+ * stats40_freed (stats40_stage owner, size_t bytes)
+ *
+ * Parameters: stats40_stage owner: the stage stats40_allocated charged
+ *             size_t bytes: bytes just freed
+ * Returns   : Nothing
+ * Does      : Takes the bytes off the process's and the owner's live
+ *             totals
+ */
+void stats40_freed (stats40_stage owner, size_t bytes)
+{
+    if (tracking_memory) {
+        assert(owner <= OUTSIDE_STAGES);
+        __atomic_sub_fetch(&live_bytes, (int64_t) bytes, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&memory[owner].live, (int64_t) bytes,
+                           __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * raise_to (uint64_t *maximum, uint64_t value)
+ *
+ * Parameters: uint64_t *maximum: a running maximum shared between threads
+ *             uint64_t value: a new value
+ * Returns   : bool: true if value became the new maximum
+ * Does      : Compares and swaps until the maximum is at least value
+ */
+bool raise_to (uint64_t *maximum, uint64_t value)
+{
+    uint64_t seen = __atomic_load_n(maximum, __ATOMIC_RELAXED);
+    while (value > seen) {
+        if (__atomic_compare_exchange_n(maximum, &seen, value, false,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * report_memory (void)
+ *
+ * Parameters: None
+ * Returns   : Nothing
+ * Does      : Run at exit; writes one JSON object to standard error with
+ *             the peak bytes live and the stage that reached it, the bytes
+ *             still live, the process's peak resident set size from
+ *             getrusage, and for every stage that made any allocations
+ *             their count and bytes, the stage's own peak bytes live, and
+ *             its bytes still live
+ */
+void report_memory (void)
+{
+    struct rusage usage;
+    long peak_rss_kb = getrusage(RUSAGE_SELF, &usage) == 0 ?
+                       usage.ru_maxrss : -1;
+
+    fprintf(stderr, "{\"memory\": {\"peak_live_bytes\": %llu, "
+                    "\"peak_stage\": \"%s\", \"live_at_exit\": %lld, "
+                    "\"peak_rss_kb\": %ld,\n \"stages\": [",
+            (unsigned long long) peak_bytes,
+            peak_stage == OUTSIDE_STAGES ? "outside_stages"
+                                         : stage_names[peak_stage],
+            (long long) live_bytes, peak_rss_kb);
+
+    bool first = true;
+    for (int s = 0; s <= OUTSIDE_STAGES; s++) {
+        memory_totals total = &memory[s];
+        if (total -> allocations == 0) {
+            continue;
+        }
+        fprintf(stderr, "%s\n  {\"stage\": \"%s\", \"allocations\": %llu, "
+                        "\"bytes\": %llu, \"peak_live_bytes\": %llu, "
+                        "\"live_at_exit\": %lld}",
+                first ? "" : ",",
+                s == OUTSIDE_STAGES ? "outside_stages" : stage_names[s],
+                (unsigned long long) total -> allocations,
+                (unsigned long long) total -> bytes,
+                (unsigned long long) total -> peak_live,
+                (long long) total -> live);
+        first = false;
+    }
+    fprintf(stderr, "\n ]}}\n");
+}
+
+/*
+ * open_counter (uint64_t config)
+ *
+ * Parameters: uint64_t config: which generic hardware event to count
+ * Returns   : int: the counter's file descriptor, or -1 if the kernel or
+ *                  the machine does not allow it
+ * Does      : Opens a counter of user space events in this thread on any
+ *             cpu, counting from now
+ */
+int open_counter (uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return fd >= 0 ? (int) fd : -1;
+}
+
+/*
+ * take_reading (reading now)
+ *
+ * Parameters: reading now: where the reading goes
+ * Returns   : Nothing
+ * Does      : Reads the monotonic and process cpu clocks and every open
+ *             counter; a counter that is not open, or fails to read, reads
+ *             as 0
+ */
+void take_reading (reading now)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now -> wall_ns = ts.tv_sec * NS_PER_S + ts.tv_nsec;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    now -> cpu_ns = ts.tv_sec * NS_PER_S + ts.tv_nsec;
+
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        uint64_t count = 0;
+        if (counter_fds[c] >= 0 &&
+            read(counter_fds[c], &count, sizeof(count)) != sizeof(count)) {
+            count = 0;
+        }
+        now -> counts[c] = count;
+    }
+}
+
+/*
+ * write_counts (FILE *fp, const uint64_t *counts)
+ *
+ * Parameters: FILE *fp: where the JSON goes
+ *             const uint64_t *counts: one count per counter
+ * Returns   : Nothing
+ * Does      : Writes a JSON member for every counter, null for those that
+ *             are not open
+ */
+void write_counts (FILE *fp, const uint64_t *counts)
+{
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (counter_fds[c] >= 0) {
+            fprintf(fp, ", \"%s\": %llu", counter_names[c],
+                    (unsigned long long) counts[c]);
+        } else {
+            fprintf(fp, ", \"%s\": null", counter_names[c]);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Filename  : stats40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Optional per-stage instrumentation of the codec (40image
+ *             --stats). Once enabled, each stage's wall time, cpu time,
+ *             bytes of input, and hardware counters (cycles,
+ *             instructions, last level cache misses, and branch misses,
+ *             through perf_event_open) are added up over every call,
+ *             and reported as JSON. Counters the kernel will not give us
+ *             are reported as null, so the timers still work anywhere.
+ *             Until stats40_enable is called every hook is a single test,
+ *             and the totals are kept for one thread only.
+ * 
+ *             Separately, memory tracking (40image --mem-stats) counts the
+ *             bytes every 2D array, plane_set, and arena allocates and
+ *             frees, charges each allocation to the stage running in the
+ *             allocating thread, and charges its free back to that stage
+ *             whichever stage frees it. At exit it reports the peak bytes
+ *             live in the process, the stage that reached it, each
+ *             stage's own peak, and the process's peak RSS. It is safe to
+ *             use from several threads
+ */
+
+#ifndef STATS40_INCLUDED
+#define STATS40_INCLUDED
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* the stages compress40 and decompress40 run, in order */
+typedef enum stats40_stage {
+    STATS40_READ_PPM, STATS40_RGB_TO_YPP, STATS40_YPP_TO_DCT,
+    STATS40_QUANTIZE_C, STATS40_BITMAP_PACK, STATS40_WRITE_BITFILE,
+    STATS40_READ_BITFILE, STATS40_BITMAP_UNPACK, STATS40_QUANTIZE_D,
+    STATS40_DCT_TO_YPP, STATS40_YPP_TO_RGB, STATS40_WRITE_PPM,
+    STATS40_ARENA,      /* not a stage: the codec's scratch arena, which
+                         * only memory tracking charges */
+    STATS40_NUM_STAGES
+} stats40_stage;
+
+/*
+ * stats40_enable
+ *
+ * starts collecting: opens whichever hardware counters are available and
+ * starts the clock for the whole run
+ */
+void stats40_enable (void);
+
+/*
+ * stats40_begin, stats40_end
+ *
+ * bracket one call of the given stage; stats40_end adds the time and
+ * counts since the matching stats40_begin, and the given number of input
+ * bytes, to the stage's totals. Unless stats are enabled they only do
+ * what stats40_enter and stats40_leave do
+ */
+void stats40_begin (stats40_stage stage);
+void stats40_end (stats40_stage stage, size_t bytes);
+
+/*
+ * stats40_enter, stats40_leave
+ *
+ * make the given stage, or no stage, the one that allocations in the
+ * calling thread are charged to, without timing anything; for the
+ * arrays a stage's output goes in, which are made before its first call
+ */
+void stats40_enter (stats40_stage stage);
+void stats40_leave (void);
+
+/*
+ * stats40_report
+ *
+ * writes the totals of every stage that was called, and of the whole run,
+ * to the given file as one JSON object naming the given command (such as
+ * "compress"), and closes the counters
+ *
+ * assumes stats are enabled and neither pointer is NULL
+ */
+void stats40_report (FILE *fp, const char *command);
+
+/*
+ * stats40_track_memory
+ *
+ * starts memory tracking, and arranges for its summary to be written to
+ * standard error as JSON when the process exits
+ */
+void stats40_track_memory (void);
+
+/*
+ * stats40_allocated, stats40_freed
+ *
+ * record that the given number of bytes were allocated or freed; called by
+ * the 2D arrays, plane_sets, and the arena. stats40_allocated returns the
+ * stage it charged (STATS40_NUM_STAGES for none), which the caller keeps
+ * with the allocation and passes back to stats40_freed with the same
+ * bytes. Neither counts anything unless memory is being tracked
+ */
+stats40_stage stats40_allocated (size_t bytes);
+void stats40_freed (stats40_stage owner, size_t bytes);
+
+#endif
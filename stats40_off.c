@@ -0,0 +1,63 @@
+/*
+ * Filename  : stats40_off.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : The stats40.h hooks the codec calls, doing nothing, for
+ *             libcodec40.a. The library's programs never turn on --stats
+ *             or --mem-stats, so linking this instead of stats40.c keeps
+ *             stdio, atexit, and stats40.c's global totals out of the
+ *             library; the codec's objects are the same in both. Only
+ *             the hooks are here, so a library program that tried to
+ *             enable or report stats would fail to link
+ */
+
+#include "stats40.h"
+
+/*
+ * stats40_begin (stats40_stage stage), stats40_end (stats40_stage stage,
+ * size_t bytes), stats40_enter (stats40_stage stage), stats40_leave (void)
+ *
+ * Parameters: as in stats40.h
+ * Returns   : Nothing
+ * Does      : Nothing; there is no stage to time or charge
+ */
+void stats40_begin (stats40_stage stage)
+{
+    (void) stage;
+}
+
+void stats40_end (stats40_stage stage, size_t bytes)
+{
+    (void) stage;
+    (void) bytes;
+}
+
+void stats40_enter (stats40_stage stage)
+{
+    (void) stage;
+}
+
+void stats40_leave (void)
+{
+}
+
+/*
+ * stats40_allocated (size_t bytes),
+ * stats40_freed (stats40_stage owner, size_t bytes)
+ *
+ * Parameters: as in stats40.h
+ * Returns   : stats40_allocated returns STATS40_NUM_STAGES, no stage
+ * Does      : Nothing; memory is never tracked in the library
+ */
+stats40_stage stats40_allocated (size_t bytes)
+{
+    (void) bytes;
+    return STATS40_NUM_STAGES;
+}
+
+void stats40_freed (stats40_stage owner, size_t bytes)
+{
+    (void) owner;
+    (void) bytes;
+}
@@ -0,0 +1,103 @@
+/*
+ * Filename  : stream40.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the stream40.h interface. Each codeword
+ *             only depends on its own 2x2 block of pixels, so a pair of
+ *             rows can go through every stage of the codec on its own
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "stream40.h"
+#include "codec40.h"
+#include "ppm_reader.h"
+#include "read_bitfile.h"
+
+#define ROWS_PER_PASS 2 /* one row of 2x2 blocks */
+#define DENOMINATOR 255 /* ppm denominator */
+
+/*
+ * compress40_stream (FILE *inputfp)
+ *
+ * Parameters: FILE *inputfp: input file, ppm image
+ * Returns   : None
+ * Does      : Reads the image a pair of rows at a time into a reused two
+ *             row array, encodes that pair with one codec40_context kept
+ *             for the whole stream, and writes its row of codewords before
+ *             reading the next pair. Memory use depends only on the width
+ *             of the image.
+ */
+void compress40_stream (FILE *inputfp)
+{
+    A2Methods_T methods = uarray2_methods_plain;
+    assert(methods != NULL);
+
+    ppm_stream stream = open_ppm_stream(inputfp);
+    write_bitfile_header(stream -> width, stream -> height);
+
+    if (stream -> width > 0 && stream -> height > 0) {
+        codec40_context context = codec40_context_new(methods);
+        A2Methods_UArray2 rows = methods -> new(stream -> width,
+                                                ROWS_PER_PASS,
+                                                sizeof(struct Pnm_rgb));
+        for (unsigned j = 0; j < stream -> height; j += ROWS_PER_PASS) {
+            read_ppm_rows(stream, rows, methods);
+            A2Methods_UArray2 word_row = codec40_encode_view(context, rows,
+                                                stream -> width,
+                                                ROWS_PER_PASS,
+                                                stream -> denominator);
+            write_codewords(methods, word_row);
+            methods -> free(&word_row);
+        }
+        methods -> free(&rows);
+        codec40_context_free(&context);
+    }
+
+    close_ppm_stream(&stream);
+}
+
+/*
+ * decompress40_stream (FILE *inputfp)
+ *
+ * Parameters: FILE *inputfp: input file, compressed bit file
+ * Returns   : None
+ * Does      : Reads the bit file a row of codewords at a time into a reused
+ *             one row array, decodes that row with one codec40_context
+ *             kept for the whole stream, and writes the two rows of
+ *             pixels it covers before reading the next one. Memory use and
+ *             the time until the first row is written depend only on the
+ *             width of the image.
+ */
+void decompress40_stream (FILE *inputfp)
+{
+    A2Methods_T methods = uarray2_methods_plain;
+    assert(methods != NULL);
+
+    unsigned width, height;
+    read_bitfile_header(inputfp, &width, &height);
+    /* a hand-made header may give an odd size; decompress40 only ever
+     * emits the whole 2x2 blocks, and so must we */
+    width  -= width % 2;
+    height -= height % 2;
+    write_ppm_header(width, height, DENOMINATOR);
+
+    if (width / 2 > 0 && height / 2 > 0) {
+        /* codewords are held in 64 bit words, as read_bitfile does */
+        codec40_context context = codec40_context_new(methods);
+        A2Methods_UArray2 word_row = methods -> new(width / 2, 1,
+                                                    sizeof(uint64_t));
+        for (unsigned j = 0; j < height / 2; j++) {
+            read_codewords(inputfp, methods, word_row);
+            A2Methods_UArray2 rows = codec40_decode(context, word_row);
+            write_ppm_rows(rows, methods);
+            methods -> free(&rows);
+        }
+        methods -> free(&word_row);
+        codec40_context_free(&context);
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Filename  : stream40.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Streaming versions of compress40 and decompress40 which only
+ *             ever hold a couple of rows of the image in memory, so that
+ *             very large images can be converted without swapping
+ */
+
+#ifndef STREAM40_INCLUDED
+#define STREAM40_INCLUDED
+
+#include <stdio.h>
+
+/*
+ * compress40_stream
+ *
+ * compresses the ppm image in the given file two rows at a time, writing
+ * the codewords for each pair of rows to standard output as soon as they
+ * are packed. Produces exactly the same bit file as compress40
+ *
+ * assumes the argument is not NULL
+ */
+void compress40_stream (FILE *inputfp);
+
+/*
+ * decompress40_stream
+ *
+ * decompresses the bit file in the given file one row of codewords at a
+ * time, writing the two rows of pixels for each to standard output as soon
+ * as they are decoded. Produces exactly the same ppm image as decompress40
+ *
+ * assumes the argument is not NULL
+ */
+void decompress40_stream (FILE *inputfp);
+
+#endif
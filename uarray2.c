@@ -3,12 +3,16 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "uarray2_span.h"
+#include "stats40.h"
 
 struct UArray2_T {
     int DIM1;
     int DIM2;
     int ELEMENT_SIZE;
     UArray_T array;
+    char *elements; /* first element of array, NULL when it is empty */
+    stats40_stage owner; /* stage charged for the elements */
 };
 
 UArray2_T UArray2_new(int dim1, int dim2, int elemSize) {
@@ -19,6 +23,11 @@ UArray2_T UArray2_new(int dim1, int dim2, int elemSize) {
     uarray2 -> DIM2 = dim2; /* height */
     uarray2 -> ELEMENT_SIZE = elemSize;
     uarray2 -> array = UArray_new(dim1*dim2, elemSize);
+    uarray2 -> elements = NULL;
+    if (dim1 * dim2 > 0) {
+        uarray2 -> elements = UArray_at(uarray2 -> array, 0);
+    }
+    uarray2 -> owner = stats40_allocated((size_t) dim1 * dim2 * elemSize);
 
     return uarray2;
 }
@@ -45,15 +54,52 @@ void* UArray2_at(UArray2_T uarray2, int col, int row) {
     return UArray_at(uarray2 -> array, index);
 }
 
+/* same address as UArray2_at, with no checks; see uarray2_span.h */
+void *UArray2_at_unchecked(UArray2_T uarray2, int col, int row) {
+    return uarray2 -> elements + ((size_t) row * uarray2 -> DIM1 + col) *
+                                 uarray2 -> ELEMENT_SIZE;
+}
+
+int UArray2_stride(UArray2_T uarray2) {
+    assert(uarray2 != NULL);
+    return uarray2 -> DIM1 * uarray2 -> ELEMENT_SIZE;
+}
+
+void *UArray2_row(UArray2_T uarray2, int row) {
+    assert(uarray2 != NULL);
+    assert(row >= 0 && row < uarray2 -> DIM2);
+    assert(uarray2 -> DIM1 > 0);
+    return UArray2_at_unchecked(uarray2, 0, row);
+}
+
+struct UArray2_span UArray2_span(UArray2_T uarray2, int col, int row,
+                                 int width, int height) {
+    assert(uarray2 != NULL);
+    assert(col >= 0 && row >= 0 && width >= 0 && height >= 0);
+    assert(col + width <= uarray2 -> DIM1);
+    assert(row + height <= uarray2 -> DIM2);
+
+    struct UArray2_span span = { NULL, width, height,
+                                 uarray2 -> ELEMENT_SIZE,
+                                 UArray2_stride(uarray2) };
+    if (width > 0 && height > 0) {
+        span.base = UArray2_at_unchecked(uarray2, col, row);
+    }
+    return span;
+}
+
 void UArray2_map_row_major(UArray2_T uarray2, void func(int i, int j, 
                            UArray2_T a, void *p1, void *p2), void* cl) {
     assert(uarray2 != NULL);
     assert(uarray2 -> array != NULL);
     assert(func != NULL);
     
-    for (int row = 0; row < uarray2 -> DIM2; row++) {
-        for (int col = 0; col < uarray2 -> DIM1; col++) {
-            func(col, row, uarray2, UArray2_at(uarray2, col, row), cl);
+    struct UArray2_span span = UArray2_span(uarray2, 0, 0, uarray2 -> DIM1,
+                                            uarray2 -> DIM2);
+    for (int row = 0; row < span.height; row++) {
+        char *elem = UArray2_span_row(span, row);
+        for (int col = 0; col < span.width; col++, elem += span.size) {
+            func(col, row, uarray2, elem, cl);
         }
     }
 }
@@ -64,9 +110,12 @@ void UArray2_map_col_major(UArray2_T uarray2, void func(int i, int j,
     assert(uarray2 -> array != NULL);
     assert(func != NULL);
     
-    for (int col = 0; col < uarray2 -> DIM1; col++) {
-        for (int row = 0; row < uarray2 -> DIM2; row++) {
-            func(col, row, uarray2, UArray2_at(uarray2, col, row), cl);
+    struct UArray2_span span = UArray2_span(uarray2, 0, 0, uarray2 -> DIM1,
+                                            uarray2 -> DIM2);
+    for (int col = 0; col < span.width; col++) {
+        char *elem = UArray2_span_at(span, col, 0);
+        for (int row = 0; row < span.height; row++, elem += span.stride) {
+            func(col, row, uarray2, elem, cl);
         }
     }
 }
@@ -75,6 +124,9 @@ void UArray2_free(UArray2_T* uarray2Ptr) {
     assert(uarray2Ptr != NULL);
     assert(*uarray2Ptr != NULL);
     assert((*uarray2Ptr) -> array);
+    stats40_freed((*uarray2Ptr) -> owner,
+                  (size_t) (*uarray2Ptr) -> DIM1 * (*uarray2Ptr) -> DIM2 *
+                  (*uarray2Ptr) -> ELEMENT_SIZE);
     UArray_free(&(*uarray2Ptr) -> array);
     free(*uarray2Ptr);
 }
@@ -0,0 +1,93 @@
+/*
+ * Filename  : uarray2_span.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Raw row access for UArray2s, implemented in uarray2.c next to
+ *             the rest of the UArray2 interface. A UArray2 keeps its
+ *             elements row by row in one block of memory, so a row or a
+ *             rectangle of it can be handed out as a base pointer and a
+ *             row stride. Bounds are checked once, when the span is made,
+ *             and loops then walk the memory directly instead of paying
+ *             for UArray2_at's checks on every element.
+ */
+
+#ifndef UARRAY2_SPAN_INCLUDED
+#define UARRAY2_SPAN_INCLUDED
+
+#include <stddef.h>
+#include "uarray2.h"
+
+/* a width by height rectangle of a UArray2; element (col, row) of the span
+ * is size bytes wide and starts at base + row * stride + col * size */
+struct UArray2_span {
+
+    char *base;     /* NULL if the span is empty */
+    int width,
+        height,
+        size;
+    size_t stride;  /* bytes from the start of one row to the next */
+
+};
+
+/*
+ * UArray2_span
+ *
+ * returns the span of the given UArray2 whose top left element is at
+ * (col, row); it stays valid until the UArray2 is freed
+ *
+ * checked runtime error if the rectangle is not inside the UArray2
+ */
+extern struct UArray2_span UArray2_span(UArray2_T uarray2, int col, int row,
+                                        int width, int height);
+
+/*
+ * UArray2_row
+ *
+ * returns a pointer to the first element of the given row; the rest of the
+ * row follows it contiguously
+ *
+ * checked runtime error if the row is out of bounds or the array is empty
+ */
+extern void *UArray2_row(UArray2_T uarray2, int row);
+
+/*
+ * UArray2_stride
+ *
+ * returns the number of bytes from the start of one row to the next
+ */
+extern int UArray2_stride(UArray2_T uarray2);
+
+/*
+ * UArray2_at_unchecked
+ *
+ * returns the same pointer as UArray2_at without checking the array or the
+ * indices; UArray2_at_fast picks it in release builds (NDEBUG) and
+ * UArray2_at otherwise
+ */
+extern void *UArray2_at_unchecked(UArray2_T uarray2, int col, int row);
+
+#ifdef NDEBUG
+#define UArray2_at_fast(uarray2, col, row) \
+        UArray2_at_unchecked((uarray2), (col), (row))
+#else
+#define UArray2_at_fast(uarray2, col, row) UArray2_at((uarray2), (col), (row))
+#endif
+
+/*
+ * UArray2_span_row, UArray2_span_at
+ *
+ * return pointers into a span without any checks
+ */
+static inline void *UArray2_span_row(struct UArray2_span span, int row)
+{
+    return span.base + (size_t) row * span.stride;
+}
+
+static inline void *UArray2_span_at(struct UArray2_span span, int col,
+                                    int row)
+{
+    return span.base + (size_t) row * span.stride + (size_t) col * span.size;
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include "assert.h"
 #include "uarray2b.h"
 #include "uarray2.h"
+#include "uarray2_span.h"
 #include "math.h"
 
 struct UArray2b_T {
@@ -36,17 +37,12 @@ struct UArray2b_T {
         int contentWidth;
         int size;
         int blocksize;
+        int widthInBlocks;
         UArray2_T array2D;
+        char *elements; /* first element of array2D */
 };
 
-struct Coordinates {
-    int col;
-    int row;
-};
-
-struct Coordinates convert_coordinates(UArray2b_T array2D, int col, int row);
-struct Coordinates simple_index_to_coordinates(int index, int width);
-struct Coordinates index_to_coordinates(UArray2b_T array2D, int index);
+size_t element_index(UArray2b_T array2D, int col, int row);
 
 UArray2b_T UArray2b_new (int width, int height, int size, int blocksize)
 {
@@ -70,7 +66,9 @@ UArray2b_T UArray2b_new (int width, int height, int size, int blocksize)
     uarray2b -> height = fullHeight;
     uarray2b -> size = size;
     uarray2b -> blocksize = blocksize;
+    uarray2b -> widthInBlocks = blockWidth;
     uarray2b -> array2D = UArray2_new(fullWidth, fullHeight, size);
+    uarray2b -> elements = UArray2_row(uarray2b -> array2D, 0);
 
     return uarray2b;
 }
@@ -206,8 +204,8 @@ void *UArray2b_at(UArray2b_T array2D, int column, int row)
     assert(array2D != NULL);
     assert(column >= 0 && column < (array2D -> contentWidth));
     assert(row >= 0 && row < (array2D -> contentHeight));
-    struct Coordinates coords = convert_coordinates(array2D, column, row);
-    return UArray2_at(array2D -> array2D, coords.col, coords.row);
+    return array2D -> elements + element_index(array2D, column, row) *
+                                 array2D -> size;
 }
 
 /*******************************************
@@ -230,110 +228,60 @@ void UArray2b_map(UArray2b_T array2D,
                   void *cl)
 {
     assert(array2D != NULL);
-    int size = array2D -> height * array2D -> width;
-
-    struct Coordinates coords;
-
-    for (int index = 0; index < size; index++) {
-        coords = index_to_coordinates(array2D, index);
-        if (coords.row < array2D -> contentHeight && 
-            coords.col < array2D -> contentWidth) {
-            void* val = UArray2b_at(array2D, coords.col, coords.row);
-            apply(coords.col, coords.row, array2D, val, cl);
+    int blocksize = array2D -> blocksize,
+        size      = array2D -> size;
+    size_t blockBytes = (size_t) blocksize * blocksize * size;
+    char *block = array2D -> elements;
+
+    /* blocks are stored one after another in block major order, and the
+     * cells of each block row by row, so one pointer walks them all */
+    for (int top = 0; top < array2D -> height; top += blocksize) {
+        int rows = array2D -> contentHeight - top;
+        if (rows > blocksize) {
+            rows = blocksize;
+        }
+        for (int left = 0; left < array2D -> width;
+             left += blocksize, block += blockBytes) {
+            int cols = array2D -> contentWidth - left;
+            if (cols > blocksize) {
+                cols = blocksize;
+            }
+            if (rows <= 0 || cols <= 0) { /* only padding */
+                continue;
+            }
+            for (int r = 0; r < rows; r++) {
+                char *elem = block + (size_t) r * blocksize * size;
+                for (int c = 0; c < cols; c++, elem += size) {
+                    apply(left + c, top + r, array2D, elem, cl);
+                }
+            }
         }
     }
 }
 
 /*******************************************
- *  Name        :   convert_coordinates
+ *  Name        :   element_index
  * 
- *  Params      :   UArray2b_T uarray2b :   pointer to UArray2_T struct
- *                  int col             :   column value of coord to be 
- *                                          converted
- *                  int row             :   row value of coord to be converted
-
+ *  Params      :   UArray2b_T uarray2b :   pointer to UArray2b_T struct
+ *                  int col             :   column of an element
+ *                  int row             :   row of an element
  * 
- *  Returns     :   struct C            :   pointer to a struct containing the 
- *                                          row and col values of the new coord
+ *  Returns     :   size_t              :   number of elements stored 
+ *                                          before it
  * 
- *  Function    :   converts the coordinates of an element in the virtual array
- *                  to the coordinates of where they are actually stored in the
- *                  2d array in memory
+ *  Function    :   finds where an element of the virtual array is stored
+ *                  in the single block of memory behind the 2d array: 
+ *                  whole blocks come first in block major order, then the
+ *                  rows of its own block above it, then the cells to its
+ *                  left
  * 
  ******************************************/
-struct Coordinates convert_coordinates(UArray2b_T array2D, int col, int row)
+size_t element_index(UArray2b_T array2D, int col, int row)
 {
-    assert(array2D);
-    struct Coordinates coords;
-    coords.col = col;
-    coords.row = row;
-
     int blockSize = array2D -> blocksize;
-
-    if (blockSize == 1) {
-        return coords;
-    }
-
-    int widthInBlocks = (array2D -> width) / (blockSize);
-
-    int blockIndex = (((row / blockSize) * widthInBlocks) + (col / blockSize));
+    size_t blockIndex = (size_t) (row / blockSize) * array2D -> widthInBlocks
+                        + col / blockSize;
     int blockElement = ((row % blockSize) * blockSize) + (col % blockSize);
-    int index = blockIndex * (blockSize * blockSize) + blockElement;
-    
-    return simple_index_to_coordinates(index, array2D -> width);
-}
-
-/*******************************************
- *  Name        :   simple_index_to_coordinates
- * 
- *  Params      :   int index   :   index of element in linear implementation
- *                  int width   :   width of the 2d array being used
- * 
- *  Returns     :   struct C    :   pointer to a struct containing the 
- *                                          row and col values of the new coord
- * 
- *  Function    :   returns the coordinates of an element whose linear index
- *                  was given
- * 
- ******************************************/
-struct Coordinates simple_index_to_coordinates(int index, int width)
-{
-    struct Coordinates coords;
-    coords.col = index % width;
-    coords.row = index / width;
-
-    return coords;
-}
-
-/*******************************************
- *  Name        :   simple_index_to_coordinates
- * 
- *  Params      :   UArray2b_T uarray2b :   pointer to UArray2_T struct
- *                  int index           :   index of element in linear 
- *                                          implementation
- * 
- *  Returns     :   struct C            :   pointer to a struct containing the 
- *                                          row and col values of the new coord
- * 
- *  Function    :   returns the coordinates of an element whose linear index
- *                  was given, does math to account for the blocked array
- * 
- ******************************************/
-struct Coordinates index_to_coordinates(UArray2b_T array2D, int index)
-{
-    assert(array2D);
-    struct Coordinates coords;
-
-    int blocksize = array2D -> blocksize;
-    int widthInBlocks = (array2D -> width) / (blocksize);
-    int blockElement = index % (blocksize * blocksize);
-    int blockIndex = (index - blockElement) / (blocksize * blocksize);
-
-    coords.col  =   (blockIndex % widthInBlocks) * blocksize
-                    + blockElement % blocksize;
-
-    coords.row  =   (blockIndex / widthInBlocks) * blocksize
-                    + blockElement / blocksize;
 
-    return coords;
+    return blockIndex * blockSize * blockSize + blockElement;
 }
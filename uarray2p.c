@@ -0,0 +1,227 @@
+/*
+ * Filename  : uarray2p.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the uarray2p.h interface. The elements live
+ *             in one UARRAY2P_ALIGN aligned allocation; block (bcol, brow)
+ *             starts blockBytes * (brow * widthInBlocks + bcol) bytes in,
+ *             and cell (col, row) of the array is cell
+ *             ((row & mask) << shift) + (col & mask) of block
+ *             (col >> shift, row >> shift).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "uarray2p.h"
+#include "stats40.h"
+
+#define BLOCK_LIMIT 64000 /* bytes; the most one default block may use */
+
+struct UArray2p_T {
+
+    int width,          /* content, without the padding */
+        height,
+        size,
+        shift,          /* the block edge is 1 << shift */
+        mask,           /* (1 << shift) - 1 */
+        widthInBlocks,
+        heightInBlocks;
+    size_t blockBytes;  /* a whole block, padded to UARRAY2P_ALIGN */
+    char *elements;
+    stats40_stage owner; /* stage charged for the elements */
+
+};
+
+/*
+ * UArray2p_new (int width, int height, int size, int blocksize)
+ *
+ * Parameters: int width, height: size of the array in elements
+ *             int size: size of one element in bytes
+ *             int blocksize: requested block edge in elements
+ * Returns   : UArray2p_T: the new array, with every element zeroed
+ * Does      : Rounds blocksize up to a power of two, pads each block of
+ *             more than a cache line out to a whole number of lines, and
+ *             allocates the blocks in one aligned run
+ */
+UArray2p_T UArray2p_new (int width, int height, int size, int blocksize)
+{
+    assert(width > 0 && height > 0);
+    assert(size > 0 && blocksize > 0);
+
+    int shift = 0;
+    while ((1 << shift) < blocksize) {
+        shift++;
+    }
+
+    UArray2p_T array2p = malloc(sizeof(*array2p));
+    assert(array2p != NULL);
+    array2p -> width          = width;
+    array2p -> height         = height;
+    array2p -> size           = size;
+    array2p -> shift          = shift;
+    array2p -> mask           = (1 << shift) - 1;
+    array2p -> widthInBlocks  = (width  + array2p -> mask) >> shift;
+    array2p -> heightInBlocks = (height + array2p -> mask) >> shift;
+    array2p -> blockBytes     = (size_t) size << (2 * shift);
+
+    /* blocks smaller than a line are packed, so that with 1x1 blocks the
+     * rows are contiguous, as a blocksize of 1 promises */
+    if (array2p -> blockBytes > UARRAY2P_ALIGN) {
+        array2p -> blockBytes = (array2p -> blockBytes + UARRAY2P_ALIGN - 1)
+                                / UARRAY2P_ALIGN * UARRAY2P_ALIGN;
+    }
+
+    size_t bytes = array2p -> blockBytes * array2p -> widthInBlocks *
+                   array2p -> heightInBlocks;
+    void *elements = NULL;
+    if (posix_memalign(&elements, UARRAY2P_ALIGN, bytes) != 0) {
+        elements = NULL;
+    }
+    assert(elements != NULL);
+    memset(elements, 0, bytes);
+    array2p -> elements = elements;
+    array2p -> owner    = stats40_allocated(bytes);
+
+    return array2p;
+}
+
+/*
+ * UArray2p_new_64K_block (int width, int height, int size)
+ *
+ * Parameters: int width, height: size of the array in elements
+ *             int size: size of one element in bytes
+ * Returns   : UArray2p_T: the new array
+ * Does      : Starts from the largest power of two edge whose block fits
+ *             in BLOCK_LIMIT bytes, then halves it while half would still
+ *             cover the shorter side of the array, so small or thin arrays
+ *             are not mostly padding
+ */
+UArray2p_T UArray2p_new_64K_block (int width, int height, int size)
+{
+    assert(width > 0 && height > 0 && size > 0);
+
+    int blocksize = 1;
+    while ((size_t) size * (2 * blocksize) * (2 * blocksize) <=
+           BLOCK_LIMIT) {
+        blocksize *= 2;
+    }
+
+    int shorter = width < height ? width : height;
+    while (blocksize > 1 && blocksize / 2 >= shorter) {
+        blocksize /= 2;
+    }
+
+    return UArray2p_new(width, height, size, blocksize);
+}
+
+/*
+ * UArray2p_free (UArray2p_T *array2p)
+ *
+ * Parameters: UArray2p_T *array2p: pointer to the array to free
+ * Returns   : Nothing
+ * Does      : Frees the array's blocks and the array, and sets it to NULL
+ */
+void UArray2p_free (UArray2p_T *array2p)
+{
+    assert(array2p != NULL && *array2p != NULL);
+    stats40_freed((*array2p) -> owner,
+                  (*array2p) -> blockBytes * (*array2p) -> widthInBlocks *
+                  (*array2p) -> heightInBlocks);
+    free((*array2p) -> elements);
+    free(*array2p);
+    *array2p = NULL;
+}
+
+int UArray2p_width (UArray2p_T array2p)
+{
+    assert(array2p != NULL);
+    return array2p -> width;
+}
+
+int UArray2p_height (UArray2p_T array2p)
+{
+    assert(array2p != NULL);
+    return array2p -> height;
+}
+
+int UArray2p_size (UArray2p_T array2p)
+{
+    assert(array2p != NULL);
+    return array2p -> size;
+}
+
+int UArray2p_blocksize (UArray2p_T array2p)
+{
+    assert(array2p != NULL);
+    return 1 << array2p -> shift;
+}
+
+/*
+ * UArray2p_at (UArray2p_T array2p, int column, int row)
+ *
+ * Parameters: UArray2p_T array2p: the array
+ *             int column, row: indices of an element
+ * Returns   : void *: pointer to the element
+ * Does      : Finds the element's block and its cell within the block with
+ *             shifts and masks only
+ */
+void *UArray2p_at (UArray2p_T array2p, int column, int row)
+{
+    assert(array2p != NULL);
+    assert(column >= 0 && column < array2p -> width);
+    assert(row >= 0 && row < array2p -> height);
+
+    int shift = array2p -> shift,
+        mask  = array2p -> mask;
+    size_t block = (size_t) (row >> shift) * array2p -> widthInBlocks +
+                   (column >> shift);
+    size_t cell  = ((size_t) (row & mask) << shift) + (column & mask);
+
+    return array2p -> elements + block * array2p -> blockBytes +
+                                 cell * array2p -> size;
+}
+
+/*
+ * UArray2p_map (UArray2p_T array2p, apply, void *cl)
+ *
+ * Parameters: UArray2p_T array2p: the array
+ *             apply: function called on each element
+ *             void *cl: closure passed to apply
+ * Returns   : Nothing
+ * Does      : Walks the blocks in storage order with one block pointer,
+ *             clipping the last block column and row to the content so
+ *             the padding is never visited
+ */
+void UArray2p_map (UArray2p_T array2p,
+                   void apply(int col, int row, UArray2p_T array2p,
+                              void *elem, void *cl),
+                   void *cl)
+{
+    assert(array2p != NULL);
+    int blocksize = 1 << array2p -> shift,
+        size      = array2p -> size;
+    size_t rowBytes = (size_t) blocksize * size;
+    char *block = array2p -> elements;
+
+    for (int top = 0; top < array2p -> height; top += blocksize) {
+        int rows = array2p -> height - top;
+        if (rows > blocksize) {
+            rows = blocksize;
+        }
+        for (int left = 0; left < array2p -> width;
+             left += blocksize, block += array2p -> blockBytes) {
+            int cols = array2p -> width - left;
+            if (cols > blocksize) {
+                cols = blocksize;
+            }
+            for (int r = 0; r < rows; r++) {
+                char *elem = block + r * rowBytes;
+                for (int c = 0; c < cols; c++, elem += size) {
+                    apply(left + c, top + r, array2p, elem, cl);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Filename  : uarray2p.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : A blocked 2D array whose block edge is a power of two. Like a
+ *             UArray2b, the array is split into square blocks stored one
+ *             after another in block major order, with the cells of each
+ *             block stored row by row; but because the edge is 2^k, the
+ *             block and the cell within it are found with shifts and masks
+ *             instead of division and modulo. Every block bigger than a
+ *             64-byte cache line starts on a line; smaller blocks are
+ *             packed, so with a blocksize of 1 the rows are contiguous.
+ */
+
+#ifndef UARRAY2P_INCLUDED
+#define UARRAY2P_INCLUDED
+
+#define UARRAY2P_ALIGN 64 /* bytes; blocks bigger than this start on it */
+
+#define T UArray2p_T
+typedef struct T *T;
+
+/*
+ * UArray2p_new
+ *
+ * returns a new width by height array of elements of the given size,
+ * whose block edge is blocksize rounded up to a power of two
+ *
+ * checked runtime error if width, height, size, or blocksize is not
+ * positive
+ */
+extern T UArray2p_new (int width, int height, int size, int blocksize);
+
+/*
+ * UArray2p_new_64K_block
+ *
+ * like UArray2p_new, but picks the largest power of two block edge whose
+ * block fits in 64KB, and no larger than the smaller side of the array
+ * needs
+ */
+extern T UArray2p_new_64K_block (int width, int height, int size);
+
+/*
+ * UArray2p_free
+ *
+ * frees the given array and sets it to NULL
+ */
+extern void UArray2p_free (T *array2p);
+
+extern int UArray2p_width     (T array2p);
+extern int UArray2p_height    (T array2p);
+extern int UArray2p_size      (T array2p);
+extern int UArray2p_blocksize (T array2p);
+
+/*
+ * UArray2p_at
+ *
+ * returns a pointer to the element at (column, row)
+ *
+ * checked runtime error if the indices are out of bounds
+ */
+extern void *UArray2p_at (T array2p, int column, int row);
+
+/*
+ * UArray2p_map
+ *
+ * calls apply on every element in block major order: block by block, and
+ * row by row within each block, skipping the padding past the right and
+ * bottom edges
+ */
+extern void UArray2p_map (T array2p,
+                          void apply(int col, int row, T array2p,
+                                     void *elem, void *cl),
+                          void *cl);
+
+#undef T
+#endif
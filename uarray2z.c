@@ -0,0 +1,382 @@
+/*
+ * Filename  : uarray2z.c
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : Implementation of the uarray2z.h interface. The array is
+ *             padded to 2^colBits by 2^rowBits and the low `square` bits of
+ *             the column and row (square being the smaller of the two) are
+ *             interleaved, column bit first; the remaining high bits of the
+ *             longer side sit above them. So the array is a row or column
+ *             of 2^square by 2^square Z-order tiles. An element's index is
+ *             the column deposited into colMask OR the row deposited into
+ *             rowMask, done with BMI2 pdep where the compiler targets it
+ *             (-mbmi2) and with shifts and magic masks elsewhere.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "uarray2z.h"
+#include "stats40.h"
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#define UARRAY2Z_ALIGN 64   /* bytes; alignment of the elements */
+#define MAX_SIDE_BITS  30   /* each side must be below 2^30 */
+#define LEAF_BITS      3    /* log2 of the edge of a leaf in map_zorder */
+
+struct UArray2z_T {
+
+    int width,          /* content, without the padding */
+        height,
+        size,
+        square;         /* log2 of the edge of one Z-order tile */
+    uint64_t colMask,   /* index bits that come from the column */
+             rowMask;   /* index bits that come from the row */
+    char *elements;
+    stats40_stage owner; /* stage charged for the elements */
+
+};
+
+uint64_t spread_bits(uint64_t x);
+uint64_t compact_bits(uint64_t x);
+uint64_t col_index(UArray2z_T array2z, int col);
+uint64_t row_index(UArray2z_T array2z, int row);
+uint64_t index_mask(int bits, int square, int first);
+int ceil_log2(int n);
+
+/*
+ * UArray2z_new (int width, int height, int size)
+ *
+ * Parameters: int width, height: size of the array in elements
+ *             int size: size of one element in bytes
+ * Returns   : UArray2z_T: the new array, with every element zeroed
+ * Does      : Pads each side to a power of two, works out which index bits
+ *             belong to the column and which to the row, and allocates the
+ *             padded array in one aligned block
+ */
+UArray2z_T UArray2z_new (int width, int height, int size)
+{
+    assert(width > 0 && height > 0 && size > 0);
+    assert(width < (1 << MAX_SIDE_BITS) && height < (1 << MAX_SIDE_BITS));
+
+    int colBits = ceil_log2(width),
+        rowBits = ceil_log2(height);
+
+    UArray2z_T array2z = malloc(sizeof(*array2z));
+    assert(array2z != NULL);
+    array2z -> width  = width;
+    array2z -> height = height;
+    array2z -> size   = size;
+    array2z -> square = colBits < rowBits ? colBits : rowBits;
+
+    array2z -> colMask = index_mask(colBits, array2z -> square, 0);
+    array2z -> rowMask = index_mask(rowBits, array2z -> square, 1);
+
+    size_t bytes = ((size_t) 1 << (colBits + rowBits)) * size;
+    void *elements = NULL;
+    if (posix_memalign(&elements, UARRAY2Z_ALIGN, bytes) != 0) {
+        elements = NULL;
+    }
+    assert(elements != NULL);
+    memset(elements, 0, bytes);
+    array2z -> elements = elements;
+    array2z -> owner    = stats40_allocated(bytes);
+
+    return array2z;
+}
+
+/*
+ * UArray2z_free (UArray2z_T *array2z)
+ *
+ * Parameters: UArray2z_T *array2z: pointer to the array to free
+ * Returns   : Nothing
+ * Does      : Frees the elements and the array, and sets it to NULL
+ */
+void UArray2z_free (UArray2z_T *array2z)
+{
+    assert(array2z != NULL && *array2z != NULL);
+    stats40_freed((*array2z) -> owner,
+                  ((size_t) 1 << (ceil_log2((*array2z) -> width) +
+                                  ceil_log2((*array2z) -> height))) *
+                  (*array2z) -> size);
+    free((*array2z) -> elements);
+    free(*array2z);
+    *array2z = NULL;
+}
+
+int UArray2z_width (UArray2z_T array2z)
+{
+    assert(array2z != NULL);
+    return array2z -> width;
+}
+
+int UArray2z_height (UArray2z_T array2z)
+{
+    assert(array2z != NULL);
+    return array2z -> height;
+}
+
+int UArray2z_size (UArray2z_T array2z)
+{
+    assert(array2z != NULL);
+    return array2z -> size;
+}
+
+int UArray2z_blocksize (UArray2z_T array2z)
+{
+    assert(array2z != NULL);
+    return 1 << array2z -> square;
+}
+
+/*
+ * UArray2z_at (UArray2z_T array2z, int column, int row)
+ *
+ * Parameters: UArray2z_T array2z: the array
+ *             int column, row: indices of an element
+ * Returns   : void *: pointer to the element
+ * Does      : ORs together the column's and row's index bits
+ */
+void *UArray2z_at (UArray2z_T array2z, int column, int row)
+{
+    assert(array2z != NULL);
+    assert(column >= 0 && column < array2z -> width);
+    assert(row >= 0 && row < array2z -> height);
+
+    uint64_t index = col_index(array2z, column) | row_index(array2z, row);
+    return array2z -> elements + index * array2z -> size;
+}
+
+/*
+ * UArray2z_map_row_major (UArray2z_T array2z, apply, void *cl)
+ *
+ * Parameters: UArray2z_T array2z: the array
+ *             apply: function called on each element
+ *             void *cl: closure passed to apply
+ * Returns   : Nothing
+ * Does      : Deposits each row once, then steps the column's index bits
+ *             with a masked increment: setting the bits outside colMask
+ *             before adding one carries straight into the next column bit
+ */
+void UArray2z_map_row_major (UArray2z_T array2z, UArray2z_applyfun apply,
+                             void *cl)
+{
+    assert(array2z != NULL);
+    uint64_t colMask = array2z -> colMask;
+
+    for (int row = 0; row < array2z -> height; row++) {
+        uint64_t rowBits = row_index(array2z, row),
+                 colBits = 0;
+        for (int col = 0; col < array2z -> width; col++) {
+            apply(col, row, array2z, array2z -> elements +
+                  (colBits | rowBits) * array2z -> size, cl);
+            colBits = (colBits - colMask) & colMask;
+        }
+    }
+}
+
+/*
+ * UArray2z_map_col_major (UArray2z_T array2z, apply, void *cl)
+ *
+ * Parameters: UArray2z_T array2z: the array
+ *             apply: function called on each element
+ *             void *cl: closure passed to apply
+ * Returns   : Nothing
+ * Does      : Like UArray2z_map_row_major, with the roles of the column
+ *             and row swapped
+ */
+void UArray2z_map_col_major (UArray2z_T array2z, UArray2z_applyfun apply,
+                             void *cl)
+{
+    assert(array2z != NULL);
+    uint64_t rowMask = array2z -> rowMask;
+
+    for (int col = 0; col < array2z -> width; col++) {
+        uint64_t colBits = col_index(array2z, col),
+                 rowBits = 0;
+        for (int row = 0; row < array2z -> height; row++) {
+            apply(col, row, array2z, array2z -> elements +
+                  (colBits | rowBits) * array2z -> size, cl);
+            rowBits = (rowBits - rowMask) & rowMask;
+        }
+    }
+}
+
+/*
+ * UArray2z_map_zorder (UArray2z_T array2z, apply, void *cl)
+ *
+ * Parameters: UArray2z_T array2z: the array
+ *             apply: function called on each element
+ *             void *cl: closure passed to apply
+ * Returns   : Nothing
+ * Does      : Walks memory in order, one Z-order tile at a time, skipping
+ *             the tiles that are only padding; within a tile the column
+ *             and row are the even and odd bits of the offset
+ */
+void UArray2z_map_zorder (UArray2z_T array2z, UArray2z_applyfun apply,
+                          void *cl)
+{
+    assert(array2z != NULL);
+    int square = array2z -> square,
+        edge   = 1 << square,
+        width  = array2z -> width,
+        height = array2z -> height,
+        size   = array2z -> size;
+    char *elem = array2z -> elements;
+
+    /* the tiles are walked in leaves of up to 8x8 cells, whose Z-order
+     * offsets are worked out once; leaves wholly inside the content need
+     * no bounds checks and leaves wholly in the padding are skipped */
+    int leafBits  = square < LEAF_BITS ? square : LEAF_BITS,
+        leafEdge  = 1 << leafBits,
+        leafCells = 1 << (2 * leafBits);
+    int leafCol[1 << (2 * LEAF_BITS)],
+        leafRow[1 << (2 * LEAF_BITS)];
+    for (int i = 0; i < leafCells; i++) {
+        leafCol[i] = (int) compact_bits(i);
+        leafRow[i] = (int) compact_bits(i >> 1);
+    }
+
+    bool across = (array2z -> colMask >> (2 * square)) != 0;
+    int tiles = ((across ? width : height) + edge - 1) >> square;
+    uint64_t tileCells = (uint64_t) 1 << (2 * square);
+
+    for (int tile = 0; tile < tiles; tile++) {
+        int left = across ? tile << square : 0,
+            top  = across ? 0 : tile << square;
+        for (uint64_t cell = 0; cell < tileCells;
+             cell += leafCells, elem += (size_t) leafCells * size) {
+            int col = left + (int) compact_bits(cell),
+                row = top  + (int) compact_bits(cell >> 1);
+            if (col + leafEdge <= width && row + leafEdge <= height) {
+                for (int i = 0; i < leafCells; i++) {
+                    apply(col + leafCol[i], row + leafRow[i], array2z,
+                          elem + (size_t) i * size, cl);
+                }
+            } else if (col < width && row < height) {
+                for (int i = 0; i < leafCells; i++) {
+                    int c = col + leafCol[i],
+                        r = row + leafRow[i];
+                    if (c < width && r < height) {
+                        apply(c, r, array2z, elem + (size_t) i * size, cl);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * spread_bits (uint64_t x)
+ *
+ * Parameters: uint64_t x: a value below 2^32
+ * Returns   : uint64_t: x with a zero bit inserted above each of its bits
+ * Does      : Deposits x into the even bits, with pdep under BMI2
+ */
+uint64_t spread_bits(uint64_t x)
+{
+#ifdef __BMI2__
+    return _pdep_u64(x, 0x5555555555555555ULL);
+#else
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8))  & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2))  & 0x3333333333333333ULL;
+    x = (x | (x << 1))  & 0x5555555555555555ULL;
+    return x;
+#endif
+}
+
+/*
+ * compact_bits (uint64_t x)
+ *
+ * Parameters: uint64_t x: any value
+ * Returns   : uint64_t: the even bits of x, packed together
+ * Does      : The inverse of spread_bits, with pext under BMI2
+ */
+uint64_t compact_bits(uint64_t x)
+{
+#ifdef __BMI2__
+    return _pext_u64(x, 0x5555555555555555ULL);
+#else
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1))  & 0x3333333333333333ULL;
+    x = (x | (x >> 2))  & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x >> 4))  & 0x00FF00FF00FF00FFULL;
+    x = (x | (x >> 8))  & 0x0000FFFF0000FFFFULL;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+    return x;
+#endif
+}
+
+/*
+ * col_index (UArray2z_T array2z, int col)
+ * row_index (UArray2z_T array2z, int row)
+ *
+ * Parameters: UArray2z_T array2z: the array
+ *             int col, row: a column or row inside the padded array
+ * Returns   : uint64_t: the index bits contributed by the column or row
+ * Does      : Deposits the value into colMask or rowMask; pdep does this
+ *             directly once the masks are known, and the portable version
+ *             spreads the tile's bits and lays any high bits above them
+ */
+uint64_t col_index(UArray2z_T array2z, int col)
+{
+#ifdef __BMI2__
+    return _pdep_u64((uint64_t) col, array2z -> colMask);
+#else
+    int square = array2z -> square;
+    return spread_bits(col & ((1 << square) - 1)) |
+           (uint64_t) (col >> square) << (2 * square);
+#endif
+}
+
+uint64_t row_index(UArray2z_T array2z, int row)
+{
+#ifdef __BMI2__
+    return _pdep_u64((uint64_t) row, array2z -> rowMask);
+#else
+    int square = array2z -> square;
+    return spread_bits(row & ((1 << square) - 1)) << 1 |
+           (uint64_t) (row >> square) << (2 * square);
+#endif
+}
+
+/*
+ * index_mask (int bits, int square, int first)
+ *
+ * Parameters: int bits: log2 of the padded side
+ *             int square: log2 of the tile edge
+ *             int first: 0 for the column, 1 for the row
+ * Returns   : uint64_t: the index bits that side's value is deposited into
+ * Does      : Takes every other bit of the tile's 2 * square bits, starting
+ *             at first, then every bit above the tile for the longer side
+ */
+uint64_t index_mask(int bits, int square, int first)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < bits; i++) {
+        mask |= (uint64_t) 1 << (i < square ? 2 * i + first : square + i);
+    }
+    return mask;
+}
+
+/*
+ * ceil_log2 (int n)
+ *
+ * Parameters: int n: a positive number
+ * Returns   : int: the smallest k with 2^k >= n
+ */
+int ceil_log2(int n)
+{
+    int k = 0;
+    while ((1 << k) < n) {
+        k++;
+    }
+    return k;
+}
@@ -0,0 +1,77 @@
+/*
+ * Filename  : uarray2z.h
+ *
+ * Authors   : Robert Lester, Craig Cagner
+ * Assignment: Arith
+ * Summary   : A 2D array stored along a Morton (Z-order) curve: the bits of
+ *             an element's column and row are interleaved to give its index,
+ *             so every aligned 2^j by 2^j square of the array is one
+ *             contiguous run of memory, whatever the element size. Elements
+ *             near each other in either direction are near each other in
+ *             memory, which suits work that walks both rows and columns.
+ */
+
+#ifndef UARRAY2Z_INCLUDED
+#define UARRAY2Z_INCLUDED
+
+#define T UArray2z_T
+typedef struct T *T;
+
+typedef void UArray2z_applyfun(int col, int row, T array2z, void *elem,
+                               void *cl);
+
+/*
+ * UArray2z_new
+ *
+ * returns a new width by height array of zeroed elements of the given
+ * size; each side is padded up to a power of two
+ *
+ * checked runtime error if width, height, or size is not positive, or if
+ * either side is 2^30 or more
+ */
+extern T UArray2z_new (int width, int height, int size);
+
+/*
+ * UArray2z_free
+ *
+ * frees the given array and sets it to NULL
+ */
+extern void UArray2z_free (T *array2z);
+
+extern int UArray2z_width  (T array2z);
+extern int UArray2z_height (T array2z);
+extern int UArray2z_size   (T array2z);
+
+/*
+ * UArray2z_blocksize
+ *
+ * returns the edge of the largest aligned square that is stored
+ * contiguously; it is 1 only when the array is a single row or column,
+ * whose elements are then stored in order
+ */
+extern int UArray2z_blocksize (T array2z);
+
+/*
+ * UArray2z_at
+ *
+ * returns a pointer to the element at (column, row)
+ *
+ * checked runtime error if the indices are out of bounds
+ */
+extern void *UArray2z_at (T array2z, int column, int row);
+
+/*
+ * UArray2z_map_row_major, UArray2z_map_col_major, UArray2z_map_zorder
+ *
+ * call apply on every element row by row, column by column, or in the
+ * order the elements are stored
+ */
+extern void UArray2z_map_row_major (T array2z, UArray2z_applyfun apply,
+                                    void *cl);
+extern void UArray2z_map_col_major (T array2z, UArray2z_applyfun apply,
+                                    void *cl);
+extern void UArray2z_map_zorder    (T array2z, UArray2z_applyfun apply,
+                                    void *cl);
+
+#undef T
+#endif
@@ -1,21 +1,25 @@
 /*
  * Filename: ypp_dct.c
- * 
+ *
  * Authors   : Robert Lester, Craig Cagner
  * Assignment: Arith
  * Summary   : The functions in this file perform the necessary operations to
- *             transform the y, pb, and pr values from our component_video
- *             struct at each point in the array of those component_video
- *             structs to dctrans structs which hold the a, b, c, d, average
- *             pb, and average pr values for 2-by-2 blocks in the array of
- *             component_video structs
+ *             transform the y, pb, and pr planes of an image into planes
+ *             holding the a, b, c, d, average pb, and average pr values of
+ *             each 2-by-2 block of the image, and back
  */
 
 #include "ypp_dct.h"
 
-/* struct containing discrete cosine attributes */
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define KERNEL_BLOCKS 4 /* 2x2 blocks transformed per pass of the kernels */
+
+/* struct containing discrete cosine attributes of one block */
 typedef struct dctrans {
-             
+
     float avgpb,
           avgpr,
           a,
@@ -25,230 +29,347 @@ typedef struct dctrans {
 
 } *dctrans;
 
-/* struct containing the cv values y, pb, and pr */
+/* struct containing the cv values y, pb, and pr of one pixel */
 typedef struct component_video {
 
-    float y, 
-          pb, 
+    float y,
+          pb,
           pr;
 
 } *component_video;
 
-/* closure struct containing a uarray2 and the methods for a uarray2 */
-typedef struct closure_struct {
-
-    A2Methods_UArray2 array2;
-    A2Methods_T methods;
-
-} *closure_struct;
-
-void perform_dct (int i, int j, A2Methods_UArray2 array2,
-                                A2Methods_Object *ptr, 
-                                void *cl);
-void reverse_dct (int i, int j, A2Methods_UArray2 array2, 
-                                A2Methods_Object *ptr,
-                                void *cl);
-void reverse_dct_calc (component_video ypp_rep, dctrans dct_rep, 
-                                                int block_counter);
-
-
-/* 
- * A2Methods_UArray2 ypp_to_dct (A2Methods_UArray2 array2, A2Methods_T methods)
- * 
- * Parameters: A2Methods_UArray2 array2: array of component_video structs
- *             A2Methods_T methods: methods for UArray2
- * Returns   : A2Methods_UArray2: 1/2 size array of dctrans structs in place
- *                                of the component_video structs
- * Does      : Takes in an array of component_video structs and performs
- *             calculations to create an array of dctrans structs with
- *             dimensions half the size from the y, pb, pr values.
+void block_to_dct (component_video tl, component_video tr,
+                   component_video bl, component_video br, dctrans dct_rep);
+void dct_to_block (dctrans dct_rep, component_video tl, component_video tr,
+                                    component_video bl, component_video br);
+void load_pixel (plane_set ypp_rep, int i, int j, component_video cv);
+void store_pixel (plane_set ypp_rep, int i, int j, component_video cv);
+void ypp_rows_to_dct (plane_set ypp_rep, plane_set dct_rep, int row);
+void dct_row_to_ypp (plane_set dct_rep, plane_set ypp_rep, int row);
+
+
+/*
+ * plane_set ypp_to_dct (plane_set ypp_rep)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes of an image with an
+ *                                even width and height
+ * Returns   : plane_set: 1/2 size avgpb, avgpr, a, b, c, and d planes
+ * Does      : Takes in y, pb, and pr planes and performs calculations to
+ *             create the transform planes, with dimensions half the size,
+ *             from the y, pb, pr values of each 2x2 block.
  */
-A2Methods_UArray2 ypp_to_dct (A2Methods_UArray2 array2, A2Methods_T methods) 
+plane_set ypp_to_dct (plane_set ypp_rep)
 {
-    assert(array2 != NULL);
-    assert(methods != NULL);
+    assert(ypp_rep != NULL);
     /* 2x2 box representation -> half the width and height */
-    int width  = (methods -> width(array2)) / 2,
-        height = (methods -> height(array2)) / 2;
-    A2Methods_UArray2 dct_rep = methods -> new(width, height, 
-                                                      sizeof(struct dctrans));
+    plane_set dct_rep = plane_set_new(ypp_rep -> width / 2,
+                                      ypp_rep -> height / 2, NUM_DCT_PLANES);
 
-    closure_struct cl = malloc(sizeof(*cl));
-    assert(cl != NULL);
-    cl -> array2 = dct_rep;
-    cl -> methods = methods;
+    ypp_to_dct_into(ypp_rep, dct_rep);
 
-    methods -> map_row_major(array2, perform_dct, cl);
+    return dct_rep;
+}
 
-    free(cl);
+/*
+ * ypp_to_dct_into (plane_set ypp_rep, plane_set dct_rep)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes
+ *             plane_set dct_rep: transform planes to fill, at most half
+ *                                the width and height of ypp_rep
+ * Returns   : None
+ * Does      : The same as ypp_to_dct, into planes the caller provides
+ */
+void ypp_to_dct_into (plane_set ypp_rep, plane_set dct_rep)
+{
+    assert(ypp_rep != NULL && dct_rep != NULL);
+    assert(dct_rep -> width * 2 <= ypp_rep -> width);
+    assert(dct_rep -> height * 2 <= ypp_rep -> height);
 
-    return dct_rep;
+    for (int j = 0; j < dct_rep -> height; j++) {
+        ypp_rows_to_dct(ypp_rep, dct_rep, j);
+    }
 }
 
+/*
+ * block_to_dct (component_video tl, component_video tr,
+ *               component_video bl, component_video br, dctrans dct_rep)
+ *
+ * Parameters: component_video tl, tr, bl, br: the top left, top right,
+ *                                             bottom left, and bottom right
+ *                                             pixels of a 2x2 block
+ *             dctrans dct_rep: where to store the block's transform
+ * Returns   : None
+ * Does      : uses Y1, Y2, Y3, and Y4 to calculate the a, b, c, and d
+ *             values for the block, and averages its pb and pr values
+ */
+void block_to_dct (component_video tl, component_video tr,
+                   component_video bl, component_video br, dctrans dct_rep)
+{
+    /* perform necessary calculations */
+    dct_rep -> avgpb = (tl -> pb + tr -> pb + bl -> pb + br -> pb) / 4.0;
+    dct_rep -> avgpr = (tl -> pr + tr -> pr + bl -> pr + br -> pr) / 4.0;
+    dct_rep -> a = (br -> y + bl -> y + tr -> y + tl -> y) / 4.0;
+    dct_rep -> b = (br -> y + bl -> y - tr -> y - tl -> y) / 4.0;
+    dct_rep -> c = (br -> y - bl -> y + tr -> y - tl -> y) / 4.0;
+    dct_rep -> d = (br -> y - bl -> y - tr -> y + tl -> y) / 4.0;
+}
 
-/* 
- * perform_dct (int i, int j, A2Methods_UArray2 array2,
- *                            A2Methods_Object *ptr, 
- *                            void *cl)
- * 
- * Parameters: int i: index of column of array2
- *             int j: index of row of array2
- *             A2Methods_UArray2 array2: array of component_video structs
- *             A2Methods_Object *ptr: the component_video struct at the 
- *                                    current index
- *             void *cl: closure struct holding the array of dctrans structs,
- *                       half the size of the component_video structs array,
- *                       and the methods for that array
+/*
+ * load_pixel (plane_set ypp_rep, int i, int j, component_video cv)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes
+ *             int i, j: column and row of a pixel
+ *             component_video cv: where to store the pixel's values
  * Returns   : None
- * Does      : maps through the array of component_video structs by 2, always
- *             making sure we start at the top left corner of each block,
- *             extract the Y values, and uses Y1, Y2, Y3, and Y4 to calculate
- *             the a, b, c, and d values for the dctrans struct for that block.
- *             Also takes the average of the pb and pr values from those four
- *             blocks and sets avgpb and avgpr in the dctrans struct for that
- *             block.
+ * Does      : gathers one pixel's values from the three planes
  */
-void perform_dct (int i, int j, A2Methods_UArray2 array2,
-                                A2Methods_Object *ptr, 
-                                void *cl) 
+void load_pixel (plane_set ypp_rep, int i, int j, component_video cv)
 {
-    (void) array2;
+    cv -> y  = plane_row(ypp_rep, Y_PLANE, j)[i];
+    cv -> pb = plane_row(ypp_rep, PB_PLANE, j)[i];
+    cv -> pr = plane_row(ypp_rep, PR_PLANE, j)[i];
+}
 
-    if (i % 2 != 0 || j % 2 != 0) { /* start at top left corner of each
-                                     * 2x2 box */
-        return;
+/*
+ * store_pixel (plane_set ypp_rep, int i, int j, component_video cv)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes
+ *             int i, j: column and row of a pixel
+ *             component_video cv: the pixel's values
+ * Returns   : None
+ * Does      : scatters one pixel's values into the three planes
+ */
+void store_pixel (plane_set ypp_rep, int i, int j, component_video cv)
+{
+    plane_row(ypp_rep, Y_PLANE, j)[i]  = cv -> y;
+    plane_row(ypp_rep, PB_PLANE, j)[i] = cv -> pb;
+    plane_row(ypp_rep, PR_PLANE, j)[i] = cv -> pr;
+}
+
+/*
+ * ypp_rows_to_dct (plane_set ypp_rep, plane_set dct_rep, int row)
+ *
+ * Parameters: plane_set ypp_rep: y, pb, and pr planes
+ *             plane_set dct_rep: transform planes to fill
+ *             int row: row of 2x2 blocks to transform
+ * Returns   : None
+ * Does      : transforms a whole row of 2x2 blocks, KERNEL_BLOCKS at a time
+ *             with SSE2 where it is available. The left and right pixels of
+ *             each block are pulled apart with shuffles straight from the
+ *             plane rows. Sums are formed in the same order as
+ *             block_to_dct, and dividing a float by 4 is exact in either
+ *             precision, so both give bit-identical transforms. Leftover
+ *             blocks at the end of the row go through block_to_dct.
+ */
+void ypp_rows_to_dct (plane_set ypp_rep, plane_set dct_rep, int row)
+{
+    int blocks = dct_rep -> width,
+        i      = 0;
+
+#ifdef __SSE2__
+    const float *top[3], *bottom[3]; /* y, pb, pr */
+    for (int c = 0; c < 3; c++) {
+        top[c]    = plane_row(ypp_rep, c, row * 2);
+        bottom[c] = plane_row(ypp_rep, c, row * 2 + 1);
+    }
+    float *out[NUM_DCT_PLANES];
+    for (int c = 0; c < NUM_DCT_PLANES; c++) {
+        out[c] = plane_row(dct_rep, c, row);
+    }
+    __m128 quarter = _mm_set1_ps(0.25f);
+    for (; i + KERNEL_BLOCKS <= blocks; i += KERNEL_BLOCKS) {
+        /* left and right pixels of the top and bottom rows of each block,
+         * for each of y, pb, and pr */
+        __m128 tl[3], tr[3], bl[3], br[3];
+        for (int c = 0; c < 3; c++) {
+            __m128 t0 = _mm_load_ps(&top[c][i * 2]),
+                   t1 = _mm_load_ps(&top[c][i * 2 + 4]),
+                   b0 = _mm_load_ps(&bottom[c][i * 2]),
+                   b1 = _mm_load_ps(&bottom[c][i * 2 + 4]);
+            tl[c] = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0));
+            tr[c] = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 3, 1));
+            bl[c] = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+            br[c] = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+        }
+        for (int c = 1; c <= 2; c++) { /* avgpb, then avgpr */
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(tl[c], tr[c]),
+                                               bl[c]), br[c]);
+            _mm_store_ps(&out[c - 1][i], _mm_mul_ps(sum, quarter));
+        }
+        __m128 y1 = tl[0], y2 = tr[0], y3 = bl[0], y4 = br[0];
+        __m128 sum_b = _mm_add_ps(y4, y3),
+               dif_b = _mm_sub_ps(y4, y3);
+        _mm_store_ps(&out[A_PLANE][i], _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+                                       sum_b, y2), y1), quarter));
+        _mm_store_ps(&out[B_PLANE][i], _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(
+                                       sum_b, y2), y1), quarter));
+        _mm_store_ps(&out[C_PLANE][i], _mm_mul_ps(_mm_sub_ps(_mm_add_ps(
+                                       dif_b, y2), y1), quarter));
+        _mm_store_ps(&out[D_PLANE][i], _mm_mul_ps(_mm_add_ps(_mm_sub_ps(
+                                       dif_b, y2), y1), quarter));
+    }
+#endif
+
+    for (; i < blocks; i++) {
+        struct component_video tl, tr, bl, br;
+        load_pixel(ypp_rep, i * 2, row * 2, &tl);
+        load_pixel(ypp_rep, i * 2 + 1, row * 2, &tr);
+        load_pixel(ypp_rep, i * 2, row * 2 + 1, &bl);
+        load_pixel(ypp_rep, i * 2 + 1, row * 2 + 1, &br);
+        struct dctrans dct;
+        block_to_dct(&tl, &tr, &bl, &br, &dct);
+        plane_row(dct_rep, AVGPB_PLANE, row)[i] = dct.avgpb;
+        plane_row(dct_rep, AVGPR_PLANE, row)[i] = dct.avgpr;
+        plane_row(dct_rep, A_PLANE, row)[i]     = dct.a;
+        plane_row(dct_rep, B_PLANE, row)[i]     = dct.b;
+        plane_row(dct_rep, C_PLANE, row)[i]     = dct.c;
+        plane_row(dct_rep, D_PLANE, row)[i]     = dct.d;
     }
-    closure_struct cl_struct = (closure_struct) cl;
-    component_video ypp_rep = (component_video) ptr;
-
-    dctrans dct_rep = (dctrans) (cl_struct -> methods -> 
-                                              at(cl_struct -> array2,
-                                                 i / 2, 
-                                                 j / 2));
-    /* obtain info about the other pixel representations in the same 2x2 box */
-    component_video tr = (component_video)(cl_struct -> methods -> at(array2,
-                                                                      i + 1, 
-                                                                      j));
-    component_video bl = (component_video)(cl_struct -> methods -> at(array2,
-                                                                      i, 
-                                                                      j + 1));
-    component_video br = (component_video)(cl_struct -> methods -> at(array2,
-                                                                      i + 1, 
-                                                                      j + 1));
-    /* perform necessary calculations */
-    dct_rep -> avgpb = (ypp_rep -> pb + tr -> pb + bl -> pb + br -> pb) / 4.0;
-    dct_rep -> avgpr = (ypp_rep -> pr + tr -> pr + bl -> pr + br -> pr) / 4.0;
-    dct_rep -> a = (br -> y + bl -> y + tr -> y + ypp_rep -> y) / 4.0;
-    dct_rep -> b = (br -> y + bl -> y - tr -> y - ypp_rep -> y) / 4.0;
-    dct_rep -> c = (br -> y - bl -> y + tr -> y - ypp_rep -> y) / 4.0;
-    dct_rep -> d = (br -> y - bl -> y - tr -> y + ypp_rep -> y) / 4.0;
 }
 
 
-/* 
- * A2Methods_UArray2 dct_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods)
- * 
- * Parameters: A2Methods_UArray2 array2: array of dctrans structs
- *             A2Methods_T methods: methods for UArray2
- * Returns   : A2Methods_UArray2: UArray2 of component_video objects 2x the 
- *                                height and width of the UArray2 of dctrans
- *                                structs
- * Does      : Takes in an array of dctrans structs and performs calculations
- *             to create an array of component_video structs with dimensions
- *             double the size from the a, b, c, and d values.
+/*
+ * plane_set dct_to_ypp (plane_set dct_rep)
+ *
+ * Parameters: plane_set dct_rep: avgpb, avgpr, a, b, c, and d planes
+ * Returns   : plane_set: y, pb, and pr planes 2x the height and width of
+ *                        the transform planes
+ * Does      : Takes in transform planes and performs calculations to
+ *             create y, pb, and pr planes with dimensions double the size
+ *             from the a, b, c, and d values.
  */
-A2Methods_UArray2 dct_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods) 
+plane_set dct_to_ypp (plane_set dct_rep)
 {
-    assert(array2 != NULL);
-    assert(methods != NULL);
-    /* each element in dct array corresponds to a 2x2 box of pixels */
-    int width  = (methods -> width(array2)) * 2,
-        height = (methods -> height(array2)) * 2;
-    A2Methods_UArray2 ypp_rep = methods -> new(width, 
-                                               height,
-                                               sizeof(struct component_video));
-    closure_struct cl = malloc(sizeof(*cl));
-    assert(cl != NULL);
-    cl -> array2 = ypp_rep;
-    cl -> methods = methods;
-
-    methods -> map_row_major(array2, reverse_dct, cl);
-
-    free(cl);
+    assert(dct_rep != NULL);
+    /* each element in dct planes corresponds to a 2x2 box of pixels */
+    plane_set ypp_rep = plane_set_new(dct_rep -> width * 2,
+                                      dct_rep -> height * 2, NUM_YPP_PLANES);
+
+    dct_to_ypp_into(dct_rep, ypp_rep);
 
     return ypp_rep;
 }
 
-/* 
- * reverse_dct (int i, int j, A2Methods_UArray2 array2,
- *                            A2Methods_Object *ptr, 
- *                            void *cl)
- * 
- * Parameters: int i: index of column of array2
- *             int j: index of row of array2
- *             A2Methods_UArray2 array2: array of dctrans structs
- *             A2Methods_Object *ptr: the dctrans struct at the current index
- *             void *cl: closure struct holding the array of component_video
- *                       structs, double the size of the dctrans structs array,
- *                       and the methods for that array
+/*
+ * dct_to_ypp_into (plane_set dct_rep, plane_set ypp_rep)
+ *
+ * Parameters: plane_set dct_rep: transform planes
+ *             plane_set ypp_rep: y, pb, and pr planes to fill, at least
+ *                                twice the width and height of dct_rep
  * Returns   : None
- * Does      : maps through the array of dctrans structs, extracts the 
- *             a, b, c, d, avgpr, and avgpb values, and uses them to calculate
- *             Y1, Y2, Y3, and Y4 as well as set pb and pr.
+ * Does      : The same as dct_to_ypp, into planes the caller provides
  */
-void reverse_dct (int i, int j, A2Methods_UArray2 array2,
-                                A2Methods_Object *ptr, 
-                                void *cl) 
+void dct_to_ypp_into (plane_set dct_rep, plane_set ypp_rep)
 {
-    (void) array2;
-
-    closure_struct cl_struct = (closure_struct) cl;
-    dctrans dct_rep = (dctrans) ptr;
-
-    int block_counter = 1; /* to check if we need to calculate Y1,2,3, or 4 */
-    for (int iteratorR = j * 2; iteratorR <= (j * 2) + 1; iteratorR++) {
-        for (int iteratorC = i * 2; iteratorC <= (i * 2) + 1; iteratorC++) {
-            component_video ypp_rep = (component_video) cl_struct -> 
-                                                        methods ->
-                                                        at(cl_struct -> array2, 
-                                                           iteratorC, 
-                                                           iteratorR);
-            reverse_dct_calc(ypp_rep, dct_rep, block_counter);
-            block_counter++;
-        }
+    assert(dct_rep != NULL && ypp_rep != NULL);
+    assert(dct_rep -> width * 2 <= ypp_rep -> width);
+    assert(dct_rep -> height * 2 <= ypp_rep -> height);
+
+    for (int j = 0; j < dct_rep -> height; j++) {
+        dct_row_to_ypp(dct_rep, ypp_rep, j);
     }
 }
 
-/* 
- * reverse_dct_calc (component_video ypp_rep, dctrans dct_rep,
- *                                            int block_counter)
- * Parameters: component_video ypp_rep: component_video struct at current
- *                                      spot
- *             dctrans dct_rep: dctrans struct at current block
- *             int block_counter: indicator of which spot is current in the
- *                                block
+/*
+ * dct_to_block (dctrans dct_rep, component_video tl, component_video tr,
+ *                                component_video bl, component_video br)
+ *
+ * Parameters: dctrans dct_rep: dctrans struct of the current block
+ *             component_video tl, tr, bl, br: the top left, top right,
+ *                                             bottom left, and bottom right
+ *                                             pixels of the block to fill
  * Returns   : None
  * Does      : Performs calculations necessary to transform a dctrans block
  *             back into a component_video struct for each of the four spots
  *             in the block
  */
-void reverse_dct_calc (component_video ypp_rep, dctrans dct_rep,
-                                                int block_counter) 
+void dct_to_block (dctrans dct_rep, component_video tl, component_video tr,
+                                    component_video bl, component_video br)
 {
-    ypp_rep -> pb = dct_rep -> avgpb;
-    ypp_rep -> pr = dct_rep -> avgpr;
-    
-    if(block_counter == 1) { /* y1 */
-        ypp_rep -> y = (dct_rep -> a - dct_rep -> b - dct_rep -> c
-                                                    + dct_rep -> d);
-    } else if (block_counter == 2) { /* y2 */
-        ypp_rep -> y = (dct_rep -> a - dct_rep -> b + dct_rep -> c
-                                                    - dct_rep -> d);
-    } else if (block_counter == 3) { /* y3 */
-        ypp_rep -> y = (dct_rep -> a + dct_rep -> b - dct_rep -> c
-                                                    - dct_rep -> d);
-    } else if (block_counter == 4) { /* y4 */
-        ypp_rep -> y = (dct_rep -> a + dct_rep -> b + dct_rep -> c
-                                                    + dct_rep -> d);
+    float a = dct_rep -> a,
+          b = dct_rep -> b,
+          c = dct_rep -> c,
+          d = dct_rep -> d;
+
+    tl -> y = a - b - c + d; /* y1 */
+    tr -> y = a - b + c - d; /* y2 */
+    bl -> y = a + b - c - d; /* y3 */
+    br -> y = a + b + c + d; /* y4 */
+
+    tl -> pb = tr -> pb = bl -> pb = br -> pb = dct_rep -> avgpb;
+    tl -> pr = tr -> pr = bl -> pr = br -> pr = dct_rep -> avgpr;
+}
+
+/*
+ * dct_row_to_ypp (plane_set dct_rep, plane_set ypp_rep, int row)
+ *
+ * Parameters: plane_set dct_rep: transform planes
+ *             plane_set ypp_rep: y, pb, and pr planes to fill
+ *             int row: row of 2x2 blocks to invert
+ * Returns   : None
+ * Does      : inverts a whole row of transforms, KERNEL_BLOCKS at a time
+ *             with SSE2 where it is available, with the same order of
+ *             operations as dct_to_block so both give bit-identical pixels.
+ *             The left and right pixels of each block are woven back
+ *             together with unpacks. Leftover blocks at the end of the row
+ *             go through dct_to_block.
+ */
+void dct_row_to_ypp (plane_set dct_rep, plane_set ypp_rep, int row)
+{
+    int blocks = dct_rep -> width,
+        i      = 0;
+
+#ifdef __SSE2__
+    const float *in[NUM_DCT_PLANES];
+    for (int c = 0; c < NUM_DCT_PLANES; c++) {
+        in[c] = plane_row(dct_rep, c, row);
+    }
+    float *top[3], *bottom[3]; /* y, pb, pr */
+    for (int c = 0; c < 3; c++) {
+        top[c]    = plane_row(ypp_rep, c, row * 2);
+        bottom[c] = plane_row(ypp_rep, c, row * 2 + 1);
+    }
+    for (; i + KERNEL_BLOCKS <= blocks; i += KERNEL_BLOCKS) {
+        __m128 va = _mm_load_ps(&in[A_PLANE][i]),
+               vb = _mm_load_ps(&in[B_PLANE][i]),
+               vc = _mm_load_ps(&in[C_PLANE][i]),
+               vd = _mm_load_ps(&in[D_PLANE][i]);
+        __m128 a_minus_b = _mm_sub_ps(va, vb),
+               a_plus_b  = _mm_add_ps(va, vb);
+        __m128 y1 = _mm_add_ps(_mm_sub_ps(a_minus_b, vc), vd),
+               y2 = _mm_sub_ps(_mm_add_ps(a_minus_b, vc), vd),
+               y3 = _mm_sub_ps(_mm_sub_ps(a_plus_b, vc), vd),
+               y4 = _mm_add_ps(_mm_add_ps(a_plus_b, vc), vd);
+        _mm_store_ps(&top[Y_PLANE][i * 2],     _mm_unpacklo_ps(y1, y2));
+        _mm_store_ps(&top[Y_PLANE][i * 2 + 4], _mm_unpackhi_ps(y1, y2));
+        _mm_store_ps(&bottom[Y_PLANE][i * 2],     _mm_unpacklo_ps(y3, y4));
+        _mm_store_ps(&bottom[Y_PLANE][i * 2 + 4], _mm_unpackhi_ps(y3, y4));
+        for (int c = 1; c <= 2; c++) { /* pb from avgpb, pr from avgpr */
+            __m128 avg = _mm_load_ps(&in[c - 1][i]),
+                   lo  = _mm_unpacklo_ps(avg, avg),
+                   hi  = _mm_unpackhi_ps(avg, avg);
+            _mm_store_ps(&top[c][i * 2], lo);
+            _mm_store_ps(&top[c][i * 2 + 4], hi);
+            _mm_store_ps(&bottom[c][i * 2], lo);
+            _mm_store_ps(&bottom[c][i * 2 + 4], hi);
+        }
     }
-}
\ No newline at end of file
+#endif
+
+    for (; i < blocks; i++) {
+        struct dctrans dct = {
+            plane_row(dct_rep, AVGPB_PLANE, row)[i],
+            plane_row(dct_rep, AVGPR_PLANE, row)[i],
+            plane_row(dct_rep, A_PLANE, row)[i],
+            plane_row(dct_rep, B_PLANE, row)[i],
+            plane_row(dct_rep, C_PLANE, row)[i],
+            plane_row(dct_rep, D_PLANE, row)[i]
+        };
+        struct component_video tl, tr, bl, br;
+        dct_to_block(&dct, &tl, &tr, &bl, &br);
+        store_pixel(ypp_rep, i * 2, row * 2, &tl);
+        store_pixel(ypp_rep, i * 2 + 1, row * 2, &tr);
+        store_pixel(ypp_rep, i * 2, row * 2 + 1, &bl);
+        store_pixel(ypp_rep, i * 2 + 1, row * 2 + 1, &br);
+    }
+}
@@ -3,41 +3,58 @@
  * Filename: ypp_dct.h
  * Assignment: Arith
  * Summary: The functions in this file perform the necessary operations to
- *          transform the y, pb, and pr values from our component_video struct
- *          at each point in the array of those component_video structs to 
- *          dctrans structs which hold the a, b, c, d, average pb, and average
- *          pr values for 2-by-2 blocks in the array of component_video structs
+ *          transform the y, pb, and pr planes of an image to planes which
+ *          hold the a, b, c, d, average pb, and average pr values for
+ *          2-by-2 blocks of the image
  */
 
 
 #ifndef YPP_DCT_INCLUDED
 #define YPP_DCT_INCLUDED
 
-#include "a2methods.h"
 #include "assert.h"
-#include "a2plain.h"
+#include "plane_set.h"
 #include <string.h>
 #include <malloc.h>
 
 /*
  * ypp_to_dct
  * 
- * returns a discrete cosine transformation 2D array representation of the
- * image represented by the given 2D array of component video elements
+ * returns discrete cosine transformation planes, one element per 2x2 block,
+ * of the image represented by the given y, pb, and pr planes
  * 
- * assumes the arguments are not NULL
+ * assumes the argument is not NULL
  */
-A2Methods_UArray2 ypp_to_dct (A2Methods_UArray2 array2, A2Methods_T methods);
+plane_set ypp_to_dct (plane_set ypp_rep);
+
+/*
+ * ypp_to_dct_into
+ * 
+ * fills the given transform planes from the 2x2 blocks of the given y, pb,
+ * and pr planes, as many blocks as the transform planes hold
+ * 
+ * assumes neither argument is NULL
+ */
+void ypp_to_dct_into (plane_set ypp_rep, plane_set dct_rep);
 
 /*
  * dct_to_ypp
  * 
- * returns a component video 2D array representation of the
- * image represented by the given 2D array of discrete cosine
- * transformation elements
+ * returns y, pb, and pr planes of the image represented by the given
+ * discrete cosine transformation planes
+ * 
+ * assumes the argument is not NULL
+ */
+plane_set dct_to_ypp (plane_set dct_rep);
+
+/*
+ * dct_to_ypp_into
+ * 
+ * fills the 2x2 blocks of the given y, pb, and pr planes from the given
+ * transform planes
  * 
- * assumes the arguments are not NULL
+ * assumes neither argument is NULL
  */
-A2Methods_UArray2 dct_to_ypp (A2Methods_UArray2 array2, A2Methods_T methods);
+void dct_to_ypp_into (plane_set dct_rep, plane_set ypp_rep);
 
 #endif
\ No newline at end of file